@@ -6,6 +6,7 @@
 #include <math.h>
 
 #include "ada_boost.h"
+#include "weak_predictor.h"
 
 #include "predictor.h"
 #include "instance.h"
@@ -23,7 +24,9 @@ namespace MachineLearning
 					  , Metrics::Metric quality_checker
 				      , double max_quality
 				      , bool bagging
-					  , double bagging_factor)
+					  , double bagging_factor
+					  , BaggingType bagging_type
+					  , unsigned int bagging_seed)
 	: Predictor(_featuresCount)
 	, m_predictor_type(predictor_type)
 	, m_max_estimators(max_estimators)
@@ -31,18 +34,146 @@ namespace MachineLearning
 	, m_max_quality(max_quality)
 	, m_bagging(bagging)
 	, m_bagging_factor(bagging_factor)
+	, m_bagging_type(bagging_type)
+	, m_bagging_seed(bagging_seed)
+	, m_stumps_compiled(false)
+	, m_stumps_base(0.0)
 	{ }
 
 	double AdaBoost::predict(MathVector<double>& features)
 	{
-		double prediction = 0;
-#pragma omp parallel for reduction(+:prediction)
+		double prediction = m_stumps_compiled ? stumps_score(features) : ensemble_score(features);
+
+		return prediction > 0.0 ? 1.0 : -1.0;
+	}
+
+	double AdaBoost::ensemble_score(MathVector<double>& features) const
+	{
+		double prediction = 0.0;
 		for (size_t index = 0; index < m_estimators.size(); ++index)
 		{
-			prediction = prediction + m_weights[index] * m_estimators[index]->predict(features);
+			prediction += m_weights[index] * m_estimators[index]->predict(features);
 		}
 
-		return prediction > 0.0 ? 1.0 : -1.0;
+		return prediction;
+	}
+
+	double AdaBoost::stumps_score(MathVector<double>& features) const
+	{
+		// every table contributes its zero_vote for an absent feature, so only
+		// the not null features of the object correct the base score
+		double prediction = m_stumps_base;
+		MathVector<double>::const_fast_iterator it  = features.const_fast_begin();
+		MathVector<double>::const_fast_iterator end = features.const_fast_end();
+		for (; it != end; ++it)
+		{
+			std::unordered_map<size_t, StumpTable>::const_iterator table = m_stump_tables.find(it.index());
+			if (table == m_stump_tables.end())
+				continue;
+
+			const std::vector<double>& thresholds = table->second.thresholds;
+			size_t position = std::lower_bound(thresholds.begin(), thresholds.end(), it.getElem()) - thresholds.begin();
+			prediction += table->second.votes[position] - table->second.zero_vote;
+		}
+
+		return prediction;
+	}
+
+	void AdaBoost::predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions)
+	{
+		predictions.assign(objects.size(), 0.0);
+
+		// linear estimators are scored together: their weight vectors are
+		// the columns of one sparse product over all objects
+		std::vector<const MathVector<double>*> linear_weights;
+		std::vector<size_t> first_scores;
+		bool linear_ensemble = !m_stumps_compiled && !m_estimators.empty();
+		for (size_t index = 0; index < m_estimators.size() && linear_ensemble; ++index)
+		{
+			first_scores.push_back(linear_weights.size());
+			linear_ensemble = m_estimators[index]->linear_weights(linear_weights) > 0;
+		}
+		if (linear_ensemble)
+		{
+			DenseMatrix<double> products;
+			linear_products(objects, linear_weights, products);
+#pragma omp parallel for schedule(static)
+			for (size_t obj_index = 0; obj_index < objects.size(); ++obj_index)
+			{
+				double prediction = 0.0;
+				for (size_t index = 0; index < m_estimators.size(); ++index)
+					prediction += m_weights[index] * m_estimators[index]->predict_scores(products.row(obj_index) + first_scores[index]);
+				predictions[obj_index] = prediction > 0.0 ? 1.0 : -1.0;
+			}
+			return;
+		}
+
+		size_t blocks_count = (objects.size() + predict_block_size - 1) / predict_block_size;
+
+#pragma omp parallel for schedule(dynamic)
+		for (size_t block = 0; block < blocks_count; ++block)
+		{
+			size_t begin = block * predict_block_size;
+			size_t end   = std::min(objects.size(), begin + predict_block_size);
+			if (m_stumps_compiled)
+			{
+				for (size_t obj_index = begin; obj_index < end; ++obj_index)
+					predictions[obj_index] = stumps_score(objects[obj_index].getFeatures());
+			}
+			else
+			{
+				for (size_t index = 0; index < m_estimators.size(); ++index)
+				{
+					for (size_t obj_index = begin; obj_index < end; ++obj_index)
+						predictions[obj_index] += m_weights[index] * m_estimators[index]->predict(objects[obj_index].getFeatures());
+				}
+			}
+
+			for (size_t obj_index = begin; obj_index < end; ++obj_index)
+				predictions[obj_index] = predictions[obj_index] > 0.0 ? 1.0 : -1.0;
+		}
+	}
+
+	void AdaBoost::compile_stumps()
+	{
+		m_stumps_compiled = false;
+		m_stumps_base     = 0.0;
+		m_stump_tables.clear();
+
+		// stump votes c for feature <= threshold and -c otherwise, so the
+		// ensemble score is -sum(w * c) plus 2 * w * c of every stump whose
+		// threshold is not less than the feature value
+		std::unordered_map<size_t, std::vector<std::pair<double, double>>> stumps;
+		for (size_t index = 0; index < m_estimators.size(); ++index)
+		{
+			const WeakClassifier* stump = dynamic_cast<const WeakClassifier*>(m_estimators[index].get());
+			if (stump == nullptr)
+				return;
+
+			double vote = m_weights[index] * stump->get_positive_class();
+			stumps[stump->get_feature()].push_back(std::make_pair(stump->get_threshold(), 2.0 * vote));
+			m_stumps_base -= vote;
+		}
+
+		for (auto& feature_stumps: stumps)
+		{
+			std::vector<std::pair<double, double>>& rules = feature_stumps.second;
+			std::sort(rules.begin(), rules.end());
+
+			StumpTable& table = m_stump_tables[feature_stumps.first];
+			table.thresholds.resize(rules.size());
+			table.votes.assign(rules.size() + 1, 0.0);
+			for (size_t position = rules.size(); position > 0; --position)
+			{
+				table.thresholds[position - 1] = rules[position - 1].first;
+				table.votes[position - 1]      = table.votes[position] + rules[position - 1].second;
+			}
+			size_t zero_position = std::lower_bound(table.thresholds.begin(), table.thresholds.end(), 0.0) - table.thresholds.begin();
+			table.zero_vote = table.votes[zero_position];
+			m_stumps_base  += table.zero_vote;
+		}
+
+		m_stumps_compiled = true;
 	}
 
 	void AdaBoost::learn( std::vector<Instance>& learnSet
@@ -51,34 +182,29 @@ namespace MachineLearning
 	{
 		if (objectsWeights.empty())
 			objectsWeights = std::vector<double>(learnSet.size(), 1.0);
-		std::vector<Metrics::Metric> quality_func({m_quality_checker});
-		double quality = test(learnSet, quality_func).front(); 
+		m_estimators.clear();
+		m_weights.clear();
+		m_stumps_compiled = false;
+		m_stump_tables.clear();
+
+		// margins[i] is the weighted vote of all estimators on the i-th object,
+		// predictions[i] is the answer of the last estimator; each estimator
+		// is evaluated on the learn set exactly once
+		std::vector<double> margins(learnSet.size(), 0.0);
+		std::vector<double> predictions(learnSet.size(), 0.0);
+		double quality = margins_quality(learnSet, margins);
 		size_t errors     = 0;
 		size_t max_errors = 10;
 		double norm_factor = 1.0 / (double)learnSet.size();
 		std::vector<double> obj_weights = std::vector<double>(learnSet.size(), norm_factor);
 		for (size_t index = 0; index < obj_weights.size(); ++index)
 			obj_weights[index] *= objectsWeights[index];
-		auto check_negative = [this]( PredictorPtr& predictor
-				                    , std::vector<Instance>& learnSet
-								    , std::vector<double>& objectsWeights)
-	    -> double
-		{
-			double negative_predictions = 0.0;
-#pragma omp parallel for reduction(+:negative_predictions)
-			for (size_t obj_index = 0; obj_index < learnSet.size(); ++obj_index)
-			{
-				double error = (predictor->predict(learnSet[obj_index].getFeatures()) * learnSet[obj_index].getGoal() < 0.0);
-				negative_predictions = negative_predictions + error * objectsWeights[obj_index];
-			}
-
-			return negative_predictions;
-		};
 
-		std::vector<double> objectsProbs(learnSet.size(), 1.0 / (double)learnSet.size());
 		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::discrete_distribution<> distribution(objectsProbs.begin(), objectsProbs.end());
+		unsigned int bagging_seed = m_bagging_seed > 0 ? m_bagging_seed : rd();
+		std::vector<double> multiplicities;
+		std::vector<double> bagged_weights;
+		std::vector<Instance> bagged_objects;
 
 		
 		size_t estimator_index = 0;
@@ -93,22 +219,69 @@ namespace MachineLearning
 			}
 			else
 			{
-				std::vector<Instance> subLearnSets;
-				std::vector<double>   subsObjWeights;
-				size_t bagging_size = learnSet.size() * m_bagging_factor;
+				// bootstrap sample as multiplicities of the boosting weights,
+				// objects out of the sample get zero weight
+				sample_multiplicities( m_bagging_type
+									 , std::vector<double>()
+									 , learnSet.size()
+									 , m_bagging_factor
+									 , bagging_seed
+									 , (unsigned int)estimator_index
+									 , multiplicities);
 				double summaries = 0.0;
-				for (size_t obj_index = 0; obj_index < bagging_size; ++obj_index)
+				for (size_t obj_index = 0; obj_index < learnSet.size(); ++obj_index)
+					summaries += obj_weights[obj_index] * multiplicities[obj_index];
+				if (summaries <= 0.0)
+				{
+					std::cout << "	empty bootstrap sample, the whole learn set is used" << std::endl;
+					multiplicities.assign(learnSet.size(), 1.0);
+				}
+
+				if (new_predictor->uses_weights())
+				{
+					bagged_weights.resize(learnSet.size());
+					summaries = 0.0;
+					for (size_t obj_index = 0; obj_index < learnSet.size(); ++obj_index)
+					{
+						bagged_weights[obj_index] = obj_weights[obj_index] * multiplicities[obj_index];
+						summaries += bagged_weights[obj_index];
+					}
+					for (double& weight: bagged_weights)
+						weight /= summaries;
+
+					new_predictor->learn(learnSet, bagged_weights, learning_curve);
+				}
+				else
 				{
-					size_t instance_index = distribution(gen);
-					subLearnSets.push_back(learnSet[instance_index]);
-					subsObjWeights.push_back(obj_weights[instance_index]);
-					summaries += obj_weights[instance_index];
+					// the sample is given as objects, each repeated as many
+					// times as it was drawn
+					bagged_objects.clear();
+					bagged_weights.clear();
+					summaries = 0.0;
+					for (size_t obj_index = 0; obj_index < learnSet.size(); ++obj_index)
+					{
+						for (size_t draw = 0; draw < (size_t)multiplicities[obj_index]; ++draw)
+						{
+							bagged_objects.push_back(learnSet[obj_index]);
+							bagged_weights.push_back(obj_weights[obj_index]);
+							summaries += obj_weights[obj_index];
+						}
+					}
+					for (double& weight: bagged_weights)
+						weight /= summaries;
+
+					new_predictor->learn(bagged_objects, bagged_weights, learning_curve);
 				}
-				
-				new_predictor->learn(subLearnSets, subsObjWeights, learning_curve);
 			}
 
-			negative_predictions = check_negative(new_predictor, learnSet, obj_weights);
+#pragma omp parallel for reduction(+:negative_predictions)
+			for (size_t obj_index = 0; obj_index < learnSet.size(); ++obj_index)
+			{
+				predictions[obj_index] = new_predictor->predict(learnSet[obj_index].getFeatures());
+				double error = (predictions[obj_index] * learnSet[obj_index].getGoal() < 0.0);
+				negative_predictions = negative_predictions + error * obj_weights[obj_index];
+			}
+
 			double predictor_weight     = 0.5 * log((1.0 - negative_predictions + norm_factor) / (negative_predictions + norm_factor));
 			std::cout << "\tnegative predictions: " << negative_predictions
 			          << " predictor weight:" << predictor_weight << std::endl;
@@ -118,11 +291,12 @@ namespace MachineLearning
 			m_weights.push_back(predictor_weight);
 
 			double summary = 0.0;
+#pragma omp parallel for reduction(+:summary)
 			for (size_t obj_index = 0; obj_index < learnSet.size(); ++obj_index)
 			{
-				double prediction = m_estimators.back()->predict(learnSet[obj_index].getFeatures());
-				double assesment  = std::exp(prediction * learnSet[obj_index].getGoal() * (-predictor_weight));
+				double assesment  = std::exp(predictions[obj_index] * learnSet[obj_index].getGoal() * (-predictor_weight));
 				obj_weights[obj_index] *= assesment;
+				margins[obj_index]     += predictor_weight * predictions[obj_index];
 				summary = summary + obj_weights[obj_index];
 			}
 
@@ -140,7 +314,7 @@ namespace MachineLearning
 			for (double& weight: obj_weights)
 				weight /= summary;
 
-			double current_quality = test(learnSet, quality_func).front();
+			double current_quality = margins_quality(learnSet, margins);
 			std::cout << "\rlast quality: " << quality << " current quality: " << current_quality << std::endl;
 			/*if (current_quality < quality)
 			{
@@ -156,16 +330,48 @@ namespace MachineLearning
 				errors = 0;
 				estimator_index++;
 			}*/
+			quality = current_quality;
 			estimator_index++;
 			if (current_quality >= m_max_quality)
-				return;
+				break;
 		}
 
+		compile_stumps();
+		if (m_stumps_compiled)
+			std::cout << "stumps compiled into " << m_stump_tables.size() << " feature tables" << std::endl;
+
 		std::cout << "learning finished"  << std::endl
 			      << "\t   learn quality: " << quality                << std::endl
 		          << "\testimators count: " << m_estimators.size()    << std::endl
 				  << "\tmodel complexity: " << get_model_complexity() << std::endl;
 	}
+
+	double AdaBoost::margins_quality( std::vector<Instance>& learnSet
+									, const std::vector<double>& margins) const
+	{
+		double true_positive  = 0.0;
+		double false_positive = 0.0;
+		double true_negative  = 0.0;
+		double false_negative = 0.0;
+#pragma omp parallel for reduction(+:true_positive,false_positive,true_negative,false_negative)
+		for (size_t obj_index = 0; obj_index < learnSet.size(); ++obj_index)
+		{
+			bool positive_prediction = margins[obj_index] > 0.0;
+			bool positive_goal       = learnSet[obj_index].getGoal() == 1.0;
+			if (positive_prediction)
+			{
+				true_positive  = true_positive  + (positive_goal ? 1.0 : 0.0);
+				false_positive = false_positive + (positive_goal ? 0.0 : 1.0);
+			}
+			else
+			{
+				true_negative  = true_negative  + (positive_goal ? 0.0 : 1.0);
+				false_negative = false_negative + (positive_goal ? 1.0 : 0.0);
+			}
+		}
+
+		return m_quality_checker(true_positive, false_positive, true_negative, false_negative);
+	}
 		
 	size_t AdaBoost::get_model_complexity()
 	{
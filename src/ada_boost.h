@@ -3,10 +3,12 @@
 
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "predictor.h"
 #include "instance.h"
 #include "metric.h"
+#include "sampling.h"
 
 #include "mathvector.h"
 
@@ -23,17 +25,40 @@ namespace MachineLearning
 				, Metrics::Metric quality_checker = Metrics::F1ScoreMetric
 				, double max_quality = 0.98
 				, bool bagging = false
-				, double bagging_factor = 1.0);
+				, double bagging_factor = 1.0
+				, BaggingType bagging_type = BaggingType::POISSON
+				, unsigned int bagging_seed = 0);
 
 		
 		double predict(MathVector<double>& features);
+		void predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions);
 		void learn( std::vector<Instance>& learnSet
 				  , std::vector<double>& objectsWeights
 				  , std::vector<std::pair<double, double>>& learning_curve);
 		
 		size_t get_model_complexity();
 
-		Predictor* clone() const { new AdaBoost(*this);};
+		Predictor* clone() const { return new AdaBoost(*this);};
+		bool uses_weights() const { return true;};
+	private:
+		// quality of the ensemble on the learn set from its cached margins
+		double margins_quality( std::vector<Instance>& learnSet
+							  , const std::vector<double>& margins) const;
+
+		// ensembles of WeakClassifier stumps are compiled into per-feature
+		// tables: thresholds of the feature sorted ascending and, for every
+		// position, the summary vote of stumps with threshold at or above it
+		struct StumpTable
+		{
+			std::vector<double> thresholds;
+			std::vector<double> votes;
+			double              zero_vote;
+		};
+
+		void   compile_stumps();
+		double stumps_score(MathVector<double>& features) const;
+		double ensemble_score(MathVector<double>& features) const;
+
 	private:
 		std::vector<PredictorPtr> m_estimators;
 		std::vector<double>       m_weights;
@@ -43,6 +68,14 @@ namespace MachineLearning
 		double                    m_max_quality;
 		bool                      m_bagging;
 		double                    m_bagging_factor;
+		BaggingType               m_bagging_type;
+		unsigned int              m_bagging_seed;
+
+		bool                                   m_stumps_compiled;
+		double                                 m_stumps_base;
+		std::unordered_map<size_t, StumpTable> m_stump_tables;
+
+		static const size_t predict_block_size = 256;
 	};
 }
 
@@ -22,7 +22,7 @@ namespace MachineLearning
 		if (m_tree.empty())
 			return 1.0;
 		else
-			m_tree.back()->get_prediction(features);
+			return m_tree.back()->get_prediction(features);
 	}
 
 	void DecisionTree::learn( std::vector<Instance>& learnSet
@@ -31,13 +31,14 @@ namespace MachineLearning
 	{
 		if (objectsWeights.empty())
 			objectsWeights = std::vector<double>(learnSet.size(), 1.0 / (double)learnSet.size());
+		std::random_device rd;
+		m_generator.seed(m_seed != 0 ? m_seed : rd());
 		std::vector<double> learnWeights;
 		std::vector<Instance> learnSubset;
 		std::vector<Instance> testSubset;
 		if (m_pruning_factor > 0.0)
 		{
-			std::random_device rd;
-			std::mt19937 gen(rd());
+			std::mt19937& gen = m_generator;
 			std::discrete_distribution<> distribution(objectsWeights.begin(), objectsWeights.end());
 			size_t learn_size = learnSet.size() * m_pruning_factor;
 			double summary = 0.0;
@@ -59,15 +60,24 @@ namespace MachineLearning
 		}
 		else
 		{
-			learnSubset = learnSet;
-			learnWeights = objectsWeights;
+			// objects out of a bootstrap sample have zero weight and are
+			// left out at the root
+			for (size_t index = 0; index < learnSet.size(); ++index)
+			{
+				if (objectsWeights[index] == 0.0)
+					continue;
+				learnSubset.push_back(learnSet[index]);
+				learnWeights.push_back(objectsWeights[index]);
+			}
 		}
-		std::cout << "learning start" << std::endl;
-		std::shared_ptr<AbstractNode> root = learn_subtree(learnSubset, testSubset, objectsWeights);
+		if (!m_quiet)
+			std::cout << "learning start" << std::endl;
+		std::shared_ptr<AbstractNode> root = learn_subtree(learnSubset, testSubset, learnWeights);
 		m_tree.push_back(root);
-		std::cout << "learning finished" << std::endl
-			      << "\t  count of nodes:"  << m_tree.size()          << std::endl
-				  << "\tmodel complexity:"  << get_model_complexity() << std::endl;
+		if (!m_quiet)
+			std::cout << "learning finished" << std::endl
+				      << "\t  count of nodes:"  << m_tree.size()          << std::endl
+					  << "\tmodel complexity:"  << get_model_complexity() << std::endl;
 
 	}
 
@@ -85,46 +95,62 @@ namespace MachineLearning
 	{
 		double positive_factor = 0.0;
 		double negative_factor = 0.0;
-		size_t positive_count = 0;
-		size_t negative_count = 0;
-		for (Instance& object: learnSet)
-			if (object.getGoal() == 1.0)
-				positive_count++;
+		double positive_weight = 0.0;
+		double negative_weight = 0.0;
+		for (size_t index = 0; index < learnSet.size(); ++index)
+			if (learnSet[index].getGoal() == 1.0)
+				positive_weight += objectsWeights[index];
 			else
-				negative_count++;
+				negative_weight += objectsWeights[index];
+
+		if (positive_weight + negative_weight <= 0.0)
+		{
+			if (!m_quiet)
+				std::cout << "Empty leaf reached" << std::endl;
+			return std::shared_ptr<AbstractNode>(new WeakLeaf(-1.0));
+		}
 
-		positive_factor = (double)positive_count / (double)learnSet.size();
-		negative_factor = (double)negative_count / (double)learnSet.size();
+		positive_factor = positive_weight / (positive_weight + negative_weight);
+		negative_factor = negative_weight / (positive_weight + negative_weight);
 			
-		std::cout << "positive factor: " << positive_factor << " negative factor: " << negative_factor << std::endl;
+		if (!m_quiet)
+			std::cout << "positive factor: " << positive_factor << " negative factor: " << negative_factor << std::endl;
 
 		if (positive_factor >= 0.95 || negative_factor >= 0.95)
 		{
-			std::cout << "Weak leaf reached" << std::endl;
+			if (!m_quiet)
+				std::cout << "Weak leaf reached" << std::endl;
 			return std::shared_ptr<AbstractNode>(new WeakLeaf((positive_factor > negative_factor) ? 1.0 : -1.0));
 		}
 
 		
-		std::cout << "Learning node as weak classifier" << std::endl;
+		if (!m_quiet)
+			std::cout << "Learning node as weak classifier" << std::endl;
 		PredictorPtr weak_predicate(m_weak_type->clone());
+		weak_predicate->set_seed(std::uniform_int_distribution<unsigned int>(1)(m_generator));
+		weak_predicate->set_quiet(m_quiet);
 		std::vector<std::pair<double, double>> learning_curve;
 		weak_predicate->learn(learnSet, objectsWeights, learning_curve);
 		std::vector<Metrics::Metric> quality_func({Metrics::F1ScoreMetric});
 		double current_quality = weak_predicate->test(learnSet, quality_func).front();
-		std::cout << "current quality: " << current_quality;
+		if (!m_quiet)
+			std::cout << "current quality: " << current_quality;
 		bool return_leaf = false;
 		if (!testSet.empty())
 		{
 			double test_quality = weak_predicate->test(testSet, quality_func).front();
 			if (current_quality - test_quality > 0.05)
 				return_leaf = true;
-			std::cout << "current test quality" << test_quality;
+			if (!m_quiet)
+				std::cout << "current test quality" << test_quality;
 		}
-		std::cout << std::endl;
+		if (!m_quiet)
+			std::cout << std::endl;
 
 		if (current_quality >= m_quality_max || std::isnan(current_quality) || return_leaf)
 		{
-			std::cout << "Strong leaf reached" << std::endl;
+			if (!m_quiet)
+				std::cout << "Strong leaf reached" << std::endl;
 			if (std::isnan(current_quality) || m_weak_leafed)
 				return std::shared_ptr<AbstractNode>(new WeakLeaf((positive_factor > negative_factor) ? 1.0 : -1.0));
 			if (m_lr_type == nullptr)
@@ -132,6 +158,7 @@ namespace MachineLearning
 			else
 			{
 				PredictorPtr lr_predictor(m_lr_type->clone());
+				lr_predictor->set_quiet(m_quiet);
 				lr_predictor->learn(learnSet, objectsWeights, learning_curve);
 				return std::shared_ptr<AbstractNode>(new PredictorNode(lr_predictor, nullptr, nullptr, true));
 			}
@@ -150,6 +177,8 @@ namespace MachineLearning
 			double right_summary = 0.0;
 			for (size_t index = 0; index < learnSet.size(); ++index)
 			{
+				if (objectsWeights[index] == 0.0)
+					continue;
 				if (weak_predicate->predict(learnSet[index].getFeatures()) == -1.0)
 				{
 					leftLearnSubset.push_back(learnSet[index]);
@@ -165,6 +194,13 @@ namespace MachineLearning
 
 			}
 
+			if (left_summary <= 0.0 || right_summary <= 0.0)
+			{
+				if (!m_quiet)
+					std::cout << "Degenerate split reached" << std::endl;
+				return std::shared_ptr<AbstractNode>(new WeakLeaf((positive_factor > negative_factor) ? 1.0 : -1.0));
+			}
+
 			for (double& weight: leftWeights)
 				weight /= left_summary;
 			for (double& weight: rightWeights)
@@ -180,9 +216,11 @@ namespace MachineLearning
 
 			//if (m_lr_type == nullptr)
 			//{
-				std::cout << "Learn left subtree" << std::endl;
+				if (!m_quiet)
+					std::cout << "Learn left subtree" << std::endl;
 				std::shared_ptr<AbstractNode> left_node  = learn_subtree(leftLearnSubset,  leftTestSubset,  leftWeights);
-				std::cout << "Learn right subtree" << std::endl;
+				if (!m_quiet)
+					std::cout << "Learn right subtree" << std::endl;
 				std::shared_ptr<AbstractNode> right_node = learn_subtree(rightLearnSubset, rightTestSubset, rightWeights);
 				m_tree.push_back(left_node);
 				m_tree.push_back(right_node);
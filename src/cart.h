@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <memory>
+#include <random>
 
 #include "predictor.h"
 #include "instance.h"
@@ -107,6 +108,8 @@ namespace MachineLearning
 		, m_weak_leafed   (weak_leafed)
 		, m_lr_type       (lr_type)
 		, m_pruning_factor(pruning_factor)
+		, m_seed(0)
+		, m_quiet(false)
 		{};
 
 		double predict(MathVector<double>& features);
@@ -116,7 +119,13 @@ namespace MachineLearning
 		
 		size_t get_model_complexity();
 
-		Predictor* clone() const { new DecisionTree(*this);};
+		Predictor* clone() const { return new DecisionTree(*this);};
+		bool uses_weights() const { return true;};
+
+		// the predicate of every node is seeded from the tree seed
+		void set_seed(unsigned int seed) { m_seed = seed;};
+		void set_quiet(bool quiet) { m_quiet = quiet;};
+		bool quiet() const { return m_quiet;};
 
 	private:
 		std::shared_ptr<AbstractNode> learn_subtree( std::vector<Instance>& learnSet
@@ -131,6 +140,10 @@ namespace MachineLearning
 		PredictorPtr m_lr_type;
 		double       m_pruning_factor;
 
+		unsigned int m_seed;
+		bool         m_quiet;
+		std::mt19937 m_generator;
+
 		std::vector<std::shared_ptr<AbstractNode>> m_tree;
 	};
 }
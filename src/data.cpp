@@ -20,6 +20,11 @@ Data::Data()
 {
 }
 
+Data::Data(std::pmr::memory_resource* resource)
+: features(resource)
+{
+}
+
 Data::Data(std::vector<std::string> _categories, MathVector<double>& _features)
 : categories(_categories), features(_features)
 {
@@ -52,7 +57,7 @@ double Data::at(size_t index)
 	return this->features.getElement(index);
 }
 
-Instance& Data::toInstance(std::string category, size_t& positive_count, double& blur_factor)
+Instance Data::toInstance(std::string category, size_t& positive_count, double& blur_factor)
 {
 	double goal = -1;
 
@@ -63,12 +68,10 @@ Instance& Data::toInstance(std::string category, size_t& positive_count, double&
 		blur_factor += 1. / this->categories.size();
 	}
 
-	Instance* instance = new Instance(this->features, goal);
-
-	return *instance;
+	return Instance(this->features, goal);
 }
 
-Instance& Data::toLinearInstance(std::string category, size_t& positive_count, double& blur_factor)
+Instance Data::toLinearInstance(std::string category, size_t& positive_count, double& blur_factor)
 {
 	double goal = 0;
 
@@ -79,9 +82,7 @@ Instance& Data::toLinearInstance(std::string category, size_t& positive_count, d
 		blur_factor += 1. / this->categories.size();
 	}
 
-	Instance* instance = new Instance(this->features, goal);
-
-	return *instance;
+	return Instance(this->features, goal);
 }
 
 void Data::parseFrom(std::string _data)
@@ -114,7 +115,7 @@ void Data::parseFrom(std::string _data)
 		not_nulls.insert(position);
 	}
 
-	this->features = *(new MathVector<double>(rawFeatures, not_nulls));
+	this->features = MathVector<double>(rawFeatures, not_nulls, this->features.resource());
 
 	return;
 }
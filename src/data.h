@@ -2,6 +2,7 @@
 #define DATA_H
 
 
+#include <memory_resource>
 #include <vector>
 #include <string.h>
 
@@ -24,11 +25,13 @@ namespace MachineLearning
 	public:
 
 		Data();
+		// the features of the object are allocated from resource
+		explicit Data(std::pmr::memory_resource* resource);
 		Data(std::vector<std::string> _categories, MathVector<double>& _features);
 		Data(std::string _data);
 
-		Instance& toInstance(std::string category, size_t& positive_count, double& blur_factor);
-		Instance& toLinearInstance(std::string category, size_t& positive_count, double& blur_factor);
+		Instance toInstance(std::string category, size_t& positive_count, double& blur_factor);
+		Instance toLinearInstance(std::string category, size_t& positive_count, double& blur_factor);
 		virtual void parseFrom(std::string data);
 
 		std::vector<std::string> getCategories();
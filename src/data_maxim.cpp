@@ -33,6 +33,11 @@ DataMaxim::DataMaxim()
 {
 }
 
+DataMaxim::DataMaxim(std::pmr::memory_resource* resource)
+: Data(resource)
+{
+}
+
 
 void DataMaxim::parseFrom(std::string _data, int feature_count)
 {
@@ -67,7 +72,7 @@ void DataMaxim::parseFrom(std::string _data, int feature_count)
 		featuresValue[position] = atof(feature_values.back().c_str());
 	}
 
-	(this->features) = *(new MathVector<double>(featuresValue));
+	(this->features) = MathVector<double>(featuresValue, this->features.resource());
 
 	this->features.completeWith(feature_count - this->features.getSize(), 0);
 
@@ -2,6 +2,7 @@
 #define DATA_MAXIM_H
 
 
+#include <memory_resource>
 #include <vector>
 #include <string.h>
 
@@ -25,6 +26,7 @@ namespace MachineLearning
 
 			DataMaxim(std::vector<std::string> _categories, MathVector<double>& _features);
 			DataMaxim();
+			explicit DataMaxim(std::pmr::memory_resource* resource);
 
 			void parseFrom(std::string data, int feature_count);
 	};
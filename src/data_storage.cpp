@@ -54,8 +54,8 @@ void DataStorage::parseFromFile(std::string fileName)
 		{
 			string line;
 			std::getline(fin, line);
-			Data data(line);
-			this->datas.push_back(data);
+			Data data(this->arena.resource());
+			data.parseFrom(line);
 
 			double _max = data.featuresSize();
 
@@ -76,6 +76,8 @@ void DataStorage::parseFromFile(std::string fileName)
 					_categories[categories.at(index)] = 1;
 				}
 			}
+
+			this->datas.push_back(std::move(data));
 		}
 	}
 
@@ -99,43 +101,39 @@ void DataStorage::parseFromFile(std::string fileName)
 	return;
 }
 
-Pool& DataStorage::toPool(std::string category, size_t& positive_count, double& blur_factor)
+Pool DataStorage::toPool(std::string category, size_t& positive_count, double& blur_factor)
 {
-	std::vector<Instance>* instances = new std::vector<Instance>();
+	std::vector<Instance> instances;
+	instances.reserve(this->datas.size());
 
 	positive_count = 0;
 	blur_factor = 0.0;
 
 	for (int index = 0; index < this->datas.size(); index++)
 	{
-	  instances->push_back(this->datas.at(index).toInstance(category, positive_count, blur_factor));
+	  instances.push_back(this->datas.at(index).toInstance(category, positive_count, blur_factor));
 	}
 
 	blur_factor /= positive_count;
-	Pool* pool = new Pool(*instances);
-
-	delete instances;
 
-	return *pool;
+	return Pool(std::move(instances));
 }
 
-Pool& DataStorage::toLinearPool(std::string category, size_t& positive_count, double& blur_factor)
+Pool DataStorage::toLinearPool(std::string category, size_t& positive_count, double& blur_factor)
 {
-	std::vector<Instance>* instances = new std::vector<Instance>();
+	std::vector<Instance> instances;
+	instances.reserve(this->datas.size());
 	positive_count = 0;
 	blur_factor = 0.0;
 
 	for (int index = 0; index < this->datas.size(); index++)
 	{
-		instances->push_back(this->datas.at(index).toLinearInstance(category, positive_count, blur_factor));
+		instances.push_back(this->datas.at(index).toLinearInstance(category, positive_count, blur_factor));
 	}
 
 	blur_factor /= positive_count;
-	Pool* pool = new Pool(*instances);
-
-	delete instances;
 
-	return *pool;
+	return Pool(std::move(instances));
 }
 
 std::vector<std::pair<std::string, size_t> > DataStorage::getCategories()
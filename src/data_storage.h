@@ -16,12 +16,18 @@
 #include "pool.h"
 #endif
 
+#include "memory_arena.h"
+
 namespace MachineLearning
 {
 	class DataStorage
 	{
 	protected:
 
+		// features of the objects read from the file live as long as the
+		// storage and are allocated from its arena one after another;
+		// declared before datas, which must be destroyed first
+		Memory::Arena arena;
 		std::vector<Data> datas;
 		std::vector<std::pair<std::string, size_t> > categories;
 
@@ -33,8 +39,8 @@ namespace MachineLearning
 
 		virtual void parseFromFile(std::string fileName);
 
-		Pool& toPool(std::string category, size_t& positive_count, double& blur_factor);
-		Pool& toLinearPool(std::string category, size_t& positive_count, double& blur_factor);
+		Pool toPool(std::string category, size_t& positive_count, double& blur_factor);
+		Pool toLinearPool(std::string category, size_t& positive_count, double& blur_factor);
 
 		std::vector<std::pair<std::string, size_t> > getCategories();
 
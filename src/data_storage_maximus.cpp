@@ -70,9 +70,9 @@ void DataStorageMaximus::parseFromFile(std::string fileName)
 		{
 			string line;
 			std::getline(fin, line);
-			DataMaxim data;
+			DataMaxim data(this->arena.resource());
 			data.parseFrom(line, feature_size);
-			this->datas.push_back(data);
+			this->datas.push_back(std::move(data));
 
 		}
 	}
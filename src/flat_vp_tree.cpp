@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+#include <math.h>
+
+#include "flat_vp_tree.h"
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+#include "memory_arena.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	FlatVpTree::FlatVpTree(std::shared_ptr<MathVectorNorm<double>> distance, unsigned int seed)
+	: m_distance(distance)
+	, m_euclidean(dynamic_cast<EuclideanNorm<double>*>(distance.get()) != nullptr)
+	, m_seed(seed)
+	{ }
+
+	void FlatVpTree::build(const std::vector<Instance>& items)
+	{
+		size_t items_count = items.size();
+
+		m_features.resize(items_count);
+		m_offsets.assign(items_count + 1, 0);
+		for (size_t index = 0; index < items_count; ++index)
+		{
+			m_features[index] = &items[index].getFeatures();
+			size_t not_nulls = 0;
+			for (auto it = m_features[index]->const_fast_begin(); it != m_features[index]->const_fast_end(); ++it)
+				++not_nulls;
+			m_offsets[index + 1] = m_offsets[index] + not_nulls;
+		}
+
+		m_columns.resize(m_offsets[items_count]);
+		m_values.resize(m_offsets[items_count]);
+		m_square_norms.assign(items_count, 0.0);
+#pragma omp parallel for schedule(dynamic, 256)
+		for (size_t index = 0; index < items_count; ++index)
+		{
+			size_t position = m_offsets[index];
+			double square_norm = 0.0;
+			for (auto it = m_features[index]->const_fast_begin(); it != m_features[index]->const_fast_end(); ++it)
+			{
+				m_columns[position] = (uint32_t)it.index();
+				m_values[position] = it.getElem();
+				square_norm += it.getElem() * it.getElem();
+				++position;
+			}
+			m_square_norms[index] = square_norm;
+		}
+
+		// until the tree is built node.item holds the current order of items
+		m_nodes.resize(items_count);
+		for (size_t index = 0; index < items_count; ++index)
+			m_nodes[index] = Node{0.0, (uint32_t)index};
+
+		// large ranges are split one by one with a parallel distance pass,
+		// the independent small subtrees left are then built concurrently
+		std::vector<std::pair<size_t, size_t>> large_ranges(1, std::make_pair((size_t)0, items_count));
+		std::vector<std::pair<size_t, size_t>> small_ranges;
+		while (!large_ranges.empty())
+		{
+			std::pair<size_t, size_t> range = large_ranges.back();
+			large_ranges.pop_back();
+
+			if (range.second - range.first < parallel_build_size)
+			{
+				small_ranges.push_back(range);
+				continue;
+			}
+
+			size_t lower = range.first;
+			size_t upper = range.second;
+			std::minstd_rand generator(m_seed * 2654435761u + (unsigned int)lower + 1);
+			std::swap(m_nodes[lower].item, m_nodes[lower + generator() % (upper - lower)].item);
+
+			uint32_t vantage = m_nodes[lower].item;
+			std::vector<std::pair<double, uint32_t>> distances(upper - lower - 1);
+#pragma omp parallel for schedule(dynamic, 256)
+			for (size_t index = lower + 1; index < upper; ++index)
+				distances[index - lower - 1] = std::make_pair(items_distance(vantage, m_nodes[index].item), m_nodes[index].item);
+
+			size_t median = (lower + upper) / 2;
+			std::nth_element(distances.begin(), distances.begin() + (median - lower - 1), distances.end());
+			for (size_t index = lower + 1; index < upper; ++index)
+				m_nodes[index].item = distances[index - lower - 1].second;
+			m_nodes[lower].threshold = distances[median - lower - 1].first;
+
+			large_ranges.push_back(std::make_pair(lower + 1, median));
+			large_ranges.push_back(std::make_pair(median, upper));
+		}
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (size_t index = 0; index < small_ranges.size(); ++index)
+			build_range(small_ranges[index].first, small_ranges[index].second);
+	}
+
+	void FlatVpTree::build_range(size_t lower, size_t upper)
+	{
+		if (upper - lower <= 1)
+			return;
+
+		std::minstd_rand generator(m_seed * 2654435761u + (unsigned int)lower + 1);
+		std::swap(m_nodes[lower].item, m_nodes[lower + generator() % (upper - lower)].item);
+
+		uint32_t vantage = m_nodes[lower].item;
+		std::vector<std::pair<double, uint32_t>> distances(upper - lower - 1);
+		for (size_t index = lower + 1; index < upper; ++index)
+			distances[index - lower - 1] = std::make_pair(items_distance(vantage, m_nodes[index].item), m_nodes[index].item);
+
+		size_t median = (lower + upper) / 2;
+		std::nth_element(distances.begin(), distances.begin() + (median - lower - 1), distances.end());
+		for (size_t index = lower + 1; index < upper; ++index)
+			m_nodes[index].item = distances[index - lower - 1].second;
+		m_nodes[lower].threshold = distances[median - lower - 1].first;
+
+		build_range(lower + 1, median);
+		build_range(median, upper);
+	}
+
+	void FlatVpTree::search( const MathVector<double>& target
+						   , size_t k
+						   , std::vector<Neighbour>& neighbours) const
+	{
+		neighbours.clear();
+		if (k == 0 || m_nodes.empty())
+			return;
+
+		char buffer[arena_buffer_size];
+		Memory::Arena arena(buffer, sizeof(buffer));
+		Query query(target, arena.resource());
+		if (m_euclidean)
+		{
+			for (auto it = target.const_fast_begin(); it != target.const_fast_end(); ++it)
+			{
+				query.columns.push_back((uint32_t)it.index());
+				query.values.push_back(it.getElem());
+				query.square_norm += it.getElem() * it.getElem();
+			}
+		}
+
+		neighbours.reserve(k);
+		double tau = std::numeric_limits<double>::max();
+		search_range(0, m_nodes.size(), query, k, neighbours, tau);
+		std::sort_heap(neighbours.begin(), neighbours.end());
+	}
+
+	void FlatVpTree::search_range( size_t lower
+								 , size_t upper
+								 , const Query& query
+								 , size_t k
+								 , std::vector<Neighbour>& heap
+								 , double& tau) const
+	{
+		if (lower >= upper)
+			return;
+
+		const Node& node = m_nodes[lower];
+		double dist = query_distance(query, node.item);
+		if (dist < tau)
+		{
+			if (heap.size() == k)
+			{
+				std::pop_heap(heap.begin(), heap.end());
+				heap.pop_back();
+			}
+			heap.push_back(Neighbour{dist, node.item});
+			std::push_heap(heap.begin(), heap.end());
+			if (heap.size() == k)
+				tau = heap.front().distance;
+		}
+
+		if (upper - lower == 1)
+			return;
+
+		size_t median = (lower + upper) / 2;
+		if (dist < node.threshold)
+		{
+			if (dist - tau <= node.threshold)
+				search_range(lower + 1, median, query, k, heap, tau);
+			if (dist + tau >= node.threshold)
+				search_range(median, upper, query, k, heap, tau);
+		}
+		else
+		{
+			if (dist + tau >= node.threshold)
+				search_range(median, upper, query, k, heap, tau);
+			if (dist - tau <= node.threshold)
+				search_range(lower + 1, median, query, k, heap, tau);
+		}
+	}
+
+	double FlatVpTree::sparse_dot( const uint32_t* first_columns, const double* first_values, size_t first_size
+								 , const uint32_t* second_columns, const double* second_values, size_t second_size) const
+	{
+		double dot = 0.0;
+		size_t first = 0;
+		size_t second = 0;
+		while (first < first_size && second < second_size)
+		{
+			if (first_columns[first] == second_columns[second])
+				dot += first_values[first++] * second_values[second++];
+			else if (first_columns[first] < second_columns[second])
+				++first;
+			else
+				++second;
+		}
+
+		return dot;
+	}
+
+	double FlatVpTree::items_distance(uint32_t first, uint32_t second) const
+	{
+		if (!m_euclidean)
+			return m_distance->calc(*m_features[first], *m_features[second]);
+
+		double dot = sparse_dot( m_columns.data() + m_offsets[first], m_values.data() + m_offsets[first], m_offsets[first + 1] - m_offsets[first]
+							   , m_columns.data() + m_offsets[second], m_values.data() + m_offsets[second], m_offsets[second + 1] - m_offsets[second]);
+		return sqrt(std::max(0.0, m_square_norms[first] + m_square_norms[second] - 2.0 * dot));
+	}
+
+	double FlatVpTree::query_distance(const Query& query, uint32_t item) const
+	{
+		if (!m_euclidean)
+			return m_distance->calc(*m_features[item], *query.features);
+
+		double dot = sparse_dot( m_columns.data() + m_offsets[item], m_values.data() + m_offsets[item], m_offsets[item + 1] - m_offsets[item]
+							   , query.columns.data(), query.values.data(), query.columns.size());
+		return sqrt(std::max(0.0, m_square_norms[item] + query.square_norm - 2.0 * dot));
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef FLAT_VP_TREE_H
+#define FLAT_VP_TREE_H
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+#include "memory_arena.h"
+#include "neighbours_index.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	// VP-tree laid out implicitly in one array. The node of the item range
+	// [lower, upper) is stored at position lower, its inner subtree is
+	// [lower + 1, median) and its outer one is [median, upper), so nodes hold
+	// no child pointers and a subtree is a contiguous block visited front to
+	// back. Items are kept as item indexes; the features of all items are
+	// copied into one CSR block together with their squared norms, for the
+	// euclidean norm a distance is then one sparse dot product:
+	// |a - b|^2 = |a|^2 + |b|^2 - 2 * a.b
+	class FlatVpTree : public NeighboursIndex
+	{
+	public:
+		FlatVpTree(std::shared_ptr<MathVectorNorm<double>> distance, unsigned int seed = 0);
+
+		void build(const std::vector<Instance>& items);
+		void search( const MathVector<double>& target
+				   , size_t k
+				   , std::vector<Neighbour>& neighbours) const;
+
+		size_t size() const { return m_nodes.size();};
+		std::string name() const { return "flat_vp_tree";};
+		NeighboursIndex* clone() const { return new FlatVpTree(*this);};
+
+	private:
+		struct Node
+		{
+			double   threshold;
+			uint32_t item;
+		};
+
+		// the sparse copy of the target lives in an arena over a stack
+		// buffer of search
+		struct Query
+		{
+			const MathVector<double>*  features;
+			std::pmr::vector<uint32_t> columns;
+			std::pmr::vector<double>   values;
+			double                     square_norm;
+
+			Query(const MathVector<double>& target, std::pmr::memory_resource* resource)
+			: features(&target)
+			, columns(resource)
+			, values(resource)
+			, square_norm(0.0)
+			{ }
+		};
+
+		double sparse_dot( const uint32_t* first_columns, const double* first_values, size_t first_size
+						 , const uint32_t* second_columns, const double* second_values, size_t second_size) const;
+		double items_distance(uint32_t first, uint32_t second) const;
+		double query_distance(const Query& query, uint32_t item) const;
+
+		void build_range(size_t lower, size_t upper);
+		void search_range( size_t lower
+						 , size_t upper
+						 , const Query& query
+						 , size_t k
+						 , std::vector<Neighbour>& heap
+						 , double& tau) const;
+
+	private:
+		static const size_t parallel_build_size = 4096;
+		static const size_t arena_buffer_size   = 16 * 1024;
+
+		std::shared_ptr<MathVectorNorm<double>> m_distance;
+		bool                                    m_euclidean;
+		unsigned int                            m_seed;
+
+		std::vector<const MathVector<double>*>  m_features;
+		std::vector<size_t>                     m_offsets;
+		std::vector<uint32_t>                   m_columns;
+		std::vector<double>                     m_values;
+		std::vector<double>                     m_square_norms;
+
+		std::vector<Node>                       m_nodes;
+	};
+}
+
+#endif //FLAT_VP_TREE_H
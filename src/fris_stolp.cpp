@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "fris_stolp.h"
+
+#include "instance.h"
+#include "neighbours_list.h"
+
+namespace MachineLearning
+{
+	FrisStolp::FrisStolp(std::vector<Instance>& objects, NeighboursList& neighbours, distance_t distance)
+	: m_objects(objects)
+	, m_neighbours(neighbours)
+	, m_distance(distance)
+	{ }
+
+	std::vector<size_t> FrisStolp::select()
+	{
+		size_t objects_count = m_objects.size();
+		m_positions.resize(objects_count);
+		m_remaining[POSITIVE].clear();
+		m_remaining[NEGATIVE].clear();
+		m_ethalons.clear();
+
+		std::cout << "split objects by classes" << std::endl;
+		for (size_t object = 0; object < objects_count; ++object)
+		{
+			std::vector<size_t>& remaining = m_remaining[object_class(object)];
+			m_positions[object] = remaining.size();
+			remaining.push_back(object);
+		}
+
+		if (m_remaining[POSITIVE].empty() || m_remaining[NEGATIVE].empty())
+		{
+			std::vector<size_t> all_objects(objects_count);
+			for (size_t object = 0; object < objects_count; ++object)
+				all_objects[object] = object;
+			return all_objects;
+		}
+
+		std::cout << "init ethalons" << std::endl;
+		init_nearest_objects();
+		compute_scores();
+		size_t positive_ethalon = most_efficient(POSITIVE);
+		size_t negative_ethalon = most_efficient(NEGATIVE);
+
+		// the first etalons replace all objects as etalons, the distances grow and are set anew
+		remove_object(positive_ethalon);
+		remove_object(negative_ethalon);
+		m_ethalons.push_back(positive_ethalon);
+		m_ethalons.push_back(negative_ethalon);
+		m_nearest[POSITIVE].assign(objects_count, 0.0);
+		m_nearest[NEGATIVE].assign(objects_count, 0.0);
+#pragma omp parallel for schedule(dynamic, 256)
+		for (size_t object = 0; object < objects_count; ++object)
+		{
+			m_nearest[POSITIVE][object] = m_distance(object, positive_ethalon);
+			m_nearest[NEGATIVE][object] = m_distance(object, negative_ethalon);
+		}
+		compute_scores();
+
+		size_t iteration = 0;
+		while (!m_remaining[POSITIVE].empty() || !m_remaining[NEGATIVE].empty())
+		{
+			std::cout << "iteration: " << iteration << std::endl;
+			std::cout << "positive objects: "  << m_remaining[POSITIVE].size() << std::endl
+				      << "negative objects: "  << m_remaining[NEGATIVE].size() << std::endl
+					  << "ethalons: "          << m_ethalons.size()            << std::endl;
+			std::cout << "\tcheck good classified and noise objects" << std::endl;
+			remove_fails();
+
+			std::cout << "find ethalons" << std::endl;
+			positive_ethalon = most_efficient(POSITIVE);
+			negative_ethalon = most_efficient(NEGATIVE);
+			if (positive_ethalon != (size_t)-1)
+				add_ethalon(positive_ethalon);
+			if (negative_ethalon != (size_t)-1)
+				add_ethalon(negative_ethalon);
+
+			iteration++;
+		}
+
+		std::vector<size_t> ethalons(m_ethalons);
+		std::sort(ethalons.begin(), ethalons.end());
+		return ethalons;
+	}
+
+	void FrisStolp::init_nearest_objects()
+	{
+		size_t objects_count = m_objects.size();
+		m_nearest[POSITIVE].assign(objects_count, std::numeric_limits<double>::max());
+		m_nearest[NEGATIVE].assign(objects_count, std::numeric_limits<double>::max());
+
+#pragma omp parallel for schedule(dynamic, 64)
+		for (size_t object = 0; object < objects_count; ++object)
+		{
+			// the list is sorted, the first listed object of a class is its nearest one
+			bool found[2] = {false, false};
+			for (const NeighboursList::Neighbour* it = m_neighbours.begin(object); it != m_neighbours.end(object); ++it)
+			{
+				size_t neighbour_class = it->goal == 1.0f ? POSITIVE : NEGATIVE;
+				if (!found[neighbour_class])
+				{
+					m_nearest[neighbour_class][object] = it->distance;
+					found[neighbour_class] = true;
+				}
+				if (found[POSITIVE] && found[NEGATIVE])
+					break;
+			}
+
+			for (size_t neighbour_class = POSITIVE; neighbour_class <= NEGATIVE; ++neighbour_class)
+			{
+				if (found[neighbour_class])
+					continue;
+				for (size_t other: m_remaining[neighbour_class])
+				{
+					if (other != object)
+						m_nearest[neighbour_class][object] = std::min(m_nearest[neighbour_class][object], m_distance(object, other));
+				}
+			}
+		}
+	}
+
+	void FrisStolp::compute_scores()
+	{
+		m_own_scores.assign(m_objects.size(), 0.0);
+		m_other_scores.assign(m_objects.size(), 0.0);
+
+		for (size_t candidate_class = POSITIVE; candidate_class <= NEGATIVE; ++candidate_class)
+		{
+			const std::vector<size_t>& candidates = m_remaining[candidate_class];
+			const std::vector<double>& nearest    = m_nearest[1 - candidate_class];
+#pragma omp parallel for schedule(dynamic, 16)
+			for (size_t index = 0; index < candidates.size(); ++index)
+			{
+				size_t candidate = candidates[index];
+				for (size_t current_class = POSITIVE; current_class <= NEGATIVE; ++current_class)
+				{
+					double score = 0.0;
+					for (size_t object: m_remaining[current_class])
+					{
+						if (object != candidate)
+							score += fris(m_distance(object, candidate), nearest[object]);
+					}
+
+					if (current_class == candidate_class)
+						m_own_scores[candidate] = score;
+					else
+						m_other_scores[candidate] = score;
+				}
+			}
+		}
+	}
+
+	double FrisStolp::efficiency(size_t candidate) const
+	{
+		size_t candidate_class = object_class(candidate);
+		size_t own_count   = m_remaining[candidate_class].size();
+		size_t other_count = m_remaining[1 - candidate_class].size();
+
+		double defense = m_own_scores[candidate];
+		if (own_count > 1)
+			defense /= (double)(own_count - 1);
+		double tolerance = m_other_scores[candidate];
+		if (other_count > 0)
+			tolerance /= (double)other_count;
+		return 0.5 * defense + 0.5 * tolerance;
+	}
+
+	size_t FrisStolp::most_efficient(size_t candidates_class) const
+	{
+		size_t most_efficient_object = (size_t)-1;
+		double most_efficiency = -10.0;
+		for (size_t candidate: m_remaining[candidates_class])
+		{
+			double candidate_efficiency = efficiency(candidate);
+			if (candidate_efficiency >= most_efficiency)
+			{
+				most_efficient_object = candidate;
+				most_efficiency = candidate_efficiency;
+			}
+		}
+
+		return most_efficient_object;
+	}
+
+	void FrisStolp::remove_object(size_t object)
+	{
+		size_t removed_class = object_class(object);
+		std::vector<size_t>& remaining = m_remaining[removed_class];
+		size_t position = m_positions[object];
+		remaining[position] = remaining.back();
+		m_positions[remaining[position]] = position;
+		remaining.pop_back();
+
+		// the object no longer counts in the efficiency of any candidate
+		for (size_t candidate_class = POSITIVE; candidate_class <= NEGATIVE; ++candidate_class)
+		{
+			const std::vector<size_t>& candidates = m_remaining[candidate_class];
+			double nearest = m_nearest[1 - candidate_class][object];
+			std::vector<double>& scores = candidate_class == removed_class ? m_own_scores : m_other_scores;
+#pragma omp parallel for schedule(static)
+			for (size_t index = 0; index < candidates.size(); ++index)
+				scores[candidates[index]] -= fris(m_distance(object, candidates[index]), nearest);
+		}
+	}
+
+	void FrisStolp::add_ethalon(size_t ethalon)
+	{
+		remove_object(ethalon);
+		m_ethalons.push_back(ethalon);
+
+		size_t ethalon_class = object_class(ethalon);
+		std::vector<size_t> objects(m_remaining[POSITIVE]);
+		objects.insert(objects.end(), m_remaining[NEGATIVE].begin(), m_remaining[NEGATIVE].end());
+
+		std::vector<double> distances(objects.size());
+#pragma omp parallel for schedule(static)
+		for (size_t index = 0; index < objects.size(); ++index)
+			distances[index] = m_distance(objects[index], ethalon);
+
+		// an object closer to the new etalon than to the previous ones changes
+		// its FRiS for the candidates of the opposite class only
+		std::vector<double>& nearest = m_nearest[ethalon_class];
+		std::vector<size_t> changed;
+		for (size_t index = 0; index < objects.size(); ++index)
+		{
+			if (distances[index] < nearest[objects[index]])
+				changed.push_back(index);
+		}
+
+		// every candidate takes the changes of all objects in one pass, in
+		// the order of the objects, and is written by its own thread only
+		const std::vector<size_t>& candidates = m_remaining[1 - ethalon_class];
+		std::vector<double>& own_scores   = m_own_scores;
+		std::vector<double>& other_scores = m_other_scores;
+#pragma omp parallel for schedule(static)
+		for (size_t position = 0; position < candidates.size(); ++position)
+		{
+			size_t candidate = candidates[position];
+			for (size_t index: changed)
+			{
+				size_t object = objects[index];
+				if (candidate == object)
+					continue;
+				double dist = m_distance(object, candidate);
+				double delta = fris(dist, distances[index]) - fris(dist, nearest[object]);
+				if (object_class(object) == 1 - ethalon_class)
+					own_scores[candidate] += delta;
+				else
+					other_scores[candidate] += delta;
+			}
+		}
+
+		for (size_t index: changed)
+			nearest[objects[index]] = distances[index];
+	}
+
+	void FrisStolp::remove_fails()
+	{
+		std::vector<size_t> failes;
+		for (size_t current_class = POSITIVE; current_class <= NEGATIVE; ++current_class)
+		{
+			const std::vector<size_t>& objects = m_remaining[current_class];
+			std::vector<double> objects_fris(objects.size());
+			double max_fris = 0.0;
+			double min_fris = 2.0;
+			for (size_t index = 0; index < objects.size(); ++index)
+			{
+				size_t object = objects[index];
+				objects_fris[index] = fris(m_nearest[current_class][object], m_nearest[1 - current_class][object]);
+				max_fris = std::max(max_fris, objects_fris[index]);
+				min_fris = std::min(min_fris, objects_fris[index]);
+			}
+
+			double mean_fris = (max_fris - min_fris) / 2;
+			std::cout << max_fris << " " << mean_fris << " " << min_fris << " " << objects.size() << std::endl;
+			double true_treshold = std::min(1.8, max_fris - 0.05 * mean_fris);
+			double fail_treshold = std::max(0.2, 0.05 * mean_fris + min_fris);
+			for (size_t index = 0; index < objects.size(); ++index)
+			{
+				if (objects_fris[index] <= fail_treshold || objects_fris[index] >= true_treshold)
+					failes.push_back(objects[index]);
+			}
+		}
+
+		std::cout << "\t\tcount: " << failes.size() << std::endl;
+		for (size_t object: failes)
+			remove_object(object);
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef FRIS_STOLP_H
+#define FRIS_STOLP_H
+
+#include <functional>
+#include <vector>
+
+#include "instance.h"
+#include "neighbours_list.h"
+
+namespace MachineLearning
+{
+	// FRiS-STOLP selection of etalon objects. For every not selected object
+	// the distances to the nearest positive and to the nearest negative
+	// etalon are kept and only lowered when an etalon is added. Candidate
+	// efficiencies are kept as sums of FRiS values over the not selected
+	// objects and are corrected when an object leaves the selection or when
+	// its nearest etalon changes, so an iteration costs one distance per
+	// affected (object, candidate) pair instead of rescoring all pairs.
+	// Not selected objects of each class are stored in dense index arrays
+	// and the corrections run in parallel over them.
+	class FrisStolp
+	{
+	public:
+		typedef std::function<double(size_t first, size_t second)> distance_t;
+
+	public:
+		FrisStolp(std::vector<Instance>& objects, NeighboursList& neighbours, distance_t distance);
+
+		// indexes of the etalons sorted ascending
+		std::vector<size_t> select();
+
+	private:
+		enum Class
+		{
+			POSITIVE = 0,
+			NEGATIVE = 1
+		};
+
+		static double fris(double own_distance, double other_distance)
+		{
+			if (own_distance + other_distance <= 0.0)
+				return 1.0;
+			return (other_distance - own_distance) / (own_distance + other_distance) + 1.0;
+		}
+
+		size_t object_class(size_t object) const { return m_objects[object].getGoal() == 1.0 ? POSITIVE : NEGATIVE;};
+
+		// before the first etalons every object of a class is its etalon
+		void init_nearest_objects();
+		void compute_scores();
+		double efficiency(size_t candidate) const;
+		size_t most_efficient(size_t candidates_class) const;
+
+		void remove_object(size_t object);
+		void add_ethalon(size_t ethalon);
+		void remove_fails();
+
+	private:
+		std::vector<Instance>& m_objects;
+		NeighboursList&        m_neighbours;
+		distance_t             m_distance;
+
+		// not selected objects of every class and the position of an object in its array
+		std::vector<size_t>    m_remaining[2];
+		std::vector<size_t>    m_positions;
+		std::vector<size_t>    m_ethalons;
+
+		// distance from an object to the nearest etalon of a class
+		std::vector<double>    m_nearest[2];
+
+		// FRiS sums of a candidate over the not selected objects of its own
+		// and of the other class, every object x is measured against the
+		// etalon nearest to x from the class opposite to the candidate
+		std::vector<double>    m_own_scores;
+		std::vector<double>    m_other_scores;
+	};
+}
+
+#endif //FRIS_STOLP_H
@@ -0,0 +1,506 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <memory_resource>
+#include <random>
+#include <vector>
+#include <math.h>
+
+#include "gradient_boosting.h"
+
+#include "predictor.h"
+#include "instance.h"
+#include "metric.h"
+#include "loss_function_approximation.h"
+#include "memory_arena.h"
+
+#include "mathvector.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+
+namespace MachineLearning
+{
+	GradientBoosting::GradientBoosting( size_t _featuresCount
+									  , size_t trees_count
+									  , double shrinkage
+									  , size_t max_leaves
+									  , size_t max_bins
+									  , double row_fraction
+									  , double feature_fraction
+									  , double l2_regular
+									  , size_t min_leaf_objects)
+	: Predictor(_featuresCount)
+	, m_trees_count(trees_count)
+	, m_shrinkage(shrinkage)
+	, m_max_leaves(std::max((size_t)2, max_leaves))
+	, m_max_bins(std::min((size_t)256, std::max((size_t)2, max_bins)))
+	, m_row_fraction(row_fraction)
+	, m_feature_fraction(feature_fraction)
+	, m_l2_regular(l2_regular)
+	, m_min_leaf_objects(min_leaf_objects)
+	, m_loss(new LogisticLossFunction())
+	, m_base_score(0.0)
+	, m_columns_count(0)
+	{ }
+
+	double GradientBoosting::predict(MathVector<double>& features)
+	{
+		// the features are looked up once, not at every node of every tree
+		thread_local std::vector<double> row;
+		row.resize(m_columns_count);
+		dense_row(features, row.data());
+
+		double score = m_base_score;
+		for (size_t tree_index = 0; tree_index < m_flat_roots.size(); ++tree_index)
+			score += flat_tree_score(tree_index, row.data());
+
+		return score > 0.0 ? 1.0 : -1.0;
+	}
+
+	void GradientBoosting::predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions)
+	{
+		predictions.assign(objects.size(), m_base_score);
+		size_t blocks_count = (objects.size() + predict_block_size - 1) / predict_block_size;
+
+#pragma omp parallel
+		{
+			std::vector<double> rows(predict_block_size * m_columns_count);
+#pragma omp for schedule(dynamic)
+			for (size_t block = 0; block < blocks_count; ++block)
+			{
+				size_t begin = block * predict_block_size;
+				size_t end   = std::min(objects.size(), begin + predict_block_size);
+				for (size_t obj_index = begin; obj_index < end; ++obj_index)
+					dense_row(objects[obj_index].getFeatures(), rows.data() + (obj_index - begin) * m_columns_count);
+
+				// a tree stays in cache while the whole block walks it
+				for (size_t tree_index = 0; tree_index < m_flat_roots.size(); ++tree_index)
+				{
+					for (size_t obj_index = begin; obj_index < end; ++obj_index)
+						predictions[obj_index] += flat_tree_score(tree_index, rows.data() + (obj_index - begin) * m_columns_count);
+				}
+				for (size_t obj_index = begin; obj_index < end; ++obj_index)
+					predictions[obj_index] = predictions[obj_index] > 0.0 ? 1.0 : -1.0;
+			}
+		}
+	}
+
+	void GradientBoosting::learn( std::vector<Instance>& learnSet
+								, std::vector<double>& objectsWeights
+								, std::vector<std::pair<double, double>>& learning_curve)
+	{
+		if (objectsWeights.empty())
+			objectsWeights = std::vector<double>(learnSet.size(), 1.0 / (double)learnSet.size());
+
+		size_t objects_count = learnSet.size();
+		std::cout << "quantize features" << std::endl;
+		build_bins(learnSet);
+		size_t features_count = m_bin_bounds.size();
+
+		double positive_weight = 0.0;
+		double negative_weight = 0.0;
+		for (size_t row = 0; row < objects_count; ++row)
+		{
+			if (learnSet[row].getGoal() == 1.0)
+				positive_weight += objectsWeights[row];
+			else
+				negative_weight += objectsWeights[row];
+		}
+		m_base_score = (positive_weight > 0.0 && negative_weight > 0.0) ? log(positive_weight / negative_weight) : 0.0;
+
+		m_trees.clear();
+		std::vector<double> scores(objects_count, m_base_score);
+		std::vector<double> gradients(objects_count, 0.0);
+		std::vector<double> hessians(objects_count, 0.0);
+
+		std::random_device rd;
+		std::mt19937 gen(rd());
+		std::bernoulli_distribution row_sampler(m_row_fraction);
+		std::bernoulli_distribution feature_sampler(m_feature_fraction);
+
+		for (size_t tree_index = 0; tree_index < m_trees_count; ++tree_index)
+		{
+#pragma omp parallel for
+			for (size_t row = 0; row < objects_count; ++row)
+			{
+				double goal       = learnSet[row].getGoal();
+				double importance = objectsWeights[row] * objects_count;
+				double margin     = goal * scores[row];
+				gradients[row] = importance * goal * m_loss->dx(margin);
+				hessians[row]  = importance * m_loss->dx2(margin);
+			}
+
+			std::vector<size_t> rows;
+			rows.reserve(objects_count);
+			for (size_t row = 0; row < objects_count; ++row)
+			{
+				if (objectsWeights[row] > 0.0 && (m_row_fraction >= 1.0 || row_sampler(gen)))
+					rows.push_back(row);
+			}
+
+			std::vector<char> allowed_features(features_count, 1);
+			if (m_feature_fraction < 1.0)
+				for (size_t feature = 0; feature < features_count; ++feature)
+					allowed_features[feature] = feature_sampler(gen);
+
+			tree_t tree = grow_tree(rows, gradients, hessians, allowed_features);
+
+			double logloss = 0.0;
+			double rmse    = 0.0;
+#pragma omp parallel for reduction(+:logloss,rmse)
+			for (size_t row = 0; row < objects_count; ++row)
+			{
+				scores[row] += apply_binned(tree, row);
+				double goal = learnSet[row].getGoal();
+				logloss = logloss + m_loss->calc(goal * scores[row]);
+				rmse    = rmse + Metrics::RMSE(goal, 2.0 / (1.0 + std::exp(-scores[row])) - 1.0);
+			}
+
+			learning_curve.push_back(std::make_pair(logloss / objects_count, rmse / objects_count));
+			if ((tree_index + 1) % 10 == 0)
+				std::cout << "trees: " << tree_index + 1 << " leaves: " << (tree.size() + 1) / 2
+				          << " logloss: " << logloss / objects_count << std::endl;
+			m_trees.push_back(std::move(tree));
+		}
+
+		m_bin_bounds.clear();
+		m_bin_offsets.clear();
+		m_zero_bins.clear();
+		std::vector<size_t>().swap(m_row_offsets);
+		std::vector<BinnedEntry>().swap(m_entries);
+		compile_trees();
+
+		std::cout << "learning finished"  << std::endl
+		          << "\t     trees count: " << m_trees.size()         << std::endl
+				  << "\tmodel complexity: " << get_model_complexity() << std::endl;
+	}
+
+	void GradientBoosting::compile_trees()
+	{
+		m_feature_columns.clear();
+		m_columns_count = 0;
+		m_flat_nodes.clear();
+		m_flat_roots.clear();
+
+		for (const tree_t& tree: m_trees)
+		{
+			size_t root = m_flat_nodes.size();
+			m_flat_roots.push_back(root);
+			for (const TreeNode& node: tree)
+			{
+				FlatNode flat{node.value, 0, -1, -1};
+				if (node.left >= 0)
+				{
+					if (node.feature >= m_feature_columns.size())
+						m_feature_columns.resize(node.feature + 1, -1);
+					if (m_feature_columns[node.feature] < 0)
+						m_feature_columns[node.feature] = (int)m_columns_count++;
+
+					flat.threshold = node.threshold;
+					flat.column    = (uint32_t)m_feature_columns[node.feature];
+					flat.left      = (int32_t)(root + node.left);
+					flat.right     = (int32_t)(root + node.right);
+				}
+				m_flat_nodes.push_back(flat);
+			}
+		}
+	}
+
+	void GradientBoosting::dense_row(const MathVector<double>& features, double* row) const
+	{
+		std::fill(row, row + m_columns_count, 0.0);
+		for (auto it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
+		{
+			if (it.index() < m_feature_columns.size() && m_feature_columns[it.index()] >= 0)
+				row[m_feature_columns[it.index()]] = it.getElem();
+		}
+	}
+
+	double GradientBoosting::flat_tree_score(size_t tree_index, const double* row) const
+	{
+		const FlatNode* nodes = m_flat_nodes.data();
+		size_t node = m_flat_roots[tree_index];
+		while (nodes[node].left >= 0)
+			node = row[nodes[node].column] <= nodes[node].threshold ? nodes[node].left : nodes[node].right;
+
+		return nodes[node].threshold;
+	}
+
+	size_t GradientBoosting::get_model_complexity()
+	{
+		size_t model_complexity = 0;
+		for (const tree_t& tree: m_trees)
+			model_complexity += tree.size();
+
+		return model_complexity;
+	}
+
+	void GradientBoosting::build_bins(std::vector<Instance>& learnSet)
+	{
+		size_t objects_count  = learnSet.size();
+		size_t features_count = learnSet.front().getFeatures().getSize();
+
+		std::vector<std::vector<double>> values(features_count);
+		for (Instance& object: learnSet)
+		{
+			MathVector<double>::const_fast_iterator it  = object.getFeatures().const_fast_begin();
+			MathVector<double>::const_fast_iterator end = object.getFeatures().const_fast_end();
+			for (; it != end; ++it)
+				values[it.index()].push_back(it.getElem());
+		}
+
+		m_bin_bounds.assign(features_count, std::vector<double>());
+		m_zero_bins.assign(features_count, 0);
+#pragma omp parallel for schedule(dynamic, 64)
+		for (size_t feature = 0; feature < features_count; ++feature)
+		{
+			std::vector<double>& feature_values = values[feature];
+			std::sort(feature_values.begin(), feature_values.end());
+
+			// distinct values with their counts; absent entries are zeros
+			size_t zeros = objects_count - feature_values.size();
+			std::vector<std::pair<double, size_t>> distinct;
+			bool zero_added = (zeros == 0);
+			for (double value: feature_values)
+			{
+				if (!zero_added && value >= 0.0)
+				{
+					distinct.push_back(std::make_pair(0.0, zeros));
+					zero_added = true;
+				}
+				if (!distinct.empty() && distinct.back().first == value)
+					distinct.back().second++;
+				else
+					distinct.push_back(std::make_pair(value, (size_t)1));
+			}
+			if (!zero_added)
+				distinct.push_back(std::make_pair(0.0, zeros));
+			std::vector<double>().swap(feature_values);
+
+			std::vector<double>& bounds = m_bin_bounds[feature];
+			double per_bin = (double)objects_count / (double)m_max_bins;
+			double accumulated = 0.0;
+			for (size_t index = 0; index + 1 < distinct.size() && bounds.size() + 1 < m_max_bins; ++index)
+			{
+				accumulated += distinct[index].second;
+				if (distinct.size() <= m_max_bins || accumulated >= per_bin)
+				{
+					bounds.push_back((distinct[index].first + distinct[index + 1].first) / 2.0);
+					accumulated = 0.0;
+				}
+			}
+			bounds.push_back(std::numeric_limits<double>::max());
+			m_zero_bins[feature] = std::lower_bound(bounds.begin(), bounds.end(), 0.0) - bounds.begin();
+		}
+
+		m_bin_offsets.assign(features_count + 1, 0);
+		for (size_t feature = 0; feature < features_count; ++feature)
+			m_bin_offsets[feature + 1] = m_bin_offsets[feature] + m_bin_bounds[feature].size();
+
+		m_row_offsets.assign(objects_count + 1, 0);
+		for (size_t row = 0; row < objects_count; ++row)
+			m_row_offsets[row + 1] = m_row_offsets[row] + learnSet[row].getNotNullFeaturesSize();
+
+		m_entries.resize(m_row_offsets.back());
+#pragma omp parallel for
+		for (size_t row = 0; row < objects_count; ++row)
+		{
+			size_t entry = m_row_offsets[row];
+			MathVector<double>::const_fast_iterator it  = learnSet[row].getFeatures().const_fast_begin();
+			MathVector<double>::const_fast_iterator end = learnSet[row].getFeatures().const_fast_end();
+			for (; it != end; ++it, ++entry)
+			{
+				const std::vector<double>& bounds = m_bin_bounds[it.index()];
+				m_entries[entry].feature = (uint32_t)it.index();
+				m_entries[entry].bin     = (uint8_t)(std::lower_bound(bounds.begin(), bounds.end(), it.getElem()) - bounds.begin());
+			}
+		}
+	}
+
+	size_t GradientBoosting::row_bin(size_t row, size_t feature) const
+	{
+		const BinnedEntry* begin = m_entries.data() + m_row_offsets[row];
+		const BinnedEntry* end   = m_entries.data() + m_row_offsets[row + 1];
+		const BinnedEntry* found = std::lower_bound(begin, end, feature,
+		[](const BinnedEntry& entry, size_t value)
+		{
+			return entry.feature < value;
+		});
+
+		if (found != end && found->feature == feature)
+			return found->bin;
+		return m_zero_bins[feature];
+	}
+
+	void GradientBoosting::build_histogram( const std::pmr::vector<size_t>& rows
+										  , const std::vector<double>& gradients
+										  , const std::vector<double>& hessians
+										  , histogram_t& histogram) const
+	{
+		// only non-zero entries are accumulated, zero bins are restored
+		// from the node totals in find_split
+		size_t bins_count = m_bin_offsets.back();
+		histogram.assign(bins_count, BinStatistics{0.0, 0.0, 0.0});
+#pragma omp parallel if(rows.size() > 4096)
+		{
+			histogram_t local(bins_count, BinStatistics{0.0, 0.0, 0.0});
+#pragma omp for nowait
+			for (size_t index = 0; index < rows.size(); ++index)
+			{
+				size_t row = rows[index];
+				BinStatistics statistics {gradients[row], hessians[row], 1.0};
+				for (size_t entry = m_row_offsets[row]; entry < m_row_offsets[row + 1]; ++entry)
+					local[m_bin_offsets[m_entries[entry].feature] + m_entries[entry].bin].add(statistics);
+			}
+#pragma omp critical
+			for (size_t bin = 0; bin < bins_count; ++bin)
+				histogram[bin].add(local[bin]);
+		}
+	}
+
+	double GradientBoosting::leaf_score(const BinStatistics& statistics) const
+	{
+		return statistics.gradient * statistics.gradient / (statistics.hessian + m_l2_regular);
+	}
+
+	GradientBoosting::Split GradientBoosting::find_split( const histogram_t& histogram
+														, const BinStatistics& total
+														, const std::vector<char>& allowed_features) const
+	{
+		Split best {0, 0, 0.0, BinStatistics{0.0, 0.0, 0.0}};
+		double parent_score = leaf_score(total);
+		size_t features_count = m_bin_bounds.size();
+#pragma omp parallel
+		{
+			Split local_best = best;
+#pragma omp for nowait schedule(dynamic, 256)
+			for (size_t feature = 0; feature < features_count; ++feature)
+			{
+				size_t bins_count = m_bin_bounds[feature].size();
+				if (!allowed_features[feature] || bins_count < 2)
+					continue;
+
+				const BinStatistics* bins = histogram.data() + m_bin_offsets[feature];
+				BinStatistics zeros = total;
+				for (size_t bin = 0; bin < bins_count; ++bin)
+					zeros.subtract(bins[bin]);
+
+				BinStatistics left {0.0, 0.0, 0.0};
+				for (size_t bin = 0; bin + 1 < bins_count; ++bin)
+				{
+					left.add(bins[bin]);
+					if (bin == m_zero_bins[feature])
+						left.add(zeros);
+
+					BinStatistics right = total;
+					right.subtract(left);
+					if (left.count < m_min_leaf_objects || right.count < m_min_leaf_objects)
+						continue;
+
+					double gain = leaf_score(left) + leaf_score(right) - parent_score;
+					if (gain > local_best.gain)
+						local_best = Split {feature, bin, gain, left};
+				}
+			}
+#pragma omp critical
+			if (local_best.gain > best.gain || (local_best.gain == best.gain && local_best.feature < best.feature))
+				best = local_best;
+		}
+
+		return best;
+	}
+
+	GradientBoosting::tree_t GradientBoosting::grow_tree( const std::vector<size_t>& rows
+														, const std::vector<double>& gradients
+														, const std::vector<double>& hessians
+														, const std::vector<char>& allowed_features)
+	{
+		const TreeNode leaf_node {0, 0, 0.0, -1, -1, 0.0};
+		tree_t tree(1, leaf_node);
+		Memory::PoolArena arena;
+		std::vector<Leaf> leaves;
+		leaves.reserve(m_max_leaves);
+		leaves.emplace_back(arena.resource());
+
+		leaves[0].node  = 0;
+		leaves[0].rows.assign(rows.begin(), rows.end());
+		leaves[0].total = BinStatistics{0.0, 0.0, 0.0};
+		for (size_t row: rows)
+			leaves[0].total.add(BinStatistics{gradients[row], hessians[row], 1.0});
+		build_histogram(leaves[0].rows, gradients, hessians, leaves[0].histogram);
+		leaves[0].best = find_split(leaves[0].histogram, leaves[0].total, allowed_features);
+
+		while (leaves.size() < m_max_leaves)
+		{
+			size_t split_leaf = leaves.size();
+			double split_gain = 0.0;
+			for (size_t index = 0; index < leaves.size(); ++index)
+			{
+				if (leaves[index].best.gain > split_gain)
+				{
+					split_leaf = index;
+					split_gain = leaves[index].best.gain;
+				}
+			}
+			if (split_leaf == leaves.size())
+				break;
+
+			Leaf parent = std::move(leaves[split_leaf]);
+			const Split& split = parent.best;
+
+			int left_node  = (int)tree.size();
+			int right_node = left_node + 1;
+			tree[parent.node].feature   = split.feature;
+			tree[parent.node].bin       = split.bin;
+			tree[parent.node].threshold = m_bin_bounds[split.feature][split.bin];
+			tree[parent.node].left      = left_node;
+			tree[parent.node].right     = right_node;
+			tree.push_back(leaf_node);
+			tree.push_back(leaf_node);
+
+			Leaf left(arena.resource());
+			Leaf right(arena.resource());
+			left.node  = left_node;
+			right.node = right_node;
+			for (size_t row: parent.rows)
+				(row_bin(row, split.feature) <= split.bin ? left.rows : right.rows).push_back(row);
+			left.total  = split.left;
+			right.total = parent.total;
+			right.total.subtract(split.left);
+
+			Leaf& smaller = left.rows.size() <= right.rows.size() ? left  : right;
+			Leaf& larger  = left.rows.size() <= right.rows.size() ? right : left;
+			build_histogram(smaller.rows, gradients, hessians, smaller.histogram);
+			larger.histogram = std::move(parent.histogram);
+#pragma omp parallel for
+			for (size_t bin = 0; bin < larger.histogram.size(); ++bin)
+				larger.histogram[bin].subtract(smaller.histogram[bin]);
+
+			for (Leaf* child: {&left, &right})
+			{
+				child->best = find_split(child->histogram, child->total, allowed_features);
+				if (child->best.gain <= 0.0)
+					histogram_t(child->histogram.get_allocator()).swap(child->histogram);
+			}
+
+			leaves[split_leaf] = std::move(left);
+			leaves.push_back(std::move(right));
+		}
+
+		for (const Leaf& leaf: leaves)
+			tree[leaf.node].value = -m_shrinkage * leaf.total.gradient / (leaf.total.hessian + m_l2_regular);
+
+		return tree;
+	}
+
+	double GradientBoosting::apply_binned(const tree_t& tree, size_t row) const
+	{
+		int node = 0;
+		while (tree[node].left >= 0)
+		{
+			node = row_bin(row, tree[node].feature) <= tree[node].bin ? tree[node].left : tree[node].right;
+		}
+
+		return tree[node].value;
+	}
+}
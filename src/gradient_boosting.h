@@ -0,0 +1,180 @@
+#ifndef GRADIENT_BOOSTING_H
+#define GRADIENT_BOOSTING_H
+
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <stdint.h>
+
+#include "predictor.h"
+#include "instance.h"
+#include "metric.h"
+#include "loss_function_approximation.h"
+#include "memory_arena.h"
+
+#include "mathvector.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+
+namespace MachineLearning
+{
+	// Gradient boosted trees on logistic loss. Features are quantized once per
+	// learn into at most max_bins bins, trees are grown leaf-wise over
+	// gradient/hessian histograms, and the histogram of the larger child is
+	// obtained by subtracting the smaller one from its parent. Object lists
+	// and histograms of the leaves come from an arena of the tree, where
+	// those of split leaves are reused by the next ones.
+	class GradientBoosting : public Predictor
+	{
+	public:
+		GradientBoosting( size_t _featuresCount
+						, size_t trees_count      = 100
+						, double shrinkage        = 0.1
+						, size_t max_leaves       = 31
+						, size_t max_bins         = 32
+						, double row_fraction     = 1.0
+						, double feature_fraction = 1.0
+						, double l2_regular       = 1.0
+						, size_t min_leaf_objects = 20);
+
+		double predict(MathVector<double>& features);
+		void predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions);
+		void learn( std::vector<Instance>& learnSet
+				  , std::vector<double>& objectsWeights
+				  , std::vector<std::pair<double, double>>& learning_curve);
+
+		size_t get_model_complexity();
+
+		Predictor* clone() const { return new GradientBoosting(*this);};
+		bool uses_weights() const { return true;};
+
+	private:
+		struct TreeNode
+		{
+			size_t feature;
+			size_t bin;
+			double threshold;
+			int    left;
+			int    right;
+			double value;
+		};
+		typedef std::vector<TreeNode> tree_t;
+
+		// node of the trees compiled for prediction: all trees share one
+		// array, children are absolute positions in it, a leaf has left < 0
+		// and keeps its value in place of the threshold, and features are
+		// columns of the dense rows holding only the features split on
+		struct FlatNode
+		{
+			double   threshold;
+			uint32_t column;
+			int32_t  left;
+			int32_t  right;
+		};
+
+		struct BinnedEntry
+		{
+			uint32_t feature;
+			uint8_t  bin;
+		};
+
+		struct BinStatistics
+		{
+			double gradient;
+			double hessian;
+			double count;
+
+			void add(const BinStatistics& other)
+			{
+				gradient += other.gradient;
+				hessian  += other.hessian;
+				count    += other.count;
+			}
+
+			void subtract(const BinStatistics& other)
+			{
+				gradient -= other.gradient;
+				hessian  -= other.hessian;
+				count    -= other.count;
+			}
+		};
+		typedef std::pmr::vector<BinStatistics> histogram_t;
+
+		struct Split
+		{
+			size_t        feature;
+			size_t        bin;
+			double        gain;
+			BinStatistics left;
+		};
+
+		struct Leaf
+		{
+			int                      node;
+			std::pmr::vector<size_t> rows;
+			histogram_t              histogram;
+			BinStatistics            total;
+			Split                    best;
+
+			Leaf(std::pmr::memory_resource* resource)
+			: node(0)
+			, rows(resource)
+			, histogram(resource)
+			{ }
+		};
+
+	private:
+		void build_bins(std::vector<Instance>& learnSet);
+		size_t row_bin(size_t row, size_t feature) const;
+
+		void build_histogram( const std::pmr::vector<size_t>& rows
+							, const std::vector<double>& gradients
+							, const std::vector<double>& hessians
+							, histogram_t& histogram) const;
+		Split find_split( const histogram_t& histogram
+						, const BinStatistics& total
+						, const std::vector<char>& allowed_features) const;
+		double leaf_score(const BinStatistics& statistics) const;
+
+		tree_t grow_tree( const std::vector<size_t>& rows
+						, const std::vector<double>& gradients
+						, const std::vector<double>& hessians
+						, const std::vector<char>& allowed_features);
+		double apply_binned(const tree_t& tree, size_t row) const;
+
+		void compile_trees();
+		void dense_row(const MathVector<double>& features, double* row) const;
+		double flat_tree_score(size_t tree_index, const double* row) const;
+
+	private:
+		size_t m_trees_count;
+		double m_shrinkage;
+		size_t m_max_leaves;
+		size_t m_max_bins;
+		double m_row_fraction;
+		double m_feature_fraction;
+		double m_l2_regular;
+		size_t m_min_leaf_objects;
+
+		std::shared_ptr<LogisticLossFunction> m_loss;
+
+		double              m_base_score;
+		std::vector<tree_t> m_trees;
+
+		static const size_t predict_block_size = 256;
+
+		std::vector<FlatNode> m_flat_nodes;
+		std::vector<size_t>   m_flat_roots;
+		std::vector<int>      m_feature_columns;
+		size_t                m_columns_count;
+
+		// quantization of the current learn set, released after learning
+		std::vector<std::vector<double>> m_bin_bounds;
+		std::vector<size_t>              m_bin_offsets;
+		std::vector<size_t>              m_zero_bins;
+		std::vector<size_t>              m_row_offsets;
+		std::vector<BinnedEntry>         m_entries;
+	};
+}
+
+#endif //GRADIENT_BOOSTING_H
@@ -0,0 +1,434 @@
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include <math.h>
+
+#include "hnsw_index.h"
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+#include "memory_arena.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	HnswIndex::HnswIndex( std::shared_ptr<MathVectorNorm<double>> distance
+						, size_t m
+						, size_t ef_construction
+						, size_t ef_search
+						, unsigned int seed)
+	: m_distance(distance)
+	, m_m(std::max((size_t)2, m))
+	, m_ef_construction(std::max(m_m, ef_construction))
+	, m_ef_search(std::max((size_t)1, ef_search))
+	, m_seed(seed)
+	, m_entry_point(0)
+	, m_max_level(0)
+	, m_loaded(false)
+	{ }
+
+	void HnswIndex::build(const std::vector<Instance>& items)
+	{
+		size_t items_count = items.size();
+		if (m_loaded && items_count == m_features.size())
+		{
+			// a loaded graph is kept when it is built over the same objects
+			bool same_items = true;
+			for (size_t index = 0; index < items_count && same_items; ++index)
+				same_items = m_features[index] == &items[index].getFeatures();
+			if (same_items)
+				return;
+		}
+		m_loaded = false;
+
+		m_features.resize(items_count);
+		for (size_t index = 0; index < items_count; ++index)
+			m_features[index] = &items[index].getFeatures();
+
+		// levels are drawn up front so the graph depends on the seed only
+		std::mt19937 generator(m_seed);
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+		double level_factor = 1.0 / log((double)m_m);
+		m_levels.resize(items_count);
+		for (size_t index = 0; index < items_count; ++index)
+			m_levels[index] = (uint32_t)(-log(std::max(uniform(generator), 1e-12)) * level_factor);
+
+		m_base_links.assign(items_count * (max_links(0) + 1), 0);
+		m_upper_links.assign(items_count, std::vector<uint32_t>());
+		for (size_t index = 0; index < items_count; ++index)
+			m_upper_links[index].assign(m_levels[index] * (max_links(1) + 1), 0);
+
+		m_entry_point = 0;
+		m_max_level = items_count > 0 ? m_levels[0] : 0;
+		if (items_count < 2)
+			return;
+
+		std::vector<std::mutex> locks(items_count);
+		std::mutex entry_lock;
+#pragma omp parallel
+		{
+			VisitedList visited;
+#pragma omp for schedule(dynamic, 64)
+			for (size_t index = 1; index < items_count; ++index)
+				insert((uint32_t)index, locks, entry_lock, visited);
+		}
+	}
+
+	void HnswIndex::insert(uint32_t node, std::vector<std::mutex>& locks, std::mutex& entry_lock, VisitedList& visited)
+	{
+		size_t level = m_levels[node];
+		char buffer[arena_buffer_size];
+		Memory::Arena arena(buffer, sizeof(buffer));
+
+		// an item raising the top level keeps the entry lock until it becomes the entry point
+		std::unique_lock<std::mutex> entry_guard(entry_lock);
+		Candidate current{0.0, m_entry_point};
+		size_t max_level = m_max_level;
+		if (level <= max_level)
+			entry_guard.unlock();
+
+		const MathVector<double>& features = *m_features[node];
+		current.distance = distance(features, current.node);
+		for (size_t layer = max_level; layer > level; --layer)
+			greedy_search(features, layer, &locks, arena.resource(), current);
+
+		std::pmr::vector<Candidate> results(arena.resource());
+		std::pmr::vector<Candidate> candidates(arena.resource());
+		std::pmr::vector<Candidate> pruned(arena.resource());
+		for (size_t layer = std::min(level, max_level) + 1; layer-- > 0;)
+		{
+			search_layer(features, current, m_ef_construction, layer, &locks, visited, results);
+			std::sort(results.begin(), results.end());
+			current = results.front();
+
+			candidates = results;
+			select_neighbours(candidates, m_m);
+			{
+				std::lock_guard<std::mutex> guard(locks[node]);
+				uint32_t* node_links = links(node, layer);
+				node_links[0] = (uint32_t)candidates.size();
+				for (size_t index = 0; index < candidates.size(); ++index)
+					node_links[index + 1] = candidates[index].node;
+			}
+
+			size_t bound = max_links(layer);
+			for (const Candidate& neighbour: candidates)
+			{
+				std::lock_guard<std::mutex> guard(locks[neighbour.node]);
+				uint32_t* neighbour_links = links(neighbour.node, layer);
+				if (neighbour_links[0] < bound)
+				{
+					neighbour_links[++neighbour_links[0]] = node;
+					continue;
+				}
+
+				// the list is full: the node competes with the current links
+				pruned.assign(1, Candidate{neighbour.distance, node});
+				for (uint32_t index = 1; index <= neighbour_links[0]; ++index)
+					pruned.push_back(Candidate{distance(neighbour.node, neighbour_links[index]), neighbour_links[index]});
+				std::sort(pruned.begin(), pruned.end());
+				select_neighbours(pruned, bound);
+				neighbour_links[0] = (uint32_t)pruned.size();
+				for (size_t index = 0; index < pruned.size(); ++index)
+					neighbour_links[index + 1] = pruned[index].node;
+			}
+		}
+
+		if (level > max_level)
+		{
+			m_entry_point = node;
+			m_max_level   = level;
+		}
+	}
+
+	void HnswIndex::select_neighbours(std::pmr::vector<Candidate>& candidates, size_t count) const
+	{
+		// candidates come sorted by distance; one is kept unless a kept
+		// neighbour is closer to it than the base item is
+		if (candidates.size() <= count)
+			return;
+
+		std::pmr::vector<Candidate> selected(candidates.get_allocator());
+		selected.reserve(count);
+		for (const Candidate& candidate: candidates)
+		{
+			if (selected.size() == count)
+				break;
+
+			bool diverse = true;
+			for (const Candidate& kept: selected)
+			{
+				if (distance(candidate.node, kept.node) < candidate.distance)
+				{
+					diverse = false;
+					break;
+				}
+			}
+
+			if (diverse)
+				selected.push_back(candidate);
+		}
+
+		candidates.swap(selected);
+	}
+
+	void HnswIndex::read_links(uint32_t node, size_t level, std::vector<std::mutex>* locks, std::pmr::vector<uint32_t>& neighbours) const
+	{
+		const uint32_t* node_links = links(node, level);
+		if (locks != nullptr)
+		{
+			std::lock_guard<std::mutex> guard((*locks)[node]);
+			neighbours.assign(node_links + 1, node_links + 1 + node_links[0]);
+		}
+		else
+		{
+			neighbours.assign(node_links + 1, node_links + 1 + node_links[0]);
+		}
+	}
+
+	void HnswIndex::greedy_search( const MathVector<double>& target
+								 , size_t level
+								 , std::vector<std::mutex>* locks
+								 , std::pmr::memory_resource* resource
+								 , Candidate& current) const
+	{
+		std::pmr::vector<uint32_t> neighbours(resource);
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+			read_links(current.node, level, locks, neighbours);
+			for (uint32_t neighbour: neighbours)
+			{
+				double dist = distance(target, neighbour);
+				if (dist < current.distance)
+				{
+					current = Candidate{dist, neighbour};
+					changed = true;
+				}
+			}
+		}
+	}
+
+	void HnswIndex::search_layer( const MathVector<double>& target
+								, const Candidate& entry
+								, size_t ef
+								, size_t level
+								, std::vector<std::mutex>* locks
+								, VisitedList& visited
+								, std::pmr::vector<Candidate>& results) const
+	{
+		visited.next(m_features.size());
+		visited.marks[entry.node] = visited.generation;
+
+		std::pmr::memory_resource* resource = results.get_allocator().resource();
+		std::priority_queue<Candidate, std::pmr::vector<Candidate>, std::greater<Candidate>> candidates{std::greater<Candidate>(), std::pmr::vector<Candidate>(resource)};
+		candidates.push(entry);
+		results.assign(1, entry);
+
+		std::pmr::vector<uint32_t> neighbours(resource);
+		while (!candidates.empty())
+		{
+			Candidate closest = candidates.top();
+			if (results.size() >= ef && closest.distance > results.front().distance)
+				break;
+			candidates.pop();
+
+			read_links(closest.node, level, locks, neighbours);
+			for (uint32_t neighbour: neighbours)
+			{
+				if (visited.marks[neighbour] == visited.generation)
+					continue;
+				visited.marks[neighbour] = visited.generation;
+
+				double dist = distance(target, neighbour);
+				if (results.size() < ef || dist < results.front().distance)
+				{
+					candidates.push(Candidate{dist, neighbour});
+					results.push_back(Candidate{dist, neighbour});
+					std::push_heap(results.begin(), results.end());
+					if (results.size() > ef)
+					{
+						std::pop_heap(results.begin(), results.end());
+						results.pop_back();
+					}
+				}
+			}
+		}
+	}
+
+	void HnswIndex::search( const MathVector<double>& target
+						  , size_t k
+						  , std::vector<Neighbour>& neighbours) const
+	{
+		// the marks of a thread are kept between queries, a new generation
+		// clears them, so a query does not touch all nodes
+		thread_local VisitedList visited;
+		query(target, k, visited, neighbours);
+	}
+
+	void HnswIndex::search_batch( const std::vector<Instance>& targets
+								, size_t k
+								, std::pmr::vector<Neighbour>& neighbours
+								, std::pmr::vector<size_t>& counts) const
+	{
+		neighbours.assign(targets.size() * k, Neighbour{0.0, 0});
+		counts.assign(targets.size(), 0);
+#pragma omp parallel
+		{
+			VisitedList visited;
+			std::vector<Neighbour> found;
+#pragma omp for schedule(dynamic, 16)
+			for (size_t index = 0; index < targets.size(); ++index)
+			{
+				query(targets[index].getFeatures(), k, visited, found);
+				std::copy(found.begin(), found.end(), neighbours.begin() + index * k);
+				counts[index] = found.size();
+			}
+		}
+	}
+
+	void HnswIndex::query( const MathVector<double>& target
+						 , size_t k
+						 , VisitedList& visited
+						 , std::vector<Neighbour>& neighbours) const
+	{
+		neighbours.clear();
+		if (k == 0 || m_features.empty())
+			return;
+
+		char buffer[arena_buffer_size];
+		Memory::Arena arena(buffer, sizeof(buffer));
+
+		Candidate current{distance(target, m_entry_point), m_entry_point};
+		for (size_t layer = m_max_level; layer > 0; --layer)
+			greedy_search(target, layer, nullptr, arena.resource(), current);
+
+		std::pmr::vector<Candidate> results(arena.resource());
+		search_layer(target, current, std::max(m_ef_search, k), 0, nullptr, visited, results);
+		std::sort(results.begin(), results.end());
+
+		size_t count = std::min(k, results.size());
+		neighbours.resize(count);
+		for (size_t index = 0; index < count; ++index)
+			neighbours[index] = Neighbour{results[index].distance, results[index].node};
+	}
+
+	uint32_t* HnswIndex::links(uint32_t node, size_t level)
+	{
+		if (level == 0)
+			return m_base_links.data() + (size_t)node * (max_links(0) + 1);
+		return m_upper_links[node].data() + (level - 1) * (max_links(1) + 1);
+	}
+
+	const uint32_t* HnswIndex::links(uint32_t node, size_t level) const
+	{
+		if (level == 0)
+			return m_base_links.data() + (size_t)node * (max_links(0) + 1);
+		return m_upper_links[node].data() + (level - 1) * (max_links(1) + 1);
+	}
+
+	double HnswIndex::distance(const MathVector<double>& target, uint32_t node) const
+	{
+		return m_distance->calc(*m_features[node], target);
+	}
+
+	double HnswIndex::distance(uint32_t first, uint32_t second) const
+	{
+		return m_distance->calc(*m_features[first], *m_features[second]);
+	}
+
+	void HnswIndex::save(const std::string& path) const
+	{
+		std::ofstream output(path, std::ios::binary);
+		if (!output.is_open())
+			throw std::logic_error("Cannot open file");
+
+		uint64_t header[6] = { m_m
+							 , m_ef_construction
+							 , m_ef_search
+							 , m_features.size()
+							 , m_entry_point
+							 , m_max_level };
+		output.write("HNSW", 4);
+		output.write(reinterpret_cast<const char*>(header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(m_levels.data()), m_levels.size() * sizeof(uint32_t));
+		output.write(reinterpret_cast<const char*>(m_base_links.data()), m_base_links.size() * sizeof(uint32_t));
+		for (const std::vector<uint32_t>& upper_links: m_upper_links)
+			output.write(reinterpret_cast<const char*>(upper_links.data()), upper_links.size() * sizeof(uint32_t));
+		if (!output)
+			throw std::logic_error("Cannot write hnsw index file");
+	}
+
+	void HnswIndex::load(const std::string& path, const std::vector<Instance>& items)
+	{
+		m_features.resize(items.size());
+		for (size_t index = 0; index < items.size(); ++index)
+			m_features[index] = &items[index].getFeatures();
+		read_graph(path);
+	}
+
+	void HnswIndex::read_graph(const std::string& path)
+	{
+		m_loaded = false;
+		std::ifstream input(path, std::ios::binary);
+		if (!input.is_open())
+			throw std::logic_error("Cannot open file");
+
+		char magic[4];
+		uint64_t header[6];
+		input.read(magic, 4);
+		input.read(reinterpret_cast<char*>(header), sizeof(header));
+		if (!input || std::string(magic, 4) != "HNSW")
+			throw std::logic_error("Not a hnsw index file");
+		size_t items_count = m_features.size();
+		if (header[3] != items_count || (items_count > 0 && header[4] >= items_count))
+			throw std::logic_error("hnsw index does not match the objects");
+
+		m_m               = header[0];
+		m_ef_construction = header[1];
+		m_ef_search       = header[2];
+		m_entry_point     = (uint32_t)header[4];
+		m_max_level       = header[5];
+
+		m_levels.resize(items_count);
+		input.read(reinterpret_cast<char*>(m_levels.data()), m_levels.size() * sizeof(uint32_t));
+		m_base_links.resize(items_count * (max_links(0) + 1));
+		input.read(reinterpret_cast<char*>(m_base_links.data()), m_base_links.size() * sizeof(uint32_t));
+		m_upper_links.resize(items_count);
+		for (size_t index = 0; index < items_count && input; ++index)
+		{
+			m_upper_links[index].resize(m_levels[index] * (max_links(1) + 1));
+			input.read(reinterpret_cast<char*>(m_upper_links[index].data()), m_upper_links[index].size() * sizeof(uint32_t));
+		}
+
+		if (!input)
+			throw std::logic_error("hnsw index file is truncated");
+		m_loaded = true;
+	}
+
+	bool HnswIndex::saved_graph_matches(const std::string& path) const
+	{
+		HnswIndex other(m_distance);
+		other.m_features = m_features;
+		other.read_graph(path);
+		return m_m == other.m_m
+			&& m_ef_construction == other.m_ef_construction
+			&& m_ef_search == other.m_ef_search
+			&& m_features.size() == other.m_features.size()
+			&& m_entry_point == other.m_entry_point
+			&& m_max_level == other.m_max_level
+			&& m_levels == other.m_levels
+			&& m_base_links == other.m_base_links
+			&& m_upper_links == other.m_upper_links;
+	}
+}
@@ -0,0 +1,148 @@
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "instance.h"
+#include "mathvector.h"
+#include "memory_arena.h"
+#include "mathvector_norm.h"
+#include "neighbours_index.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	// Approximate nearest neighbours over a hierarchical navigable small
+	// world graph. Every item gets a random level, on each level up to its
+	// own it is linked to at most m items (2 * m on the base level) chosen by
+	// the diversity heuristic. A query descends greedily from the top entry
+	// point and runs a best-first search of width ef_search on the base level.
+	// Items are inserted concurrently with a lock per item link list; the
+	// built graph is read only, so queries need no locks. The candidate
+	// lists of an insert or a query live in an arena over a stack buffer
+	// released when it returns.
+	class HnswIndex : public NeighboursIndex
+	{
+	public:
+		HnswIndex( std::shared_ptr<MathVectorNorm<double>> distance
+				 , size_t m = 16
+				 , size_t ef_construction = 200
+				 , size_t ef_search = 64
+				 , unsigned int seed = 0);
+
+		void build(const std::vector<Instance>& items);
+		void search( const MathVector<double>& target
+				   , size_t k
+				   , std::vector<Neighbour>& neighbours) const;
+		void search_batch( const std::vector<Instance>& targets
+						 , size_t k
+						 , std::pmr::vector<Neighbour>& neighbours
+						 , std::pmr::vector<size_t>& counts) const;
+
+		// the graph is stored without the features, load expects the items
+		// the saved graph was built over. A later build over these very
+		// items keeps the loaded graph, e.g. when kNN learns on them
+		void save(const std::string& path) const;
+		void load(const std::string& path, const std::vector<Instance>& items);
+		// round trip check of save: the graph read back from the file over
+		// the items of this one has the same parameters and links
+		bool saved_graph_matches(const std::string& path) const;
+
+		bool exact() const { return false;};
+		size_t size() const { return m_features.size();};
+		std::string name() const { return "hnsw";};
+		NeighboursIndex* clone() const { return new HnswIndex(*this);};
+
+	private:
+		struct Candidate
+		{
+			double   distance;
+			uint32_t node;
+
+			bool operator<(const Candidate& other) const
+			{
+				return distance < other.distance;
+			}
+			bool operator>(const Candidate& other) const
+			{
+				return distance > other.distance;
+			}
+		};
+
+		// nodes visited by the current search are marked with its generation
+		struct VisitedList
+		{
+			std::vector<uint32_t> marks;
+			uint32_t              generation;
+
+			VisitedList() : generation(0) {}
+
+			void next(size_t nodes_count)
+			{
+				if (marks.size() != nodes_count || ++generation == 0)
+				{
+					marks.assign(nodes_count, 0);
+					generation = 1;
+				}
+			}
+		};
+
+		static const size_t arena_buffer_size = 32 * 1024;
+
+		size_t max_links(size_t level) const { return level == 0 ? 2 * m_m : m_m;};
+		uint32_t* links(uint32_t node, size_t level);
+		const uint32_t* links(uint32_t node, size_t level) const;
+
+		double distance(const MathVector<double>& target, uint32_t node) const;
+		double distance(uint32_t first, uint32_t second) const;
+
+		// locks are given while the graph is built, link lists are then copied under them
+		void read_links(uint32_t node, size_t level, std::vector<std::mutex>* locks, std::pmr::vector<uint32_t>& neighbours) const;
+		void greedy_search( const MathVector<double>& target
+						  , size_t level
+						  , std::vector<std::mutex>* locks
+						  , std::pmr::memory_resource* resource
+						  , Candidate& current) const;
+		// the search lists are allocated from the resource of results
+		void search_layer( const MathVector<double>& target
+						 , const Candidate& entry
+						 , size_t ef
+						 , size_t level
+						 , std::vector<std::mutex>* locks
+						 , VisitedList& visited
+						 , std::pmr::vector<Candidate>& results) const;
+		// reads the graph of the file over the items already in m_features
+		void read_graph(const std::string& path);
+		void select_neighbours(std::pmr::vector<Candidate>& candidates, size_t count) const;
+		void insert(uint32_t node, std::vector<std::mutex>& locks, std::mutex& entry_lock, VisitedList& visited);
+		void query( const MathVector<double>& target
+				  , size_t k
+				  , VisitedList& visited
+				  , std::vector<Neighbour>& neighbours) const;
+
+	private:
+		std::shared_ptr<MathVectorNorm<double>> m_distance;
+		size_t                                  m_m;
+		size_t                                  m_ef_construction;
+		size_t                                  m_ef_search;
+		unsigned int                            m_seed;
+
+		std::vector<const MathVector<double>*>  m_features;
+		std::vector<uint32_t>                   m_levels;
+		// links of a node on a level are stored as the count followed by the slots
+		std::vector<uint32_t>                   m_base_links;
+		std::vector<std::vector<uint32_t>>      m_upper_links;
+		uint32_t                                m_entry_point;
+		size_t                                  m_max_level;
+		bool                                    m_loaded;
+	};
+}
+
+#endif //HNSW_INDEX_H
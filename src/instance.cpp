@@ -9,9 +9,9 @@ using namespace  MathCore::AlgebraCore::VectorCore;
 namespace MachineLearning
 {
 
-	double& Instance::operator [](int index) const
+	double Instance::operator [](int index) const
 	{
-		return *(new double(features.get().getElement((size_t)index)));
+		return features.get().getElement((size_t)index);
 	}
 
 	double Instance::getGoal() const
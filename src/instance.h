@@ -26,7 +26,7 @@ namespace MachineLearning
 		}
 
 
-		double& operator [](int index) const;
+		double operator [](int index) const;
 
 		double getGoal() const;
 
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include <math.h>
+
+#include "inverted_index.h"
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	InvertedIndex::InvertedIndex(std::shared_ptr<MathVectorNorm<double>> distance)
+	: m_metric(Metric::EUCLIDEAN)
+	, m_nonnegative(true)
+	{
+		if (dynamic_cast<EuclideanNorm<double>*>(distance.get()) != nullptr)
+			m_metric = Metric::EUCLIDEAN;
+		else if (dynamic_cast<CosineNorm<double>*>(distance.get()) != nullptr)
+			m_metric = Metric::COSINE;
+		else
+			throw std::logic_error("inverted index supports euclidean and cosine distances only");
+	}
+
+	void InvertedIndex::build(const std::vector<Instance>& items)
+	{
+		size_t items_count = items.size();
+
+		std::vector<size_t> term_counts;
+		m_square_norms.assign(items_count, 0.0);
+		for (size_t index = 0; index < items_count; ++index)
+		{
+			const MathVector<double>& features = items[index].getFeatures();
+			for (auto it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
+			{
+				if (it.index() >= term_counts.size())
+					term_counts.resize(it.index() + 1, 0);
+				++term_counts[it.index()];
+				m_square_norms[index] += it.getElem() * it.getElem();
+			}
+		}
+
+		size_t terms_count = term_counts.size();
+		m_term_offsets.assign(terms_count + 1, 0);
+		for (size_t term = 0; term < terms_count; ++term)
+			m_term_offsets[term + 1] = m_term_offsets[term] + term_counts[term];
+
+		// items are appended in ascending order, so every posting list is sorted by item
+		m_posting_items.resize(m_term_offsets[terms_count]);
+		m_posting_values.resize(m_term_offsets[terms_count]);
+		m_term_max.assign(terms_count, 0.0);
+		m_nonnegative = true;
+		std::vector<size_t> positions(m_term_offsets.begin(), m_term_offsets.end() - 1);
+		for (size_t index = 0; index < items_count; ++index)
+		{
+			double scale = 1.0;
+			if (m_metric == Metric::COSINE)
+				scale = m_square_norms[index] > 0.0 ? 1.0 / sqrt(m_square_norms[index]) : 0.0;
+
+			const MathVector<double>& features = items[index].getFeatures();
+			for (auto it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
+			{
+				double value = it.getElem() * scale;
+				size_t& position = positions[it.index()];
+				m_posting_items[position] = (uint32_t)index;
+				m_posting_values[position] = value;
+				++position;
+
+				m_term_max[it.index()] = std::max(m_term_max[it.index()], fabs(value));
+				if (value < 0.0)
+					m_nonnegative = false;
+			}
+		}
+
+		m_norm_order.resize(items_count);
+		std::iota(m_norm_order.begin(), m_norm_order.end(), 0);
+		std::stable_sort( m_norm_order.begin()
+						, m_norm_order.end()
+						, [this](uint32_t first, uint32_t second) -> bool { return m_square_norms[first] < m_square_norms[second]; });
+	}
+
+	void InvertedIndex::search( const MathVector<double>& target
+							  , size_t k
+							  , std::vector<Neighbour>& neighbours) const
+	{
+		// the accumulators of a thread are sized to the items once and
+		// cleaned by every query, so single queries do not zero them again
+		thread_local Scratch scratch;
+		query(target, k, scratch, neighbours);
+	}
+
+	void InvertedIndex::search_batch( const std::vector<Instance>& targets
+									, size_t k
+									, std::pmr::vector<Neighbour>& neighbours
+									, std::pmr::vector<size_t>& counts) const
+	{
+		neighbours.assign(targets.size() * k, Neighbour{0.0, 0});
+		counts.assign(targets.size(), 0);
+#pragma omp parallel
+		{
+			Scratch scratch;
+			std::vector<Neighbour> found;
+#pragma omp for schedule(dynamic, 16)
+			for (size_t index = 0; index < targets.size(); ++index)
+			{
+				query(targets[index].getFeatures(), k, scratch, found);
+				std::copy(found.begin(), found.end(), neighbours.begin() + index * k);
+				counts[index] = found.size();
+			}
+		}
+	}
+
+	void InvertedIndex::query( const MathVector<double>& target
+							 , size_t k
+							 , Scratch& scratch
+							 , std::vector<Neighbour>& neighbours) const
+	{
+		neighbours.clear();
+		size_t items_count = m_square_norms.size();
+		k = std::min(k, items_count);
+		if (k == 0)
+			return;
+
+		if (scratch.dots.size() != items_count)
+		{
+			scratch.dots.assign(items_count, 0.0);
+			scratch.touched.assign(items_count, 0);
+		}
+
+		std::vector<QueryTerm>& terms = scratch.terms;
+		terms.clear();
+		double query_square_norm = 0.0;
+		bool nonnegative = m_nonnegative;
+		for (auto it = target.const_fast_begin(); it != target.const_fast_end(); ++it)
+		{
+			query_square_norm += it.getElem() * it.getElem();
+			if (it.getElem() < 0.0)
+				nonnegative = false;
+			if (it.index() < m_term_max.size() && m_term_offsets[it.index()] != m_term_offsets[it.index() + 1])
+				terms.push_back(QueryTerm{(uint32_t)it.index(), it.getElem(), 0.0});
+		}
+
+		double scale = 1.0;
+		if (m_metric == Metric::COSINE)
+			scale = query_square_norm > 0.0 ? 1.0 / sqrt(query_square_norm) : 0.0;
+		for (QueryTerm& term: terms)
+		{
+			term.value *= scale;
+			term.bound = fabs(term.value) * m_term_max[term.term];
+		}
+		std::sort(terms.begin(), terms.end(), [](const QueryTerm& first, const QueryTerm& second) -> bool { return first.bound > second.bound; });
+
+		std::vector<double>& remaining_bounds = scratch.remaining_bounds;
+		remaining_bounds.assign(terms.size() + 1, 0.0);
+		for (size_t index = terms.size(); index > 0; --index)
+			remaining_bounds[index - 1] = remaining_bounds[index] + terms[index - 1].bound;
+
+		// with nonnegative dots every item is not farther than if it shared
+		// no term, so the k items of least norm bound the k-th neighbour
+		// (euclidean); partial dots only grow, so k of them above the bound
+		// left for an unseen item leave it out of the neighbours (cosine)
+		bool pruning = nonnegative;
+		bool euclidean = m_metric == Metric::EUCLIDEAN;
+		double square_cap = query_square_norm + m_square_norms[m_norm_order[k - 1]];
+		double min_square_norm = m_square_norms[m_norm_order[0]];
+
+		std::vector<double>& dots = scratch.dots;
+		std::vector<unsigned char>& touched = scratch.touched;
+		std::vector<uint32_t>& touched_items = scratch.touched_items;
+		std::vector<double>& best_dots = scratch.best_dots;
+		double kth_dot = 0.0;
+		bool opening = true;
+		for (size_t index = 0; index < terms.size(); ++index)
+		{
+			const QueryTerm& term = terms[index];
+			size_t begin = m_term_offsets[term.term];
+			size_t end   = m_term_offsets[term.term + 1];
+			double bound = 2.0 * remaining_bounds[index];
+
+			if (pruning && opening && euclidean && query_square_norm + min_square_norm - bound > square_cap)
+				opening = false;
+			if (pruning && opening && !euclidean)
+			{
+				// the k-th best dot seen so far stays a lower bound of the
+				// final one, it is refreshed only while cheaper than the list
+				if (remaining_bounds[index] >= kth_dot && touched_items.size() >= k && touched_items.size() < end - begin)
+				{
+					best_dots.clear();
+					for (uint32_t item: touched_items)
+						best_dots.push_back(dots[item]);
+					std::nth_element(best_dots.begin(), best_dots.begin() + (k - 1), best_dots.end(), std::greater<double>());
+					kth_dot = best_dots[k - 1];
+				}
+				if (remaining_bounds[index] < kth_dot)
+					opening = false;
+			}
+
+			if (opening)
+			{
+				for (size_t position = begin; position < end; ++position)
+				{
+					uint32_t item = m_posting_items[position];
+					if (!touched[item])
+					{
+						if (pruning && euclidean && query_square_norm + m_square_norms[item] - bound > square_cap)
+							continue;
+						touched[item] = 1;
+						dots[item] = 0.0;
+						touched_items.push_back(item);
+					}
+					dots[item] += term.value * m_posting_values[position];
+				}
+			}
+			else if (touched_items.size() * 16 < end - begin)
+			{
+				for (uint32_t item: touched_items)
+				{
+					const uint32_t* found = std::lower_bound(m_posting_items.data() + begin, m_posting_items.data() + end, item);
+					if (found != m_posting_items.data() + end && *found == item)
+						dots[item] += term.value * m_posting_values[found - m_posting_items.data()];
+				}
+			}
+			else
+			{
+				for (size_t position = begin; position < end; ++position)
+				{
+					uint32_t item = m_posting_items[position];
+					if (touched[item])
+						dots[item] += term.value * m_posting_values[position];
+				}
+			}
+		}
+
+		neighbours.reserve(k);
+		auto offer = [&neighbours, k](const Neighbour& candidate)
+		{
+			if (neighbours.size() < k)
+			{
+				neighbours.push_back(candidate);
+				std::push_heap(neighbours.begin(), neighbours.end());
+			}
+			else if (candidate < neighbours.front())
+			{
+				std::pop_heap(neighbours.begin(), neighbours.end());
+				neighbours.back() = candidate;
+				std::push_heap(neighbours.begin(), neighbours.end());
+			}
+		};
+
+		for (uint32_t item: touched_items)
+			offer(Neighbour{item_distance(query_square_norm, item, dots[item]), item});
+
+		for (uint32_t item: m_norm_order)
+		{
+			if (touched[item])
+				continue;
+			double dist = item_distance(query_square_norm, item, 0.0);
+			if (neighbours.size() == k && dist >= neighbours.front().distance)
+				break;
+			offer(Neighbour{dist, item});
+		}
+
+		for (uint32_t item: touched_items)
+			touched[item] = 0;
+		touched_items.clear();
+
+		std::sort_heap(neighbours.begin(), neighbours.end());
+	}
+
+	double InvertedIndex::item_distance(double query_square_norm, uint32_t item, double dot) const
+	{
+		if (m_metric == Metric::COSINE)
+			return query_square_norm > 0.0 && m_square_norms[item] > 0.0 ? sqrt(std::max(0.0, 2.0 - 2.0 * dot)) : sqrt(2.0);
+
+		return sqrt(std::max(0.0, query_square_norm + m_square_norms[item] - 2.0 * dot));
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef INVERTED_INDEX_H
+#define INVERTED_INDEX_H
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+#include "neighbours_index.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	// Exact nearest neighbours over sparse vectors driven by posting lists
+	// term -> (item, value). Dot products are accumulated over the shared
+	// terms only and distances are derived from them:
+	//   euclidean: |q - d|^2 = |q|^2 + |d|^2 - 2 * q.d
+	//   cosine:    sqrt(2 - 2 * q.d / (|q| |d|))
+	// Items sharing no term with the query are taken in ascending norm
+	// order. Over nonnegative values query terms are processed by
+	// descending upper bound of their contribution (MaxScore): once the
+	// bound left for an unseen item cannot bring it under the distance of
+	// the k-th neighbour (euclidean) or above the k-th best normalised dot
+	// (cosine) no new accumulators are opened and the remaining posting
+	// lists are only probed for the items already seen.
+	class InvertedIndex : public NeighboursIndex
+	{
+	public:
+		InvertedIndex(std::shared_ptr<MathVectorNorm<double>> distance);
+
+		void build(const std::vector<Instance>& items);
+		void search( const MathVector<double>& target
+				   , size_t k
+				   , std::vector<Neighbour>& neighbours) const;
+		void search_batch( const std::vector<Instance>& targets
+						 , size_t k
+						 , std::pmr::vector<Neighbour>& neighbours
+						 , std::pmr::vector<size_t>& counts) const;
+
+		size_t size() const { return m_square_norms.size();};
+		std::string name() const { return "inverted_index";};
+		NeighboursIndex* clone() const { return new InvertedIndex(*this);};
+
+	private:
+		enum class Metric
+		{
+			EUCLIDEAN,
+			COSINE
+		};
+
+		struct QueryTerm
+		{
+			uint32_t term;
+			double   value;
+			double   bound;
+		};
+
+		// per-thread accumulators, sized to the items count and cleaned after every query
+		struct Scratch
+		{
+			std::vector<double>        dots;
+			std::vector<unsigned char> touched;
+			std::vector<uint32_t>      touched_items;
+			std::vector<QueryTerm>     terms;
+			std::vector<double>        remaining_bounds;
+			std::vector<double>        best_dots;
+		};
+
+		void query( const MathVector<double>& target
+				  , size_t k
+				  , Scratch& scratch
+				  , std::vector<Neighbour>& neighbours) const;
+		double item_distance(double query_square_norm, uint32_t item, double dot) const;
+
+	private:
+		Metric                 m_metric;
+		bool                   m_nonnegative;
+
+		std::vector<size_t>    m_term_offsets;
+		std::vector<uint32_t>  m_posting_items;
+		std::vector<double>    m_posting_values;
+		std::vector<double>    m_term_max;
+
+		std::vector<double>    m_square_norms;
+		std::vector<uint32_t>  m_norm_order;
+	};
+}
+
+#endif //INVERTED_INDEX_H
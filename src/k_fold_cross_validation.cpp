@@ -4,6 +4,7 @@
 #include <string.h>
 #include <algorithm>
 #include <ctime>
+#include <chrono>
 #include <iostream>
 
 #include <boost/filesystem.hpp>
@@ -24,6 +25,7 @@
 
 
 #include "k_fold_cross_validation.h"
+#include "memory_arena.h"
 
 using namespace MachineLearning;
 
@@ -44,6 +46,41 @@ unsigned int CrossValidation::genRandLimited(unsigned int limit)
 	return genRand() % limit;
 }
 
+void CrossValidation::split_folds( std::vector<Instance>& instances
+                                 , size_t foldsCount
+                                 , std::vector<std::vector<Instance>>& learnSet
+                                 , std::vector<std::vector<Instance>>& testSet
+                                 , std::vector<std::vector<size_t>>& learnIndexes
+                                 , std::vector<std::vector<size_t>>& testIndexes)
+{
+	learnSet.assign(foldsCount, std::vector<Instance>());
+	testSet.assign(foldsCount, std::vector<Instance>());
+	learnIndexes.assign(foldsCount, std::vector<size_t>());
+	testIndexes.assign(foldsCount, std::vector<size_t>());
+
+	std::vector<int> instanceNumbers;
+
+	size_t instancesCount = instances.size();
+
+	for (int index = 0; index < instancesCount; ++index)
+	{
+		instanceNumbers.push_back(index);
+	}
+
+	std::random_shuffle(instanceNumbers.begin(), instanceNumbers.end());
+
+	for (size_t instanceNumber = 0; instanceNumber < instancesCount; ++instanceNumber)
+	{
+		size_t learnFoldNumber = instanceNumbers[instanceNumber] % foldsCount;
+
+		for (size_t foldNumber = 0; foldNumber < foldsCount; ++foldNumber)
+		{
+			(foldNumber == learnFoldNumber ? learnSet[foldNumber] : testSet[foldNumber]).push_back(instances.at(instanceNumber));
+			(foldNumber == learnFoldNumber ? learnIndexes[foldNumber] : testIndexes[foldNumber]).push_back(instanceNumber);
+		}
+	}
+}
+
 static std::pair<double, double> run(Predictor& _predictor, std::vector<Instance>& _pool, size_t foldsCount)
 {
 	return std::make_pair(0, 0);
@@ -133,36 +170,18 @@ std::pair<double, double> CrossValidation::test( Predictor* _predictor
 
 	std::vector<std::vector<Instance>> learnSet;
 	std::vector<std::vector<Instance>> testSet;
+	std::vector<std::vector<size_t>> learnIndexes;
+	std::vector<std::vector<size_t>> testIndexes;
 
-	learnSet.resize(foldsCount);
-	testSet.resize(foldsCount);
-
-	std::vector<int> instanceNumbers;
-
-	size_t instancesCount = _pool.getInstanceCount();
-
-	for (int index = 0; index < instancesCount; ++index)
-	{
-		instanceNumbers.push_back(index);
-	}
-
-	std::random_shuffle(instanceNumbers.begin(), instanceNumbers.end());
-
-	for (size_t instanceNumber = 0; instanceNumber < instancesCount; ++instanceNumber)
-	{
-		size_t learnFoldNumber = instanceNumbers[instanceNumber] % foldsCount;
-
-		for (size_t foldNumber = 0; foldNumber < foldsCount; ++foldNumber)
-		{
-			(foldNumber == learnFoldNumber ? learnSet[foldNumber] : testSet[foldNumber]).push_back(finalLearnSet.at(instanceNumber));
-		}
-	}
+	split_folds(finalLearnSet, foldsCount, learnSet, testSet, learnIndexes, testIndexes);
 
 	if (print)
 	{
 		std::cout << "Instances are shuffled" << std::endl;
 	}
 
+	_predictor->prepare_folds(finalLearnSet, learnIndexes);
+
     double average_learn_precision = 0.0;
     double average_learn_complete  = 0.0;
     double average_learn_f1        = 0.0;
@@ -196,19 +215,25 @@ std::pair<double, double> CrossValidation::test( Predictor* _predictor
 			std::cout << "Fold index " << foldNumber << std::endl;
 		}
 
+		// predictions and neighbour lists of the checks below, freed with the fold
+		Memory::Arena fold_arena;
 		double duration = 0.;
 		clock_t start, finish;
         std::cout << "Learn set size: " << learnSet.at(foldNumber).size() << std::endl;
+		_predictor->select_objects(learnIndexes.at(foldNumber));
+		Memory::AllocationScope learn_allocations;
 		start = clock();
 		_predictor->learn(learnSet.at(foldNumber), objWeights, learning_curve);
 		finish = clock();
+		size_t learn_heap_allocations = learn_allocations.allocations();
+		size_t learn_heap_bytes       = learn_allocations.bytes();
 
 		duration = (double)(finish - start);
 
 		averageDuration += duration;
 		averageComplexity += _predictor->get_model_complexity();
         std::cout << "Check learn set" << std::endl;
-		std::vector<double> learnCharacteristics = _predictor->test(learnSet.at(foldNumber), metrics_vector);
+		std::vector<double> learnCharacteristics = _predictor->test(learnSet.at(foldNumber), metrics_vector, fold_arena.resource());
         double learn_precision = learnCharacteristics.at(0);
         double learn_complete  = learnCharacteristics.at(1);
         double learn_f1        = learnCharacteristics.at(2);
@@ -228,7 +253,13 @@ std::pair<double, double> CrossValidation::test( Predictor* _predictor
         learn_rmse_path_file      << learn_rmse      << std::endl;
 
         std::cout << "Check test set" << std::endl;
-		std::vector<double> testCharacteristics = _predictor->test(testSet.at(foldNumber), metrics_vector);
+		_predictor->select_objects(testIndexes.at(foldNumber));
+		Memory::AllocationScope test_allocations;
+		std::chrono::steady_clock::time_point test_start = std::chrono::steady_clock::now();
+		std::vector<double> testCharacteristics = _predictor->test(testSet.at(foldNumber), metrics_vector, fold_arena.resource());
+		double test_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - test_start).count();
+		size_t test_heap_allocations = test_allocations.allocations();
+		size_t test_heap_bytes       = test_allocations.bytes();
         double test_precision = testCharacteristics.at(0);
         double test_complete  = testCharacteristics.at(1);
         double test_f1        = testCharacteristics.at(2);
@@ -251,7 +282,13 @@ std::pair<double, double> CrossValidation::test( Predictor* _predictor
 		model_complexity_path_file << _predictor->get_model_complexity() << std::endl;
 
         std::cout << "learning time   : " << duration << std::endl;
+        std::cout << "test throughput : " << testSet.at(foldNumber).size() / test_seconds << " objects/s" << std::endl;
 		std::cout << "model complexity: " << _predictor->get_model_complexity() << std::endl;
+		if (Memory::statistics_enabled())
+		{
+			std::cout << "heap allocations: learn - " << learn_heap_allocations << " (" << learn_heap_bytes << " bytes)"
+			          << " test - " << test_heap_allocations << " (" << test_heap_bytes << " bytes)" << std::endl;
+		}
 
         std::cout << "precision  : learn - " << learn_precision << " test - " << test_precision << std::endl;
         std::cout << "completness: learn - " << learn_complete  << " test - " << test_complete << std::endl;
@@ -269,6 +306,9 @@ std::pair<double, double> CrossValidation::test( Predictor* _predictor
 		std::srand(unsigned(std::time(NULL)));
 	}
 
+	_predictor->select_objects(std::vector<size_t>());
+	_predictor->finish_folds();
+
     average_learn_precision /= foldsCount;
     average_learn_complete  /= foldsCount;
     average_learn_f1        /= foldsCount;
@@ -311,3 +351,75 @@ std::pair<double, double> CrossValidation::test( Predictor* _predictor
 
 	return std::make_pair(average_learn_rmse, average_test_rmse);
 }
+
+
+void CrossValidation::compare( std::vector<std::pair<std::string, Predictor*>>& predictors
+                             , Pool& _pool
+                             , size_t foldsCount)
+{
+	std::srand(unsigned(std::time(NULL)));
+
+	std::vector<Instance> finalLearnSet = _pool.getInstance();
+
+	std::vector<std::vector<Instance>> learnSet;
+	std::vector<std::vector<Instance>> testSet;
+	std::vector<std::vector<size_t>> learnIndexes;
+	std::vector<std::vector<size_t>> testIndexes;
+	split_folds(finalLearnSet, foldsCount, learnSet, testSet, learnIndexes, testIndexes);
+
+	for (size_t predictorIndex = 0; predictorIndex < predictors.size(); ++predictorIndex)
+		predictors[predictorIndex].second->prepare_folds(finalLearnSet, learnIndexes);
+
+	std::vector<Metrics::Metric> metrics_vector;
+	metrics_vector.push_back(Metrics::F1ScoreMetric);
+	metrics_vector.push_back(Metrics::AccuracyMetric);
+
+	std::vector<double> average_seconds(predictors.size(), 0.0);
+	std::vector<double> average_f1(predictors.size(), 0.0);
+	std::vector<double> average_accuracy(predictors.size(), 0.0);
+	std::vector<double> average_throughput(predictors.size(), 0.0);
+
+	for (size_t foldNumber = 0; foldNumber < foldsCount; ++foldNumber)
+	{
+		for (size_t predictorIndex = 0; predictorIndex < predictors.size(); ++predictorIndex)
+		{
+			std::cout << "----------------------------------------------------------" << std::endl;
+			std::cout << "Fold index " << foldNumber << " predictor " << predictors[predictorIndex].first << std::endl;
+
+			Predictor* predictor = predictors[predictorIndex].second;
+			std::vector<double> objWeights;
+			std::vector<std::pair<double, double>> learning_curve;
+
+			predictor->select_objects(learnIndexes.at(foldNumber));
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			predictor->learn(learnSet.at(foldNumber), objWeights, learning_curve);
+			std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+
+			predictor->select_objects(testIndexes.at(foldNumber));
+			Memory::Arena fold_arena;
+			std::vector<double> testCharacteristics = predictor->test(testSet.at(foldNumber), metrics_vector, fold_arena.resource());
+			std::chrono::steady_clock::time_point tested = std::chrono::steady_clock::now();
+
+			average_seconds[predictorIndex]    += std::chrono::duration<double>(finish - start).count();
+			average_throughput[predictorIndex] += testSet.at(foldNumber).size() / std::chrono::duration<double>(tested - finish).count();
+			average_f1[predictorIndex]       += testCharacteristics.at(0);
+			average_accuracy[predictorIndex] += testCharacteristics.at(1);
+		}
+	}
+
+	for (size_t predictorIndex = 0; predictorIndex < predictors.size(); ++predictorIndex)
+	{
+		predictors[predictorIndex].second->select_objects(std::vector<size_t>());
+		predictors[predictorIndex].second->finish_folds();
+	}
+
+	std::cout << "K Fold CV Benchmark:" << std::endl;
+	for (size_t predictorIndex = 0; predictorIndex < predictors.size(); ++predictorIndex)
+	{
+		std::cout << "\t" << predictors[predictorIndex].first
+		          << ": learning seconds - " << average_seconds[predictorIndex] / foldsCount
+		          << " test f1_score - "     << average_f1[predictorIndex]      / foldsCount
+		          << " test accuracy - "     << average_accuracy[predictorIndex] / foldsCount
+		          << " test objects/s - "    << average_throughput[predictorIndex] / foldsCount << std::endl;
+	}
+}
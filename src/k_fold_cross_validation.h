@@ -28,8 +28,21 @@ namespace MachineLearning
 
 			static std::pair<double, double> test(Predictor* _predictor, Pool& _pool, size_t folds, std::string testing_category_name, const std::string& outdir, bool print = false);
 
+			// learns every predictor on the same folds and reports the average
+			// wall clock learning time, test quality and test throughput of each
+			static void compare(std::vector<std::pair<std::string, Predictor*>>& predictors, Pool& _pool, size_t folds);
+
 		private:
 
+			// learnIndexes and testIndexes keep the positions in instances of
+			// the objects of every fold in the order of learnSet and testSet
+			static void split_folds( std::vector<Instance>& instances
+			                       , size_t foldsCount
+			                       , std::vector<std::vector<Instance>>& learnSet
+			                       , std::vector<std::vector<Instance>>& testSet
+			                       , std::vector<std::vector<size_t>>& learnIndexes
+			                       , std::vector<std::vector<size_t>>& testIndexes);
+
 			static unsigned int genRand();
 
 			static unsigned int genRandLimited(unsigned int limit);
@@ -1,8 +1,11 @@
 #include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <vector>
 #include <map>
 #include <memory>
 #include <limits>
+#include <math.h>
 
 #include "k_nearest_neighbours.h"
 
@@ -10,7 +13,9 @@
 #include "metric.h"
 #include "mathvector.h"
 #include "mathvector_norm.h"
-#include "vp_tree.h"
+#include "fris_stolp.h"
+#include "neighbours_index.h"
+#include "vp_tree_index.h"
 
 using namespace DataStructures;
 using namespace MathCore::AlgebraCore::VectorCore;
@@ -18,13 +23,27 @@ using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
 
 namespace MachineLearning
 {
-	KNearestNeighbours::KNearestNeighbours(size_t _featuresCount, std::shared_ptr<MathVectorNorm<double>> distance, neighbour_weight_t neighbour_weight, bool fris_stolp)
+	KNearestNeighbours::KNearestNeighbours(size_t _featuresCount, std::shared_ptr<MathVectorNorm<double>> distance, neighbour_weight_t neighbour_weight, bool fris_stolp, size_t max_neighbours, NeighboursIndexPtr index, bool report_recall, size_t pivots_count, bool fold_cache)
 	: Predictor(_featuresCount)
 	, m_distance(distance)
 	, m_neighbour_weight(neighbour_weight)
+	, m_index(index ? index : NeighboursIndexPtr(new VpTreeIndex(distance, pivots_count)))
 	, m_fris_stolp(fris_stolp)
+	, m_max_neighbours(max_neighbours)
+	, m_report_recall(report_recall)
+	, m_fold_cache(fold_cache)
 	{ }
 
+	Predictor* KNearestNeighbours::clone() const
+	{
+		KNearestNeighbours* copy = new KNearestNeighbours(*this);
+		copy->m_index.reset(m_index->clone());
+		// a copy learns on its own objects, only the cache itself is shared
+		copy->m_selected.clear();
+		copy->m_item_positions.clear();
+		return copy;
+	}
+
 	double KNearestNeighbours::predict(MathVector<double>& features)
 	{
 		return predictRaw(Instance(features, 0.0));
@@ -34,99 +53,56 @@ namespace MachineLearning
 			                      , std::vector<double>& objectsWeights
 			                      , std::vector<std::pair<double, double>>& learning_curve)
 	{
-		size_t positive_count = 0;
-		size_t negative_count = 0;
-		neighbours_matrix_t neigbours;
-		std::vector<std::vector<size_t>> renumerator;
+		NeighboursList neigbours;
 		std::vector<size_t> objects_indexes;
-        createNeighboursMatrix(neigbours, renumerator, learnSet, learnSet, objects_indexes);
-		for (Instance& instance: learnSet)
-		{
-			if (instance.getGoal() == 1.0)
-				positive_count++;
-			else
-				negative_count++;
-		}
-
-		auto distance = [this](const Instance& l, const Instance& r) -> double { return calcDist(l, r); };
-		std::cout << "Build VP Tree" << std::endl;
-		m_neighbours = VpTree<Instance>(distance);
+		std::vector<size_t> selected_objects;
+		bool cached = m_pool_neighbours && m_selected.size() == learnSet.size();
+		if (!cachedNeighboursMatrix(neigbours, learnSet, learnSet, objects_indexes))
+			createNeighboursMatrix(neigbours, learnSet, learnSet, objects_indexes, m_max_neighbours);
 
 		if (m_fris_stolp)
 		{
 			std::cout << "STOLP selection started" << std::endl;
-			std::unordered_set<size_t> selected_objects = select_objects(neigbours, renumerator, learnSet);
+			FrisStolp selection(learnSet, neigbours, [this, &learnSet](size_t first, size_t second) -> double { return calcDist(learnSet[first], learnSet[second]); });
+			selected_objects = selection.select();
 			std::vector<Instance> selected_instances;
-			positive_count = 0;
-			negative_count = 0;
 			for (const size_t& object_index: selected_objects)
 			{
 				selected_instances.push_back(learnSet[object_index]);
 				objects_indexes.push_back(object_index);
-				if (learnSet[object_index] == 1.0)
-					positive_count++; 
-				else
-					negative_count++;
 			}
 
 			neigbours.clear();
-			renumerator.clear();
-			createNeighboursMatrix(neigbours, renumerator, learnSet, selected_instances, objects_indexes);
-			renumerator.clear();
+			if (!cachedNeighboursMatrix(neigbours, learnSet, selected_instances, objects_indexes))
+				createNeighboursMatrix(neigbours, learnSet, selected_instances, objects_indexes, m_max_neighbours);
 			objects_indexes.clear();
-			m_neighbours.create(selected_instances);
+			m_items = selected_instances;
 		}
 		else
 		{
-			renumerator.clear();
-			m_neighbours.create(learnSet);
+			m_items = learnSet;
 		}
 
-		std::cout << "Start learning" << std::endl;
-
-		size_t maximal_count = std::min(positive_count, negative_count);
-		double maximal_count_quality = 0.0;
-
-		size_t minimal_count = 3;
-		double minimal_count_quality = 0.0;
-		size_t iterations = 0;
-		while (abs(maximal_count - minimal_count) > 2)
+		m_item_positions.clear();
+		if (cached)
 		{
-			size_t iter_count = (maximal_count + minimal_count) / 2;
-			if (iter_count % 2 == 0)
-				iter_count += 1;
-			size_t iter_count_left = iter_count - 2;
-			size_t iter_count_right = iter_count + 2;
-
-			std::pair<double, double> qualities = testRaw(neigbours, learnSet, iter_count_left, iter_count_right);
-			double left_quality = qualities.first;
-			double right_quality = qualities.second;
-
-			if (left_quality < right_quality)
-			{
-				minimal_count = iter_count;
-				minimal_count_quality = left_quality;
-			}
-			else
-			{
-				maximal_count = iter_count;
-				maximal_count_quality = right_quality;
-			}
-			iterations++;
-			std::cout << "    Iteration: " << iterations                                      << std::endl
-					  << "Minimal count: " << minimal_count << " : " << minimal_count_quality << std::endl
-					  << "Maximal count: " << maximal_count << " : " << maximal_count_quality << std::endl;
+			m_item_positions.assign(m_pool_neighbours->objects_count(), (uint32_t)-1);
+			for (size_t index = 0; index < m_items.size(); ++index)
+				m_item_positions[m_selected[m_fris_stolp ? selected_objects[index] : index]] = (uint32_t)index;
 		}
 
-		if (minimal_count_quality > maximal_count_quality)
-		{
-			m_effective_count = minimal_count;
-		}
-		else
-		{
-			m_effective_count = maximal_count;
-		}
+		std::cout << "Build " << m_index->name() << " index" << std::endl;
+		std::chrono::steady_clock::time_point build_start = std::chrono::steady_clock::now();
+		m_index->build(m_items);
+		std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - build_start;
+		std::cout << "index build time: " << build_time.count() << " s" << std::endl;
 
+		std::cout << "Start learning" << std::endl;
+
+		m_effective_count = select_neighbours_count(neigbours, learnSet);
+		m_vote_weights.resize(m_effective_count);
+		for (size_t index = 0; index < m_effective_count; ++index)
+			m_vote_weights[index] = m_neighbour_weight(index, m_effective_count);
 
 		std::cout << "          Model complexity: " << get_model_complexity() << std::endl
 			      << "Effective neighbours count: " << m_effective_count      << std::endl;
@@ -134,479 +110,437 @@ namespace MachineLearning
 
 	size_t KNearestNeighbours::get_model_complexity()
 	{
-		return m_neighbours.size() * (featuresCount + 1);  
+		return m_index->size() * (featuresCount + 1);  
 	}
 	
-	void KNearestNeighbours::createNeighboursMatrix( neighbours_matrix_t& neigbours
-			                                       , std::vector<std::vector<size_t>>& renumerator
+	void KNearestNeighbours::createNeighboursMatrix( NeighboursList& neigbours
 			                                       , std::vector<Instance>& learnSet
 												   , std::vector<Instance>& objects
-												   , std::vector<size_t>& objects_indexes)
+												   , std::vector<size_t>& objects_indexes
+												   , size_t max_neighbours)
 	{
-		std::cout << "calculate distance matrix" << std::endl;
-		if (learnSet.size() == objects.size())
-		{
-			neigbours = neighbours_matrix_t(learnSet.size(), neighbours_t(learnSet.size() - 1, neighbour_t(0.0, {0, 0.0})));
-			renumerator = std::vector<std::vector<size_t>>(learnSet.size(), std::vector<size_t>(learnSet.size(), 0));
-		}
-		else
-		{
-			neigbours = neighbours_matrix_t(learnSet.size(), neighbours_t(objects.size(), neighbour_t(0.0, {0, 0.0})));
-			renumerator = std::vector<std::vector<size_t>>(learnSet.size(), std::vector<size_t>(objects.size(), 0));
-		}
-
+		std::cout << "calculate nearest neighbours" << std::endl;
+		bool same_objects = objects_indexes.empty();
+		size_t max_count  = std::min(max_neighbours, same_objects ? learnSet.size() - 1 : objects.size());
+		neigbours.reset(learnSet.size(), max_count);
+
+		if (max_count == 0)
+			return;
+
+		// one extra neighbour is asked for as the object itself may be found.
+		// An approximate index gives approximate lists too, it is never
+		// replaced by a scan of all pairs: hnsw searches at least k + 1 wide
+		NeighboursIndexPtr index(m_index->clone());
+		index->build(objects);
+		size_t search_count = std::min(max_count + 1, objects.size());
+		std::pmr::vector<NeighboursIndex::Neighbour> found;
+		std::pmr::vector<size_t> counts;
+		index->search_batch(learnSet, search_count, found, counts);
+
+#pragma omp parallel for schedule(dynamic, 256)
 		for (size_t index_1 = 0; index_1 < learnSet.size(); ++index_1)
 		{
-			if (learnSet.size() == objects.size())
-#pragma omp parallel for
-				for (size_t index_2 = index_1 + 1; index_2 < learnSet.size(); ++index_2)
-				{
-					double dist = calcDist(learnSet[index_1], learnSet[index_2]);
-					neigbours[index_1][index_2 - 1] = neighbour_t(dist, {index_2, learnSet[index_2].getGoal()});
-					neigbours[index_2][index_1]     = neighbour_t(dist, {index_1, learnSet[index_1].getGoal()});
-				}
-			else
+			const NeighboursIndex::Neighbour* row = found.data() + index_1 * search_count;
+			for (size_t position = 0; position < counts[index_1]; ++position)
 			{
-#pragma omp parallel for
-				for (size_t index_2 = 0; index_2 < objects.size(); ++index_2)
-				{
-					double dist = (index_1 == objects_indexes[index_2]) ? std::numeric_limits<double>::max() : calcDist(learnSet[index_1], objects[index_2]);
-					neigbours[index_1][index_2] = neighbour_t(dist, {index_1, objects[index_2].getGoal()});
-				}
+				size_t index_2 = row[position].index;
+				if (same_objects ? index_1 == index_2 : index_1 == objects_indexes[index_2])
+					continue;
+				neigbours.offer(index_1, NeighboursList::Neighbour{row[position].distance, (uint32_t)index_2, (float)objects[index_2].getGoal()});
 			}
-		}
-		std::cout << "sort negibours data" << std::endl;
-#pragma omp parallel for
-		for (size_t neighbour_index = 0; neighbour_index < neigbours.size(); ++neighbour_index)
-		{
-			std::sort(neigbours[neighbour_index].begin(), neigbours[neighbour_index].end());
-			if (learnSet.size() == objects.size())
-				for (size_t index = 0; index < neigbours[neighbour_index].size() - 1; ++index)
-					renumerator[neighbour_index][neigbours[neighbour_index][index].second.first] = index;
+			neigbours.finish(index_1);
 		}
 	}
 
 
-	std::pair<double, double> KNearestNeighbours::predictRawest( neighbours_matrix_t& neigbours
-			                                                 , size_t object_index
-										                     , size_t left_count
-										                     , size_t right_count)
+	void KNearestNeighbours::prepare_folds(std::vector<Instance>& objects, const std::vector<std::vector<size_t>>& learn_indexes)
 	{
-			double left_positive_count = 0;
-			double left_negative_count = 0;
-
-			double right_positive_count = 0;
-			double right_negative_count = 0;
-			
-			size_t max_count = std::max(left_count, right_count);
-
-			for (size_t k = 0; k < max_count; ++k)
-			{
-				if (k < left_count)
-				{
-					if (neigbours[object_index][k].second.second == 1.0)
-					{
-						left_positive_count += m_neighbour_weight(k, left_count);
-					}
-					else
-					{
-						left_negative_count += m_neighbour_weight(k, left_count);
-					}
-				}
+		m_selected.clear();
+		m_item_positions.clear();
+		m_pool_neighbours.reset();
+		if (!m_fold_cache || objects.size() < 2)
+			return;
+
+		size_t min_learn_count = objects.size();
+		for (const std::vector<size_t>& indexes: learn_indexes)
+			min_learn_count = std::min(min_learn_count, indexes.size());
+		if (min_learn_count < 2)
+			return;
+
+		// a pool list is filtered down to about min_learn_count / objects
+		// of its entries, half again as many are kept so that only a few
+		// filtered lists fall short and are searched anew
+		size_t cache_count = std::min( objects.size() - 1
+									 , 3 * m_max_neighbours * (objects.size() - 1) / (2 * (min_learn_count - 1)) + 1);
+
+		std::cout << "Build fold cache of " << cache_count << " neighbours" << std::endl;
+		std::chrono::steady_clock::time_point build_start = std::chrono::steady_clock::now();
+		std::vector<size_t> objects_indexes;
+		m_pool_neighbours.reset(new NeighboursList());
+		createNeighboursMatrix(*m_pool_neighbours, objects, objects, objects_indexes, cache_count);
+		std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - build_start;
+		std::cout << "fold cache build time: " << build_time.count() << " s" << std::endl;
+	}
 
-				if (k < right_count)
-				{
-					if (neigbours[object_index][k].second.second == 1.0)
-					{
-						right_positive_count += m_neighbour_weight(k, right_count);
-					}
-					else
-					{
-						right_negative_count += m_neighbour_weight(k, right_count);
-					}
-				}
-			}
-			
-			double left_prediction  = left_positive_count  > left_negative_count  ? 1.0 : -1.0;
-			double right_prediction = right_positive_count > right_negative_count ? 1.0 : -1.0;
+	void KNearestNeighbours::select_objects(const std::vector<size_t>& indexes)
+	{
+		if (m_pool_neighbours)
+			m_selected = indexes;
+	}
 
-			return std::make_pair(left_prediction, right_prediction);
+	void KNearestNeighbours::finish_folds()
+	{
+		m_selected.clear();
+		m_item_positions.clear();
+		m_pool_neighbours.reset();
 	}
 
-	std::pair<double, double> KNearestNeighbours::testRaw( neighbours_matrix_t& neigbours
-													   , std::vector<Instance>& learnSet
-								                       , size_t left_count
-				                                       , size_t right_count)
+	bool KNearestNeighbours::cachedNeighboursMatrix( NeighboursList& neigbours
+												   , std::vector<Instance>& learnSet
+												   , std::vector<Instance>& objects
+												   , std::vector<size_t>& objects_indexes)
 	{
-		double left_true_positive  = 0.;
-		double left_false_positive = 0.;
-		double left_true_negative  = 0.;
-		double left_false_negative = 0.;
-
-		double right_true_positive  = 0.;
-		double right_false_positive = 0.;
-		double right_true_negative  = 0.;
-		double right_false_negative = 0.;
-
-		auto increment_metrics = [&learnSet]( double prediction
-				                            , size_t index
-								            , double& true_positive
-								            , double& false_positive
-				                            , double& true_negative
-				                            , double& false_negative)
+		if (!m_pool_neighbours || m_selected.size() != learnSet.size())
+			return false;
+
+		std::cout << "take nearest neighbours from the fold cache" << std::endl;
+		const NeighboursList& pool_neighbours = *m_pool_neighbours;
+		bool same_objects = objects_indexes.empty();
+		size_t max_count  = std::min(m_max_neighbours, same_objects ? learnSet.size() - 1 : objects.size());
+		neigbours.reset(learnSet.size(), max_count);
+
+		std::vector<uint32_t> positions(pool_neighbours.objects_count(), (uint32_t)-1);
+		for (size_t index = 0; index < objects.size(); ++index)
+			positions[m_selected[same_objects ? index : objects_indexes[index]]] = (uint32_t)index;
+
+		// a pool list never holds the object itself, so nothing else is
+		// skipped. The filtered list is exact when the pool list holds all
+		// objects or when its last taken neighbour is nearer than the last
+		// kept one, otherwise an object left out may be as near.
+		std::vector<unsigned char> missed(learnSet.size(), 0);
+#pragma omp parallel for schedule(dynamic, 256)
+		for (size_t index_1 = 0; index_1 < learnSet.size(); ++index_1)
 		{
-			if (prediction == learnSet.at(index).getGoal())
+			size_t pool_object = m_selected[index_1];
+			bool complete_list = pool_neighbours.count(pool_object) < pool_neighbours.max_count();
+			size_t count = 0;
+			double last_distance = 0.0;
+			for (const NeighboursList::Neighbour* it = pool_neighbours.begin(pool_object); it != pool_neighbours.end(pool_object) && count < max_count; ++it)
 			{
-				if (prediction == 1)
-				{
-					true_positive = true_positive + 1;
-				}
-				else
+				if (positions[it->index] != (uint32_t)-1)
 				{
-					true_negative = true_negative + 1;
+					last_distance = it->distance;
+					++count;
 				}
 			}
-			else
+
+			if (!complete_list && (count < max_count || (count > 0 && !(last_distance < pool_neighbours.at(pool_object, pool_neighbours.count(pool_object) - 1).distance))))
 			{
-				if (prediction == 1)
-				{
-					false_positive = false_positive + 1;
-				}
-				else
-				{
-					false_negative = false_negative + 1;
-				}
+				missed[index_1] = 1;
+				continue;
 			}
-		};
 
-		#pragma omp parallel for reduction (+:right_true_positive,right_false_positive,right_true_negative,right_false_negative,right_true_positive,right_false_positive,right_true_negative,right_false_negative)
-		for (size_t index = 0; index < learnSet.size(); index++)
+			count = 0;
+			for (const NeighboursList::Neighbour* it = pool_neighbours.begin(pool_object); it != pool_neighbours.end(pool_object) && count < max_count; ++it)
+			{
+				uint32_t index_2 = positions[it->index];
+				if (index_2 == (uint32_t)-1)
+					continue;
+				neigbours.offer(index_1, NeighboursList::Neighbour{it->distance, index_2, it->goal});
+				++count;
+			}
+			neigbours.finish(index_1);
+		}
+
+		// the short lists are found as without the cache over the fold objects
+		std::vector<size_t> missed_positions(learnSet.size(), (size_t)-1);
+		std::vector<Instance> missed_objects;
+		std::vector<size_t> missed_learn_indexes;
+		for (size_t index = 0; index < learnSet.size(); ++index)
 		{
+			if (!missed[index])
+				continue;
+			missed_positions[index] = missed_objects.size();
+			missed_objects.push_back(learnSet[index]);
+			missed_learn_indexes.push_back(index);
+		}
+
+		std::cout << "fold cache lists: " << learnSet.size() - missed_objects.size() << " | searched anew: " << missed_objects.size() << std::endl;
+		if (missed_objects.empty())
+			return true;
+
+		std::vector<size_t> missed_indexes(objects.size());
+		for (size_t index = 0; index < objects.size(); ++index)
+			missed_indexes[index] = missed_positions[same_objects ? index : objects_indexes[index]];
 
-			std::pair<double, double> prediction = predictRawest(neigbours, index, left_count, right_count);
-			increment_metrics(prediction.first, index, left_true_positive,  left_false_positive,  left_true_negative,  left_false_negative);
-			increment_metrics(prediction.second, index, right_true_positive, right_false_positive, right_true_negative, right_false_negative);
+		NeighboursList missed_neighbours;
+		createNeighboursMatrix(missed_neighbours, missed_objects, objects, missed_indexes, max_count);
+		for (size_t index = 0; index < missed_objects.size(); ++index)
+		{
+			size_t index_1 = missed_learn_indexes[index];
+			for (const NeighboursList::Neighbour* it = missed_neighbours.begin(index); it != missed_neighbours.end(index); ++it)
+				neigbours.offer(index_1, *it);
+			neigbours.finish(index_1);
 		}
-		
-		double left_quality =  Metrics::F1ScoreMetric(left_true_positive, left_false_positive, left_true_negative, left_false_negative);
-		double right_quality =  Metrics::F1ScoreMetric(right_true_positive, right_false_positive, right_true_negative, right_false_negative);
-		return std::make_pair(left_quality, right_quality);
-	}
 
-	double KNearestNeighbours::predictRaw(const Instance& object)
-	{
-		std::vector<Instance>* results = new std::vector<Instance>;
-		std::vector<double>* distances = new std::vector<double>();
-	    m_neighbours.search(object, (int)m_effective_count, results, distances);
-		double positive_count = 0;
-		double negative_count = 0;
-		size_t index = 0;
-		std::for_each(results->begin(), results->end(),
-				[this, &index, &positive_count, &negative_count](const auto& neighbour)
-				{
-					if (neighbour.getGoal() == 1.0)
-						positive_count += m_neighbour_weight(index, m_effective_count);
-					else
-						negative_count += m_neighbour_weight(index, m_effective_count);
-					index++;
-				});
-		delete distances;
-		double prediction =  positive_count > negative_count ? 1.0 : -1.0;
-		return prediction;
+		return true;
 	}
 
-	double KNearestNeighbours::calcDist(const Instance& first, const Instance& second)
+	bool KNearestNeighbours::cachedSearch( std::vector<Instance>& objects
+										 , size_t k
+										 , std::pmr::vector<NeighboursIndex::Neighbour>& neighbours
+										 , std::pmr::vector<size_t>& counts)
 	{
-		return m_distance->calc(first.getFeatures(), second.getFeatures());
-	}
+		// an approximate index answers with its own neighbours, not the exact cached ones
+		if (!m_pool_neighbours || m_item_positions.empty() || m_selected.size() != objects.size() || !m_index->exact())
+			return false;
+
+		const NeighboursList& pool_neighbours = *m_pool_neighbours;
+		neighbours.assign(objects.size() * k, NeighboursIndex::Neighbour{0.0, 0});
+		counts.assign(objects.size(), 0);
+		std::vector<unsigned char> missed(objects.size(), 0);
+#pragma omp parallel for schedule(dynamic, 256)
+		for (size_t index = 0; index < objects.size(); ++index)
+		{
+			size_t pool_object = m_selected[index];
+			NeighboursIndex::Neighbour* row = neighbours.data() + index * k;
+			size_t count = 0;
 
-	double KNearestNeighbours::fris_stolp( neighbours_matrix_t& neighbours
-			                            , std::vector<std::vector<size_t>>& renumerator
-										, size_t first
-										, size_t second
-										, size_t base)
-	{
-		size_t first_second_index = renumerator[first][second];
-		size_t first_base_index   = renumerator[first][base];
-		double first_second_dist = neighbours[first][first_second_index].first;
-		double first_base_dist   = neighbours[first][first_base_index].first;
-		return (-first_second_dist + first_base_dist) / (first_second_dist + first_base_dist) + 1.0;
-	}
+			// an item is found by the search at zero distance from itself
+			if (k > 0 && m_item_positions[pool_object] != (uint32_t)-1)
+				row[count++] = NeighboursIndex::Neighbour{0.0, m_item_positions[pool_object]};
 
-	size_t KNearestNeighbours::get_nearest_neighbour( neighbours_matrix_t& neighbours
-			                                        , std::vector<std::vector<size_t>>& renumerator
-			                                        , size_t object_index
-													, const std::unordered_set<size_t>&  available_objects)
-	{
-		size_t object_index_f = 0;
-		if (available_objects.size()> 0.4 * neighbours.size())
-			for(const neighbour_t& neighbour: neighbours[object_index])
+			for (const NeighboursList::Neighbour* it = pool_neighbours.begin(pool_object); it != pool_neighbours.end(pool_object) && count < k; ++it)
 			{
-				if (available_objects.find(neighbour.second.first) != available_objects.end())
-				{
-					object_index_f = neighbour.second.first;
-					break;
-				}
+				uint32_t position = m_item_positions[it->index];
+				if (position != (uint32_t)-1)
+					row[count++] = NeighboursIndex::Neighbour{it->distance, position};
 			}
-		else
+
+			bool complete_list = pool_neighbours.count(pool_object) < pool_neighbours.max_count();
+			if (!complete_list && (count < k || (count > 0 && !(row[count - 1].distance < pool_neighbours.at(pool_object, pool_neighbours.count(pool_object) - 1).distance))))
+				missed[index] = 1;
+			else
+				counts[index] = count;
+		}
+
+#pragma omp parallel
 		{
-			double min_dist = neighbours[object_index][renumerator[object_index][*available_objects.begin()]].first;
-			for (const size_t& n_index: available_objects)
+			std::vector<NeighboursIndex::Neighbour> found;
+#pragma omp for schedule(dynamic, 16)
+			for (size_t index = 0; index < objects.size(); ++index)
 			{
-				if (n_index == object_index)
+				if (!missed[index])
 					continue;
-				double dist = neighbours[object_index][renumerator[object_index][n_index]].first;
-				if (dist <= min_dist)
-				{
-					object_index_f = n_index;
-					min_dist = dist;
-				}
+				m_index->search(objects[index].getFeatures(), k, found);
+				std::copy(found.begin(), found.end(), neighbours.begin() + index * k);
+				counts[index] = found.size();
 			}
 		}
 
-		return object_index_f;
+		return true;
 	}
 
-	double KNearestNeighbours::calculate_efficiency( neighbours_matrix_t& neighbours
-												  , std::vector<std::vector<size_t>>& renumerator
-												  , std::vector<Instance>& objects
-												  , size_t object_index
-												  , const std::unordered_set<size_t>&  positive_objects
-												  , const std::unordered_set<size_t>&  negative_objects
-												  , const std::unordered_set<size_t>&  ethalons)
+	size_t KNearestNeighbours::select_neighbours_count(NeighboursList& neigbours, std::vector<Instance>& learnSet)
 	{
-		double defense = 0.0;
-#pragma omp parallel for reduction (+:defense)
-		for(const size_t& object: positive_objects)
+		// every odd k up to the list bound is scored in one pass over the lists
+		size_t max_count     = neigbours.max_count();
+		size_t counts_number = (max_count + 1) / 2;
+		if (counts_number == 0)
+			return 1;
+
+		// weights[c][i] is the weight of the i-th neighbour when k = 2c + 1
+		// neighbours vote. If every weights[c] is base_weights scaled by a
+		// positive factor, the votes for all k are prefix sums of one row.
+		std::vector<double> base_weights(max_count);
+		for (size_t index = 0; index < max_count; ++index)
+			base_weights[index] = m_neighbour_weight(index, max_count);
+
+		auto is_scaled = [&base_weights](const std::vector<double>& weights) -> bool
 		{
-			if (object_index == object)
-				continue;
-			size_t nearest = get_nearest_neighbour(neighbours, renumerator, object, ethalons);
-			double fris = fris_stolp(neighbours, renumerator, object, object_index, nearest);
-			defense = defense + fris;
-		}
-		if (positive_objects.size() > 1)
-			defense /= (double)(positive_objects.size() - 1);
-		double tolerance = 0.0;
-#pragma omp parallel for reduction (+:tolerance)
-		for(const size_t& object: negative_objects)
-		{
-			size_t nearest = get_nearest_neighbour(neighbours, renumerator, object, ethalons);
-			double fris = fris_stolp(neighbours, renumerator, object, object_index, nearest);
-			tolerance = tolerance + fris;
-		}
-		if (!negative_objects.empty())
-			tolerance /= (double)negative_objects.size();
-		return 0.5 * defense + 0.5 * tolerance;
-	}
-
-	std::pair<size_t, size_t> KNearestNeighbours::find_ethalons( neighbours_matrix_t& neighbours
-			                                                   , std::vector<std::vector<size_t>>& renumerator
-										                       , std::vector<Instance>& objects
-										                       , const std::unordered_set<size_t>&  positive_objects
-															   , const std::unordered_set<size_t>&  positive_ethalons
-										                       , const std::unordered_set<size_t>&  negative_objects
-															   , const std::unordered_set<size_t>&  negative_ethalons)
-	{
-		auto most_efficienct = [this, &neighbours, &renumerator, &objects] ( const std::unordered_set<size_t>&  positive_objects
-													                       , const std::unordered_set<size_t>&  negative_objects
-															               , const std::unordered_set<size_t>&  ethalons) -> size_t
-		{
-			size_t most_efficient_positive = neighbours.size();
-			double  most_efficiency_positive = -10.0;
-			for (const size_t& object_index: positive_objects)
+			double factor = 0.0;
+			for (size_t index = 0; index < weights.size(); ++index)
 			{
-				double efficiency = calculate_efficiency( neighbours
-						                               , renumerator
-						                               , objects
-													   , object_index
-													   , positive_objects
-													   , negative_objects
-													   , ethalons);
-
-				if (efficiency >= most_efficiency_positive)
+				if (std::isfinite(base_weights[index]) && base_weights[index] != 0.0)
 				{
-					most_efficient_positive  = object_index;
-					most_efficiency_positive = efficiency;
+					factor = weights[index] / base_weights[index];
+					break;
 				}
 			}
 
-			return most_efficient_positive;
+			for (size_t index = 0; index < weights.size(); ++index)
+			{
+				if (weights[index] == base_weights[index])
+					continue;
+				if (!(factor > 0.0) || !(std::fabs(weights[index] - factor * base_weights[index]) <= 1e-9 * std::fabs(weights[index])))
+					return false;
+			}
+
+			return true;
 		};
 
-		size_t ethalon_positive = most_efficienct(positive_objects, negative_objects, negative_ethalons);
-		size_t ethalon_negative = most_efficienct(negative_objects, positive_objects, positive_ethalons);
-		return std::make_pair(ethalon_positive, ethalon_negative);
-	}
+		bool separable = true;
+		std::vector<std::vector<double>> weights(counts_number);
+		for (size_t count_index = 0; count_index < counts_number; ++count_index)
+		{
+			size_t k = 2 * count_index + 1;
+			weights[count_index].resize(k);
+			for (size_t index = 0; index < k; ++index)
+				weights[count_index][index] = m_neighbour_weight(index, k);
+			separable = separable && is_scaled(weights[count_index]);
+		}
 
-	std::unordered_set<size_t> KNearestNeighbours::check_fail_objects( neighbours_matrix_t& neighbours
-			                                                         , std::vector<std::vector<size_t>>& renumerator
-												                     , std::vector<Instance>& objects
-												                     , const std::unordered_set<size_t>&  positive_objects
-																	 , const std::unordered_set<size_t>&  positive_ethalons
-												                     , const std::unordered_set<size_t>&  negative_objects
-																	 , const std::unordered_set<size_t>&  negative_ethalons)
-	{
-		auto check_failes = [this, &neighbours, &renumerator, &objects]( const std::unordered_set<size_t>&  positive_objects
-														               , const std::unordered_set<size_t>&  positive_ethalons 
-				                                                       , const std::unordered_set<size_t>&  negative_objects
-														               , const std::unordered_set<size_t>&  negative_ethalons)
-											   	   -> std::unordered_set<size_t>
+		// true positive, false positive, true negative, false negative for every k
+		std::vector<double> confusion(4 * counts_number, 0.0);
+#pragma omp parallel
 		{
-			std::vector<std::pair<size_t, double>> objects_fris;
-			double max_fris = 0.0;
-			size_t max_obj = 0;
-			double min_fris = 2.0;
-			size_t min_obj = 0;
-			for (const size_t& object_index: positive_objects)
+			std::vector<double> local_confusion(4 * counts_number, 0.0);
+#pragma omp for nowait schedule(dynamic, 64)
+			for (size_t object_index = 0; object_index < learnSet.size(); ++object_index)
 			{
-				size_t positive_nearest = get_nearest_neighbour(neighbours, renumerator, object_index, positive_ethalons);
-				size_t negative_nearest = get_nearest_neighbour(neighbours, renumerator, object_index, negative_ethalons);
-
-				double fris = fris_stolp(neighbours, renumerator, object_index, positive_nearest, negative_nearest);
-				if (fris >= max_fris)
-				{
-					max_fris = fris;
-					max_obj = object_index;
-				}
-				if (fris <= min_fris)
+				const NeighboursList::Neighbour* row = neigbours.begin(object_index);
+				size_t row_count   = neigbours.count(object_index);
+				bool positive_goal = learnSet[object_index].getGoal() == 1.0;
+
+				double positive_votes = 0.0;
+				double negative_votes = 0.0;
+				size_t position = 0;
+				for (size_t count_index = 0; count_index < counts_number; ++count_index)
 				{
-					min_fris = fris;
-					min_obj = object_index;
+					size_t k = std::min(2 * count_index + 1, row_count);
+					double positive = 0.0;
+					double negative = 0.0;
+					if (separable)
+					{
+						for (; position < k; ++position)
+							(row[position].goal == 1.0f ? positive_votes : negative_votes) += base_weights[position];
+						positive = positive_votes;
+						negative = negative_votes;
+					}
+					else
+					{
+						for (size_t index = 0; index < k; ++index)
+							(row[index].goal == 1.0f ? positive : negative) += weights[count_index][index];
+					}
+
+					size_t cell = positive > negative ? (positive_goal ? 0 : 1) : (positive_goal ? 3 : 2);
+					local_confusion[4 * count_index + cell] += 1.0;
 				}
-				objects_fris.push_back({object_index, fris});
 			}
+#pragma omp critical
+			for (size_t index = 0; index < confusion.size(); ++index)
+				confusion[index] += local_confusion[index];
+		}
 
-			double mean_fris = (max_fris - min_fris) / 2;
-			std::cout << max_fris << " " << mean_fris << " " << min_fris << " " << objects_fris.size() << std::endl;
-			std::unordered_set<size_t> filtered_objects;
-			double true_treshold = std::min(1.8, max_fris - 0.05 * mean_fris);
-			double fail_treshold = std::max(0.2, 0.05 * mean_fris + min_fris);
-			for (const auto& value: objects_fris)
+		size_t best_count   = 1;
+		double best_quality = -1.0;
+		for (size_t count_index = 0; count_index < counts_number; ++count_index)
+		{
+			double quality = Metrics::F1ScoreMetric( confusion[4 * count_index]
+												   , confusion[4 * count_index + 1]
+												   , confusion[4 * count_index + 2]
+												   , confusion[4 * count_index + 3]);
+			if (quality > best_quality)
 			{
-				if (value.second <= fail_treshold || value.second >= true_treshold)
-				{
-					filtered_objects.insert(value.first);
-				}
+				best_quality = quality;
+				best_count   = 2 * count_index + 1;
 			}
+		}
 
-			//filtered_objects.insert(max_obj);
-			//filtered_objects.insert(min_obj);
-
-			return filtered_objects;
-		};
-
-		std::unordered_set<size_t> positive_failes = check_failes(positive_objects, positive_ethalons, negative_objects, negative_ethalons);
-		std::unordered_set<size_t> negative_failes = check_failes(negative_objects, negative_ethalons, positive_objects, positive_ethalons);
-		if (!negative_failes.empty())
-			positive_failes.insert(negative_failes.begin(), negative_failes.end());
+		std::cout << "neighbours counts checked: " << counts_number << (separable ? " (prefix sums)" : "") << std::endl
+		          << "best neighbours count: " << best_count << " : " << best_quality << std::endl;
 
-		return positive_failes;
+		return best_count;
 	}
 
-	std::unordered_set<size_t> KNearestNeighbours::select_objects( neighbours_matrix_t& neighbours
-			                                                     , std::vector<std::vector<size_t>>& renumerator
-												                 , std::vector<Instance>& objects)
+	double KNearestNeighbours::predictRaw(const Instance& object)
 	{
-		std::unordered_set<size_t> positive_objects;
-		std::unordered_set<size_t> negative_objects;
-
-		std::cout << "split objects by classes" << std::endl;
+		// reused by the queries of a thread
+		thread_local std::vector<NeighboursIndex::Neighbour> neighbours;
+		m_index->search(object.getFeatures(), m_effective_count, neighbours);
+		return vote(neighbours.data(), neighbours.size());
+	}
 
-		for (size_t object_index = 0; object_index < objects.size(); ++object_index)
+	void KNearestNeighbours::predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions)
+	{
+		// the neighbour lists share the resource of the predictions, the fold arena in cross validation
+		std::pmr::memory_resource* resource = predictions.get_allocator().resource();
+		std::pmr::vector<NeighboursIndex::Neighbour> neighbours(resource);
+		std::pmr::vector<size_t> counts(resource);
+		std::chrono::steady_clock::time_point search_start = std::chrono::steady_clock::now();
+		bool cached = cachedSearch(objects, m_effective_count, neighbours, counts);
+		if (!cached)
+			m_index->search_batch(objects, m_effective_count, neighbours, counts);
+		std::chrono::duration<double> search_time = std::chrono::steady_clock::now() - search_start;
+		std::cout << (cached ? "fold cache" : m_index->name()) << " query time: " << search_time.count() << " s for " << objects.size() << " objects" << std::endl;
+		if (m_report_recall && !m_index->exact())
+			report_recall(objects, neighbours, counts, search_time.count());
+
+		predictions.resize(objects.size());
+#pragma omp parallel for
+		for (size_t index = 0; index < objects.size(); ++index)
 		{
-			if (objects[object_index].getGoal() == 1.0)
-				positive_objects.insert(object_index);
-			else
-				negative_objects.insert(object_index);
+			predictions[index] = vote(neighbours.data() + index * m_effective_count, counts[index]);
 		}
+	}
 
-		std::cout << "init ethalons" << std::endl;
-		std::pair<size_t, size_t> init_ethalons = find_ethalons( neighbours
-				                                               , renumerator
-				                                               , objects
-															   , positive_objects
-															   , positive_objects
-															   , negative_objects
-															   , negative_objects);
-
-		std::unordered_set<size_t> positive_ethalons({init_ethalons.first});
-		positive_objects.erase(init_ethalons.first);
-
-		std::unordered_set<size_t> negative_ethalons({init_ethalons.second});
-		negative_objects.erase(init_ethalons.second);
-
-		size_t iteration = 0;
-
-		while (!positive_objects.empty() || !negative_objects.empty())
+	void KNearestNeighbours::report_recall( std::vector<Instance>& objects
+										  , const std::pmr::vector<NeighboursIndex::Neighbour>& neighbours
+										  , const std::pmr::vector<size_t>& counts
+										  , double search_time)
+	{
+		VpTreeIndex exact_index(m_distance);
+		exact_index.build(m_items);
+
+		std::pmr::vector<NeighboursIndex::Neighbour> exact_neighbours(neighbours.get_allocator().resource());
+		std::pmr::vector<size_t> exact_counts(neighbours.get_allocator().resource());
+		std::chrono::steady_clock::time_point search_start = std::chrono::steady_clock::now();
+		exact_index.search_batch(objects, m_effective_count, exact_neighbours, exact_counts);
+		std::chrono::duration<double> exact_time = std::chrono::steady_clock::now() - search_start;
+
+		size_t found_count = 0;
+		size_t exact_count = 0;
+#pragma omp parallel for reduction(+:found_count,exact_count)
+		for (size_t index = 0; index < objects.size(); ++index)
 		{
-			std::cout << "iteration: " << iteration << std::endl;
-			std::cout << "positive objects: "  << positive_objects.size()  << std::endl
-				      << "negative objects: "  << negative_objects.size()  << std::endl
-					  << "positive ethalons: " << positive_ethalons.size() << std::endl
-					  << "negative ethalons: " << negative_ethalons.size() << std::endl;
-			std::cout << "\tcheck good classified and noise objects" << std::endl;
-			std::unordered_set<size_t> failes = check_fail_objects( neighbours
-					                                              , renumerator
-					                                              , objects
-																  , positive_objects
-																  , positive_ethalons
-																  , negative_objects
-																  , negative_ethalons);
-
-			std::cout << "\t\tcount: " << failes.size() << std::endl;
-
-			for (const size_t& object_index: failes)
+			const NeighboursIndex::Neighbour* found = neighbours.data() + index * m_effective_count;
+			const NeighboursIndex::Neighbour* exact = exact_neighbours.data() + index * m_effective_count;
+			for (size_t position = 0; position < exact_counts[index]; ++position)
 			{
-				if (objects[object_index].getGoal() == 1.0)
-				{
-					positive_objects.erase(object_index);
-					//positive_ethalons.erase(object_index);
-				}
-				else
+				for (size_t other = 0; other < counts[index]; ++other)
 				{
-					negative_objects.erase(object_index);
-					//negative_ethalons.erase(object_index);
+					if (found[other].index == exact[position].index)
+					{
+						++found_count;
+						break;
+					}
 				}
 			}
-			bool positive_cleaned = positive_ethalons.empty();
-			bool negative_cleaned = negative_ethalons.empty();
-			std::cout << "find ethalons" << std::endl;
-			if (positive_ethalons.empty())
-				positive_ethalons = positive_objects;
-			if (negative_ethalons.empty())
-				negative_ethalons = negative_objects;
-
-
-			std::pair<size_t, size_t> ethalons = find_ethalons( neighbours
-					                                          , renumerator
-					                                          , objects
-															  , positive_objects
-															  , positive_ethalons
-															  , negative_objects
-															  , negative_ethalons);
-			if (ethalons.first != (size_t)-1)
-			{
-				if (positive_cleaned)
-					positive_ethalons.clear();
-				positive_ethalons.insert(ethalons.first);
-				positive_objects.erase  (ethalons.first);
-			}
+			exact_count += exact_counts[index];
+		}
 
-			if (ethalons.second != (size_t)-1)
-			{
-				if (negative_cleaned)
-					negative_ethalons.clear();
-				negative_ethalons.insert(ethalons.second);
-				negative_objects.erase  (ethalons.second);
-			}
+		std::cout << "recall@" << m_effective_count << " : " << (exact_count > 0 ? double(found_count) / exact_count : 1.0)
+				  << " | " << m_index->name() << " : " << objects.size() / std::max(search_time, 1e-9) << " objects/s"
+				  << " | exact vp_tree : " << objects.size() / std::max(exact_time.count(), 1e-9) << " objects/s" << std::endl;
+	}
 
-			iteration++;
+	double KNearestNeighbours::vote(const NeighboursIndex::Neighbour* neighbours, size_t count) const
+	{
+		double positive_count = 0;
+		double negative_count = 0;
+		for (size_t index = 0; index < count; ++index)
+		{
+			if (m_items[neighbours[index].index].getGoal() == 1.0)
+				positive_count += m_vote_weights[index];
+			else
+				negative_count += m_vote_weights[index];
 		}
 
-		positive_ethalons.insert(negative_ethalons.begin(), negative_ethalons.end());
-		positive_ethalons.insert(positive_objects.begin(), positive_objects.end());
-		positive_ethalons.insert(negative_objects.begin(), negative_objects.end());
-		return positive_ethalons;
+		return positive_count > negative_count ? 1.0 : -1.0;
+	}
+
+	double KNearestNeighbours::calcDist(const Instance& first, const Instance& second)
+	{
+		return m_distance->calc(first.getFeatures(), second.getFeatures());
 	}
 }
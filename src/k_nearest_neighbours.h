@@ -2,17 +2,18 @@
 #define K_NEAREST_NEGIHBOURS
 
 #include <functional>
-#include <unordered_set>
 #include <vector>
 #include <math.h>
 #include <memory>
+#include <memory_resource>
 
 #include "instance.h"
 #include "metric.h"
 #include "mathvector.h"
 #include "mathvector_norm.h"
 #include "predictor.h"
-#include "vp_tree.h"
+#include "neighbours_list.h"
+#include "neighbours_index.h"
 
 using namespace DataStructures;
 using namespace MathCore::AlgebraCore::VectorCore;
@@ -20,10 +21,6 @@ using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
 
 namespace MachineLearning
 {
-	typedef std::pair<double, std::pair<size_t, double>> neighbour_t;
-	typedef std::vector<neighbour_t> neighbours_t;
-	typedef std::vector<neighbours_t> neighbours_matrix_t;
-
 	typedef std::function<double(size_t index, size_t k)> neighbour_weight_t;
 
 	class KNearestNeighbours : public Predictor
@@ -36,76 +33,73 @@ namespace MachineLearning
 		static double log_weight  (size_t index, size_t k) { return log2(1.0 - exp(-index)); }
 		
 	public:
-		KNearestNeighbours(size_t _featuresCount, std::shared_ptr<MathVectorNorm<double>> distance, neighbour_weight_t neighbour_weight = KNearestNeighbours::const_weight, bool fris_stolp = false);
+		KNearestNeighbours(size_t _featuresCount, std::shared_ptr<MathVectorNorm<double>> distance, neighbour_weight_t neighbour_weight = KNearestNeighbours::const_weight, bool fris_stolp = false, size_t max_neighbours = 64, NeighboursIndexPtr index = nullptr, bool report_recall = false, size_t pivots_count = 0, bool fold_cache = false);
 
 		double predict(MathVector<double>& features);
+		void predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions);
 		void learn( std::vector<Instance>& learnSet
 				  , std::vector<double>& objectsWeights
 				  , std::vector<std::pair<double, double>>& learning_curve);
 
+		// with the fold cache the nearest neighbours of every pool object are
+		// found once, the lists of the folds and the test queries are taken
+		// from them without the objects out of the learn fold
+		void prepare_folds(std::vector<Instance>& objects, const std::vector<std::vector<size_t>>& learn_indexes);
+		void select_objects(const std::vector<size_t>& indexes);
+		void finish_folds();
+
 		size_t getFeaturesCount();
 		size_t get_model_complexity();
 
-		Predictor* clone() const { return new KNearestNeighbours(*this);};
+		Predictor* clone() const;
 
 	private:
-		void createNeighboursMatrix( neighbours_matrix_t& neigbours
-				                   , std::vector<std::vector<size_t>>& renumerator
-				                   , std::vector<Instance>& learnSet
+		// keeps max_neighbours nearest objects for every learn object
+		void createNeighboursMatrix( NeighboursList& neigbours
+								   , std::vector<Instance>& learnSet
+								   , std::vector<Instance>& objects
+								   , std::vector<size_t>& objects_indexes
+								   , size_t max_neighbours);
+		// the same lists taken from the fold cache, false when the learn
+		// objects are not selected pool objects
+		bool cachedNeighboursMatrix( NeighboursList& neigbours
+								   , std::vector<Instance>& learnSet
 								   , std::vector<Instance>& objects
 								   , std::vector<size_t>& objects_indexes);
-		std::pair<double, double> predictRawest(neighbours_matrix_t& neigbours, size_t object_index, size_t left_count, size_t right_count);
-		std::pair<double, double> testRaw(neighbours_matrix_t& neigbours, std::vector<Instance>& learnSet, size_t left_count, size_t right_count);
+		// k nearest items of selected pool objects, false when the cache can not answer
+		bool cachedSearch( std::vector<Instance>& objects
+						 , size_t k
+						 , std::pmr::vector<NeighboursIndex::Neighbour>& neighbours
+						 , std::pmr::vector<size_t>& counts);
+		// leave-one-out F1 of every odd k up to the list bound, returns the best k
+		size_t select_neighbours_count(NeighboursList& neigbours, std::vector<Instance>& learnSet);
 
 		double predictRaw(const Instance& object);
+		double vote(const NeighboursIndex::Neighbour* neighbours, size_t count) const;
+		// share of the exact VP-tree neighbours found by an approximate index
+		void report_recall( std::vector<Instance>& objects
+						  , const std::pmr::vector<NeighboursIndex::Neighbour>& neighbours
+						  , const std::pmr::vector<size_t>& counts
+						  , double search_time);
 		double calcDist(const Instance& first, const Instance& second);
-	double fris_stolp( neighbours_matrix_t& neighbours
-			        , std::vector<std::vector<size_t>>& renumerator
-					, size_t first
-					, size_t second
-					, size_t base);
-
-
-		size_t get_nearest_neighbour( neighbours_matrix_t& neighbours
-				                    , std::vector<std::vector<size_t>>& renumerator
-			                        , size_t object_index
-									, const std::unordered_set<size_t>&  available_objects);
-
-		double calculate_efficiency( neighbours_matrix_t& neighbours
-                                  , std::vector<std::vector<size_t>>& renumerator
-								  , std::vector<Instance>& objects
-								  , size_t object_index
-								  , const std::unordered_set<size_t>&  positive_objects
-								  , const std::unordered_set<size_t>&  negative_objects
-								  , const std::unordered_set<size_t>&  ethalons);
-
-		std::unordered_set<size_t> check_fail_objects( neighbours_matrix_t& neighbours
-				                                     , std::vector<std::vector<size_t>>& renumerator
-												     , std::vector<Instance>& objects
-												     , const std::unordered_set<size_t>&  positive_objects
-													 , const std::unordered_set<size_t>&  positive_ethalons
-												     , const std::unordered_set<size_t>&  negative_objects
-												     , const std::unordered_set<size_t>&  negative_ethalons);
-
-
-		std::pair<size_t, size_t> find_ethalons( neighbours_matrix_t& neighbours
-				                               , std::vector<std::vector<size_t>>& renumerator
-											   , std::vector<Instance>& objects
-										       , const std::unordered_set<size_t>&  positive_objects
-										       , const std::unordered_set<size_t>&  positive_ethalons
-										       , const std::unordered_set<size_t>&  negative_objects
-										       , const std::unordered_set<size_t>&  negative_ethalons);
-
-		std::unordered_set<size_t> select_objects( neighbours_matrix_t& neighbours
-				                                 , std::vector<std::vector<size_t>>& renumerator
-												 , std::vector<Instance>& objects);
 
 	private:
 		std::shared_ptr<MathVectorNorm<double>> m_distance;
 		neighbour_weight_t m_neighbour_weight;
-		VpTree<Instance> m_neighbours;
+		NeighboursIndexPtr m_index;
+		std::vector<Instance> m_items;
 		size_t m_effective_count;
+		std::vector<double> m_vote_weights;
 		bool m_fris_stolp;
+		size_t m_max_neighbours;
+		bool m_report_recall;
+		bool m_fold_cache;
+		// nearest neighbours of every pool object, shared by the clones
+		std::shared_ptr<NeighboursList> m_pool_neighbours;
+		// pool positions of the objects of the next calls
+		std::vector<size_t> m_selected;
+		// position among the items of every pool object, -1 for the others
+		std::vector<uint32_t> m_item_positions;
 	};
 }
 
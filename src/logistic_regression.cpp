@@ -58,6 +58,18 @@ double LogisticRegression::predict(MathVector<double>& features)
 	return this->activate->calc(_product); 
 }
 
+size_t LogisticRegression::linear_weights(std::vector<const MathVector<double>*>& _weights)
+{
+	_weights.push_back(&this->weights);
+
+	return 1;
+}
+
+double LogisticRegression::predict_scores(const double* products)
+{
+	return this->activate->calc(products[0] - this->threshold);
+}
+
 void LogisticRegression::setIterationInterval(size_t _minimalIterations, size_t _maximalIterations)
 {
 	this->minimalIterations = _minimalIterations;
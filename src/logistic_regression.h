@@ -68,6 +68,8 @@ namespace MachineLearning
 			{ }
 
 			double predict(MathVector<double>& features);
+			size_t linear_weights(std::vector<const MathVector<double>*>& _weights);
+			double predict_scores(const double* products);
 			void learn( std::vector<Instance>& learnSet
 					  , std::vector<double>& objectsWeights
 					  , std::vector<std::pair<double, double>>& learning_curve);
@@ -77,6 +79,7 @@ namespace MachineLearning
 			size_t get_model_complexity();
 
 			Predictor* clone() const { return new LogisticRegression(*this);};
+			bool uses_weights() const { return true;};
 		private:
 			double scalarProduct(MathVector<double>& features);
 			double predictRaw(double _scalar);
@@ -19,6 +19,11 @@ namespace MachineLearning
 			{
 				return 0;
 			}
+
+			virtual double dx2(double margin)
+			{
+				return 0;
+			}
 	};
 
 	struct QuadraticLossFunction : public LossFunctionApproximation
@@ -77,7 +82,13 @@ namespace MachineLearning
 
 			double dx(double margin)
 			{
-				return -std::exp(-margin) / ((1 + std::exp(-margin)) + log(2));
+				return -2.0 / (log(2.0) * (1 + std::exp(margin)));
+			}
+
+			double dx2(double margin)
+			{
+				double probability = 1.0 / (1 + std::exp(-margin));
+				return 2.0 / log(2.0) * probability * (1.0 - probability);
 			}
 	};
 
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "lsh_index.h"
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	LshIndex::LshIndex( std::shared_ptr<MathVectorNorm<double>> distance
+					  , LshType type
+					  , size_t bands
+					  , size_t rows
+					  , unsigned int seed)
+	: m_distance(distance)
+	, m_type(type)
+	, m_bands(std::max((size_t)1, bands))
+	, m_rows(std::max((size_t)1, rows))
+	{
+		std::mt19937_64 generator(seed);
+		size_t hashes_count = m_bands * m_rows;
+		m_multipliers.resize(hashes_count);
+		m_offsets.resize(hashes_count);
+		for (size_t index = 0; index < hashes_count; ++index)
+		{
+			m_multipliers[index] = generator() | 1;
+			m_offsets[index]     = generator();
+		}
+	}
+
+	void LshIndex::band_keys(const MathVector<double>& features, Scratch& scratch) const
+	{
+		size_t hashes_count = m_multipliers.size();
+		const uint64_t* multipliers = m_multipliers.data();
+		const uint64_t* offsets     = m_offsets.data();
+
+		// the hash loops run over contiguous arrays for every term so they vectorize
+		std::vector<uint32_t>& signature = scratch.minimums;
+		if (m_type == LshType::MINHASH)
+		{
+			signature.assign(hashes_count, std::numeric_limits<uint32_t>::max());
+			uint32_t* minimums = signature.data();
+			for (auto it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
+			{
+				if (it.getElem() == 0.0)
+					continue;
+
+				uint64_t term = it.index();
+				for (size_t index = 0; index < hashes_count; ++index)
+				{
+					uint32_t hash = (uint32_t)((multipliers[index] * term + offsets[index]) >> 32);
+					minimums[index] = std::min(minimums[index], hash);
+				}
+			}
+		}
+		else
+		{
+			scratch.projections.assign(hashes_count, 0.0);
+			double* projections = scratch.projections.data();
+			for (auto it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
+			{
+				uint64_t term  = it.index();
+				double   value = it.getElem();
+				for (size_t index = 0; index < hashes_count; ++index)
+				{
+					int64_t hash = (int64_t)(multipliers[index] * term + offsets[index]);
+					projections[index] += hash < 0 ? -value : value;
+				}
+			}
+
+			signature.resize(hashes_count);
+			for (size_t index = 0; index < hashes_count; ++index)
+				signature[index] = projections[index] >= 0.0 ? 1 : 0;
+		}
+
+		scratch.keys.resize(m_bands);
+		for (size_t band = 0; band < m_bands; ++band)
+		{
+			uint64_t key = band + 1;
+			for (size_t row = 0; row < m_rows; ++row)
+				key = (key ^ signature[band * m_rows + row]) * 0x9E3779B97F4A7C15ull;
+			scratch.keys[band] = (uint32_t)(key >> 32);
+		}
+	}
+
+	void LshIndex::build(const std::vector<Instance>& items)
+	{
+		size_t items_count = items.size();
+		m_features.resize(items_count);
+		for (size_t index = 0; index < items_count; ++index)
+			m_features[index] = &items[index].getFeatures();
+
+		// one pass over the items fills every table, the tables are then sorted independently
+		m_tables.resize(m_bands * items_count);
+#pragma omp parallel
+		{
+			Scratch scratch;
+#pragma omp for schedule(dynamic, 256)
+			for (size_t index = 0; index < items_count; ++index)
+			{
+				band_keys(*m_features[index], scratch);
+				for (size_t band = 0; band < m_bands; ++band)
+					m_tables[band * items_count + index] = BucketEntry{scratch.keys[band], (uint32_t)index};
+			}
+		}
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (size_t band = 0; band < m_bands; ++band)
+			std::sort(m_tables.begin() + band * items_count, m_tables.begin() + (band + 1) * items_count);
+	}
+
+	void LshIndex::search( const MathVector<double>& target
+						 , size_t k
+						 , std::vector<Neighbour>& neighbours) const
+	{
+		// the scratch of a thread is kept, its marks are cleared by a new generation
+		thread_local Scratch scratch;
+		query(target, k, scratch, neighbours);
+	}
+
+	void LshIndex::search_batch( const std::vector<Instance>& targets
+							   , size_t k
+							   , std::pmr::vector<Neighbour>& neighbours
+							   , std::pmr::vector<size_t>& counts) const
+	{
+		neighbours.assign(targets.size() * k, Neighbour{0.0, 0});
+		counts.assign(targets.size(), 0);
+#pragma omp parallel
+		{
+			Scratch scratch;
+			std::vector<Neighbour> found;
+#pragma omp for schedule(dynamic, 16)
+			for (size_t index = 0; index < targets.size(); ++index)
+			{
+				query(targets[index].getFeatures(), k, scratch, found);
+				std::copy(found.begin(), found.end(), neighbours.begin() + index * k);
+				counts[index] = found.size();
+			}
+		}
+	}
+
+	void LshIndex::query( const MathVector<double>& target
+						, size_t k
+						, Scratch& scratch
+						, std::vector<Neighbour>& neighbours) const
+	{
+		neighbours.clear();
+		size_t items_count = m_features.size();
+		if (k == 0 || items_count == 0)
+			return;
+
+		if (scratch.marks.size() != items_count || ++scratch.generation == 0)
+		{
+			scratch.marks.assign(items_count, 0);
+			scratch.generation = 1;
+		}
+
+		band_keys(target, scratch);
+		scratch.candidates.clear();
+		for (size_t band = 0; band < m_bands; ++band)
+		{
+			std::vector<BucketEntry>::const_iterator table = m_tables.begin() + band * items_count;
+			std::vector<BucketEntry>::const_iterator it = std::lower_bound(table, table + items_count, BucketEntry{scratch.keys[band], 0});
+			for (; it != table + items_count && it->key == scratch.keys[band]; ++it)
+			{
+				if (scratch.marks[it->item] == scratch.generation)
+					continue;
+				scratch.marks[it->item] = scratch.generation;
+				scratch.candidates.push_back(it->item);
+			}
+		}
+
+		neighbours.resize(scratch.candidates.size());
+		for (size_t index = 0; index < scratch.candidates.size(); ++index)
+		{
+			uint32_t item = scratch.candidates[index];
+			neighbours[index] = Neighbour{m_distance->calc(*m_features[item], target), item};
+		}
+
+		size_t count = std::min(k, neighbours.size());
+		std::partial_sort(neighbours.begin(), neighbours.begin() + count, neighbours.end());
+		neighbours.resize(count);
+	}
+
+	void LshIndex::near_duplicates(double max_distance, std::vector<std::pair<size_t, size_t>>& pairs) const
+	{
+		pairs.clear();
+		size_t items_count = m_features.size();
+
+		// all empty items share one signature, they would fill a bucket of every band
+		std::vector<unsigned char> empty(items_count, 1);
+#pragma omp parallel for schedule(dynamic, 256)
+		for (size_t index = 0; index < items_count; ++index)
+		{
+			for (auto it = m_features[index]->const_fast_begin(); it != m_features[index]->const_fast_end(); ++it)
+			{
+				if (it.getElem() != 0.0)
+				{
+					empty[index] = 0;
+					break;
+				}
+			}
+		}
+
+		// the items of a bucket are linked to its first item only, so the
+		// clusters of colliding items are found in time linear in the tables
+		std::vector<uint32_t> parents(items_count);
+		for (size_t index = 0; index < items_count; ++index)
+			parents[index] = (uint32_t)index;
+		auto find = [&parents](uint32_t item) -> uint32_t
+		{
+			while (parents[item] != item)
+			{
+				parents[item] = parents[parents[item]];
+				item = parents[item];
+			}
+			return item;
+		};
+
+		for (size_t band = 0; band < m_bands; ++band)
+		{
+			const BucketEntry* table = m_tables.data() + band * items_count;
+			size_t bucket = 0;
+			while (bucket < items_count)
+			{
+				size_t end = bucket + 1;
+				while (end < items_count && table[end].key == table[bucket].key)
+					++end;
+				uint32_t root = (uint32_t)items_count;
+				for (size_t position = bucket; position < end; ++position)
+				{
+					if (empty[table[position].item])
+						continue;
+					uint32_t item_root = find(table[position].item);
+					if (root == items_count)
+						root = item_root;
+					else if (item_root != root)
+						parents[item_root] = root;
+				}
+				bucket = end;
+			}
+		}
+
+		// items are grouped by cluster, clusters of one item are dropped
+		std::vector<std::pair<uint32_t, uint32_t>> members;
+		for (size_t index = 0; index < items_count; ++index)
+		{
+			if (!empty[index])
+				members.push_back(std::make_pair(find((uint32_t)index), (uint32_t)index));
+		}
+		std::sort(members.begin(), members.end());
+		std::vector<size_t> clusters;
+		size_t member = 0;
+		while (member < members.size())
+		{
+			size_t end = member + 1;
+			while (end < members.size() && members[end].first == members[member].first)
+				++end;
+			if (end - member > 1)
+				clusters.push_back(member);
+			member = end;
+		}
+
+		// a cluster is verified around its first item: by the triangle
+		// inequality two items are close only if their distances to it
+		// differ by at most max_distance, so a sweep over the items sorted
+		// by that distance computes the other distances for such items only
+#pragma omp parallel
+		{
+			std::vector<std::pair<double, uint32_t>> sorted;
+			std::vector<std::pair<size_t, size_t>> cluster_pairs;
+#pragma omp for schedule(dynamic, 1)
+			for (size_t cluster = 0; cluster < clusters.size(); ++cluster)
+			{
+				size_t begin = clusters[cluster];
+				size_t end   = begin + 1;
+				while (end < members.size() && members[end].first == members[begin].first)
+					++end;
+
+				const MathVector<double>& center = *m_features[members[begin].second];
+				sorted.clear();
+				for (size_t position = begin; position < end; ++position)
+					sorted.push_back(std::make_pair(m_distance->calc(center, *m_features[members[position].second]), members[position].second));
+				std::sort(sorted.begin(), sorted.end());
+
+				for (size_t first = 0; first < sorted.size(); ++first)
+				{
+					for (size_t second = first + 1; second < sorted.size() && sorted[second].first - sorted[first].first <= max_distance; ++second)
+					{
+						uint32_t first_item  = sorted[first].second;
+						uint32_t second_item = sorted[second].second;
+						if (m_distance->calc_bounded(*m_features[first_item], *m_features[second_item], max_distance) <= max_distance)
+							cluster_pairs.push_back(std::make_pair((size_t)std::min(first_item, second_item), (size_t)std::max(first_item, second_item)));
+					}
+				}
+			}
+#pragma omp critical
+			pairs.insert(pairs.end(), cluster_pairs.begin(), cluster_pairs.end());
+		}
+
+		std::sort(pairs.begin(), pairs.end());
+	}
+}
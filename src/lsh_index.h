@@ -0,0 +1,110 @@
+#ifndef LSH_INDEX_H
+#define LSH_INDEX_H
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+#include "neighbours_index.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	enum class LshType
+	{
+		MINHASH,
+		SIMHASH
+	};
+
+	// Locality sensitive hashing candidates for sparse documents. MinHash
+	// (Jaccard similarity of the term sets) or SimHash (cosine similarity)
+	// signatures of bands * rows hashes are cut into bands, a band is hashed
+	// to one 32 bit key. Every band is a hash table stored as an array of
+	// (key, item) pairs sorted by key, 8 bytes per item per table, the
+	// signatures themselves are not kept. Items sharing a key with the query
+	// in any band are candidates, they are ranked by the exact distance.
+	class LshIndex : public NeighboursIndex
+	{
+	public:
+		LshIndex( std::shared_ptr<MathVectorNorm<double>> distance
+				, LshType type = LshType::MINHASH
+				, size_t bands = 16
+				, size_t rows = 4
+				, unsigned int seed = 0);
+
+		void build(const std::vector<Instance>& items);
+		void search( const MathVector<double>& target
+				   , size_t k
+				   , std::vector<Neighbour>& neighbours) const;
+		void search_batch( const std::vector<Instance>& targets
+						 , size_t k
+						 , std::pmr::vector<Neighbour>& neighbours
+						 , std::pmr::vector<size_t>& counts) const;
+
+		// pairs of items at the exact distance of at most max_distance among
+		// the clusters of items linked by collisions in some band, sorted,
+		// first < second. Empty items are never paired. The distance must
+		// be a metric, the clusters are verified with the triangle inequality
+		void near_duplicates(double max_distance, std::vector<std::pair<size_t, size_t>>& pairs) const;
+
+		bool exact() const { return false;};
+		size_t size() const { return m_features.size();};
+		std::string name() const { return "lsh";};
+		NeighboursIndex* clone() const { return new LshIndex(*this);};
+
+	private:
+		struct BucketEntry
+		{
+			uint32_t key;
+			uint32_t item;
+
+			bool operator<(const BucketEntry& other) const
+			{
+				return key < other.key || (key == other.key && item < other.item);
+			}
+		};
+
+		// signature scratch of one thread
+		struct Scratch
+		{
+			std::vector<uint32_t>      minimums;
+			std::vector<double>        projections;
+			std::vector<uint32_t>      keys;
+			std::vector<uint32_t>      marks;
+			uint32_t                   generation;
+			std::vector<uint32_t>      candidates;
+
+			Scratch() : generation(0) {}
+		};
+
+		void band_keys(const MathVector<double>& features, Scratch& scratch) const;
+		void query( const MathVector<double>& target
+				  , size_t k
+				  , Scratch& scratch
+				  , std::vector<Neighbour>& neighbours) const;
+
+	private:
+		std::shared_ptr<MathVectorNorm<double>> m_distance;
+		LshType                                 m_type;
+		size_t                                  m_bands;
+		size_t                                  m_rows;
+
+		// hash i of a term is the high half of multipliers[i] * term + offsets[i]
+		std::vector<uint64_t>                   m_multipliers;
+		std::vector<uint64_t>                   m_offsets;
+
+		std::vector<const MathVector<double>*>  m_features;
+		// table of band b is m_tables[b * items count, (b + 1) * items count)
+		std::vector<BucketEntry>                m_tables;
+	};
+}
+
+#endif //LSH_INDEX_H
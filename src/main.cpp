@@ -1,5 +1,6 @@
 #include <exception>
 #include <fstream>
+#include <functional>
 #include <string.h>
 #include <iostream>
 #include <memory>
@@ -8,6 +9,8 @@
 
 #include "ada_boost.h"
 #include "cart.h"
+#include "random_forest.h"
+#include "gradient_boosting.h"
 #include "data_storage.h"
 #include "data_storage_maximus.h"
 #include "k_fold_cross_validation.h"
@@ -15,6 +18,13 @@
 #include "simple_fischer_lda.h"
 #include "logistic_regression.h"
 #include "k_nearest_neighbours.h"
+#include "neighbours_index.h"
+#include "vp_tree_index.h"
+#include "flat_vp_tree.h"
+#include "inverted_index.h"
+#include "hnsw_index.h"
+#include "lsh_index.h"
+#include "memory_arena.h"
 #include "weak_predictor.h"
 #include "weight_initializer.h"
 
@@ -37,21 +47,45 @@ try
     std::string outdir = "./";
 	std::string suffix = "";
     std::string predictor_type = "log_regressor";
+	bool memory_statistics = false;
     desc.add_options()
     ("help", "produce help message")
     ("data,d", boost::program_options::value<std::string>(&datafile), "input data file")
     ("output-path,o", boost::program_options::value<std::string>(&outdir), "directory with output files")
 	("suffix,s", boost::program_options::value<std::string>(&suffix), "suffix of the output directory")
     ("fold-count,k", boost::program_options::value<uint32_t>(&fold_count), "count of folds to validate")
-    ("predictor-type,t", boost::program_options::value<std::string>(&predictor_type), "type of predictior (log_regressor, ldf, knn, weak, adaboost, cart)")
+    ("predictor-type,t", boost::program_options::value<std::string>(&predictor_type), "type of predictior (log_regressor, ldf, knn, weak, adaboost, cart, forest, gbdt)")
+	("memory-statistics", boost::program_options::bool_switch(&memory_statistics), "count heap allocations and report them for every fold")
     ;
     boost::program_options::variables_map vm;
 	 boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
     boost::program_options::notify(vm);
 
+	if (memory_statistics)
+		Memory::enable_statistics();
+
 	//kNN options
 	std::string weight_scheme = "const";
 	bool do_selecting = false;
+	size_t max_neighbours = 64;
+	std::string knn_index = "vp_tree";
+	std::string knn_distance = "euclidean";
+	size_t hnsw_m = 16;
+	size_t hnsw_ef_construction = 200;
+	size_t hnsw_ef_search = 64;
+	std::string hnsw_save = "";
+	std::string hnsw_load = "";
+	bool knn_recall = false;
+	size_t knn_pivots = 0;
+	bool knn_fold_cache = false;
+	std::string lsh_type = "minhash";
+	size_t lsh_bands = 16;
+	size_t lsh_rows = 4;
+	double near_duplicates = -1.0;
+	//LDA options
+	bool lda_fold_statistics = false;
+	std::string lda_covariation = "dense";
+	size_t lda_rank = 32;
 	//LR options
 	std::string weight_init_type   = "zeros";
 	std::string learning_rate_type = "const";
@@ -69,6 +103,8 @@ try
 	size_t estimators            = 200;
 	bool bagging                 = false;
 	double bagging_factor         = 1.0;
+	std::string bagging_type     = "poisson";
+	unsigned int bagging_seed    = 0;
 	std::string quality_criteria = "f1";
 	double max_quality            = 0.98;
 	//Cart options
@@ -76,8 +112,54 @@ try
 	bool lr_cart           = false;
 	double pruning_factor  = 0.0;
 	double quality_max     = 0.98;
+	//Forest options
+	size_t trees_count      = 100;
+	double feature_fraction = 1.0;
+	size_t threads_count    = 0;
+	//Gradient boosting options
+	double shrinkage        = 0.1;
+	size_t max_leaves       = 31;
+	size_t max_bins         = 32;
+	double row_fraction     = 1.0;
+	double l2_regular       = 1.0;
+	size_t min_leaf_objects = 20;
+	bool benchmark          = false;
 	bool ensemble_method = predictor_type.compare("adaboost") == 0;
-	bool decision_tree = predictor_type.compare("cart") == 0;
+	bool random_forest = predictor_type.compare("forest") == 0;
+	bool gradient_boosting = predictor_type.compare("gbdt") == 0;
+	bool decision_tree = predictor_type.compare("cart") == 0 || random_forest;
+	if (random_forest || gradient_boosting)
+	{
+		if (random_forest)
+			feature_fraction = 0.1;
+		desc.add_options()
+		("trees-count"     , boost::program_options::value<size_t>(&trees_count)     , "count of trees in ensemble")
+		("feature-fraction", boost::program_options::value<double>(&feature_fraction), "fraction of features checked at each split (forest) or tree (gbdt)");
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
+		boost::program_options::notify(vm);
+	}
+	if (random_forest)
+	{
+		desc.add_options()
+		("threads"         , boost::program_options::value<size_t>(&threads_count)   , "count of threads for learning and predicting (0 - all available)");
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
+		boost::program_options::notify(vm);
+	}
+	if (gradient_boosting)
+	{
+		desc.add_options()
+		("shrinkage"       , boost::program_options::value<double>(&shrinkage)       , "learning rate of each tree")
+		("max-leaves"      , boost::program_options::value<size_t>(&max_leaves)      , "maximal count of leaves in tree")
+		("max-bins"        , boost::program_options::value<size_t>(&max_bins)        , "maximal count of feature bins (up to 256)")
+		("row-fraction"    , boost::program_options::value<double>(&row_fraction)    , "fraction of learn objects sampled for each tree")
+		("l2-regular"      , boost::program_options::value<double>(&l2_regular)      , "l2 regularization of leaf values")
+		("min-leaf-objects", boost::program_options::value<size_t>(&min_leaf_objects), "minimal count of objects in leaf")
+		("benchmark"       , boost::program_options::bool_switch(&benchmark)         , "compare with adaboost and cart on the same folds");
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
+		boost::program_options::notify(vm);
+	}
+	// registered before the bagging options, so --bagging is not taken
+	// for an abbreviation of them
 	if (predictor_type.compare("adaboost") == 0)
 	{
 		desc.add_options()
@@ -90,7 +172,17 @@ try
 		boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
 		boost::program_options::notify(vm);
 	}
-	if (predictor_type.compare("cart") == 0 || (ensemble_method && estimator_type.compare("cart") == 0))
+	if (ensemble_method || random_forest)
+	{
+		if (random_forest)
+			bagging_type = "multinomial";
+		desc.add_options()
+		("bagging-type", boost::program_options::value<std::string>(&bagging_type), "bootstrap sampling of objects (poisson, multinomial)")
+		("bagging-seed", boost::program_options::value<unsigned int>(&bagging_seed), "seed of bootstrap sampling (0 - random)");
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
+		boost::program_options::notify(vm);
+	}
+	if (decision_tree || (ensemble_method && estimator_type.compare("cart") == 0))
 	{
 		desc.add_options()
 		("weak-impurity", boost::program_options::value<std::string>(&weak_impurity), "weak impurity type (info_benefit, khi_2, mutual_info, gini)")
@@ -101,11 +193,35 @@ try
 		boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
 		boost::program_options::notify(vm);
 	}
+	if (predictor_type.compare("ldf") == 0 || (ensemble_method && estimator_type.compare("ldf") == 0))
+	{
+		desc.add_options()
+		("lda-fold-statistics", boost::program_options::bool_switch(&lda_fold_statistics), "find class statistics of all folds from the pool once instead of every fold learn")
+		("lda-covariation", boost::program_options::value<std::string>(&lda_covariation), "covariation model (dense, diagonal, low_rank, cg)")
+		("lda-rank", boost::program_options::value<size_t>(&lda_rank), "rank of the low_rank covariation factor");
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).allow_unregistered().run(), vm);
+		boost::program_options::notify(vm);
+	}
 	if (predictor_type.compare("knn") == 0 || (ensemble_method && estimator_type.compare("knn") == 0))
 	{
 		desc.add_options()
 		("weight-scheme,w", boost::program_options::value<std::string>(&weight_scheme), "scheme of weighting neighbours (const, exp, sigm, hyper, log)")
-		("fris-stolp,f", boost::program_options::bool_switch(&do_selecting), "do FRiS-STOLP objects selecting");
+		("fris-stolp,f", boost::program_options::bool_switch(&do_selecting), "do FRiS-STOLP objects selecting")
+		("max-neighbours", boost::program_options::value<size_t>(&max_neighbours), "count of nearest neighbours kept for every learn object")
+		("knn-index", boost::program_options::value<std::string>(&knn_index), "nearest neighbours search index (vp_tree, flat_vp_tree, inverted_index, hnsw, lsh)")
+		("knn-distance", boost::program_options::value<std::string>(&knn_distance), "distance between objects (euclidean, cosine)")
+		("hnsw-m", boost::program_options::value<size_t>(&hnsw_m), "links per object on the hnsw graph levels")
+		("hnsw-ef-construction", boost::program_options::value<size_t>(&hnsw_ef_construction), "search width while the hnsw graph is built")
+		("hnsw-ef-search", boost::program_options::value<size_t>(&hnsw_ef_search), "search width of hnsw queries")
+		("hnsw-save", boost::program_options::value<std::string>(&hnsw_save), "learn the final knn model on the whole pool and save its hnsw graph to the file")
+		("hnsw-load", boost::program_options::value<std::string>(&hnsw_load), "take the hnsw graph of the final knn model from a file saved over the same data")
+		("knn-recall", boost::program_options::bool_switch(&knn_recall), "report recall of an approximate index against the exact vp tree")
+		("knn-pivots", boost::program_options::value<size_t>(&knn_pivots), "pivots of the LAESA table pruning vp tree distances")
+		("knn-fold-cache", boost::program_options::bool_switch(&knn_fold_cache), "find nearest neighbours of the whole pool once and share them between the folds")
+		("lsh-type", boost::program_options::value<std::string>(&lsh_type), "signatures of the lsh index (minhash, simhash)")
+		("lsh-bands", boost::program_options::value<size_t>(&lsh_bands), "hash tables of the lsh index")
+		("lsh-rows", boost::program_options::value<size_t>(&lsh_rows), "signature hashes per lsh band")
+		("near-duplicates", boost::program_options::value<double>(&near_duplicates), "report pairs of objects not farther than the distance found by the lsh index");
 	}
 	if (predictor_type.compare("log_regressor") == 0 || (ensemble_method && estimator_type.compare("log_regressor") == 0) || (decision_tree && lr_cart))
 	{
@@ -141,10 +257,24 @@ try
 	{
 		classifier_name += "_" + std::to_string(estimators);
 		if (bagging)
-			classifier_name += "_bagging" + std::to_string(bagging_factor);
+			classifier_name += "_bagging" + std::to_string(bagging_factor) + "_" + bagging_type;
 		classifier_name += "_" + estimator_type;
 	}
-	if (predictor_type.compare("cart") == 0 || (ensemble_method && estimator_type.compare("cart") == 0))
+	if (random_forest)
+	{
+		classifier_name += "_" + std::to_string(trees_count);
+		classifier_name += "_" + std::to_string(feature_fraction);
+		classifier_name += "_" + bagging_type;
+	}
+	if (gradient_boosting)
+	{
+		classifier_name += "_" + std::to_string(trees_count);
+		classifier_name += "_" + std::to_string(shrinkage);
+		classifier_name += "_" + std::to_string(max_leaves);
+		if (benchmark)
+			classifier_name += "_benchmark";
+	}
+	if (decision_tree || (ensemble_method && estimator_type.compare("cart") == 0))
 	{
 		classifier_name += "_" + weak_impurity;
 		classifier_name += "_" + std::to_string(max_quality);
@@ -213,9 +343,19 @@ try
 			                                           << "\t" << blur_factor << std::endl;
 
         Predictor* predictor;
+		// learned once on the whole pool after cross validation, if set
+		std::function<void(std::vector<Instance>&)> final_model;
+		BaggingType sampling_type = bagging_type.compare("multinomial") == 0 ? BaggingType::MULTINOMIAL : BaggingType::POISSON;
         if (predictor_type.compare("ldf") == 0 || (ensemble_method && estimator_type.compare("ldf") == 0))
         {
-            predictor = new SimpleFischerLDA(pool.getInstanceCount());
+			SimpleFischerLDA::CovariationType covariation_type = SimpleFischerLDA::CovariationType::DENSE;
+			if (lda_covariation.compare("diagonal") == 0)
+				covariation_type = SimpleFischerLDA::CovariationType::DIAGONAL;
+			else if (lda_covariation.compare("low_rank") == 0)
+				covariation_type = SimpleFischerLDA::CovariationType::LOW_RANK;
+			else if (lda_covariation.compare("cg") == 0)
+				covariation_type = SimpleFischerLDA::CovariationType::CONJUGATE_GRADIENT;
+            predictor = new SimpleFischerLDA(pool.getInstanceCount(), lda_fold_statistics, covariation_type, lda_rank);
         }
 		if (predictor_type.compare("weak") == 0 || (ensemble_method && estimator_type.compare("weak") == 0))
 		{
@@ -245,7 +385,60 @@ try
 			else
 				weight = KNearestNeighbours::log_weight;
 			std::shared_ptr<MathVectorNorm<double>> distance(new EuclideanNorm<double>());
-			predictor = new KNearestNeighbours(pool.getInstanceCount(), distance, weight, do_selecting);
+			if (knn_distance.compare("cosine") == 0)
+				distance = std::shared_ptr<MathVectorNorm<double>>(new CosineNorm<double>());
+			NeighboursIndexPtr index = nullptr;
+			if (knn_index.compare("flat_vp_tree") == 0)
+				index = NeighboursIndexPtr(new FlatVpTree(distance));
+			else if (knn_index.compare("inverted_index") == 0)
+				index = NeighboursIndexPtr(new InvertedIndex(distance));
+			else if (knn_index.compare("hnsw") == 0)
+				index = NeighboursIndexPtr(new HnswIndex(distance, hnsw_m, hnsw_ef_construction, hnsw_ef_search));
+			else if (knn_index.compare("lsh") == 0)
+				index = NeighboursIndexPtr(new LshIndex(distance, lsh_type.compare("simhash") == 0 ? LshType::SIMHASH : LshType::MINHASH, lsh_bands, lsh_rows));
+			else
+				index = NeighboursIndexPtr(new VpTreeIndex(distance, knn_pivots));
+			predictor = new KNearestNeighbours(pool.getInstanceCount(), distance, weight, do_selecting, max_neighbours, index, knn_recall, knn_pivots, knn_fold_cache);
+
+			if (knn_index.compare("hnsw") == 0 && (!hnsw_save.empty() || !hnsw_load.empty()))
+			{
+				// with several categories every one gets its own graph file
+				std::string suffix = categories.size() > 1 ? "." + it->first : "";
+				std::string save_path = hnsw_save.empty() ? "" : hnsw_save + suffix;
+				std::string load_path = hnsw_load.empty() ? "" : hnsw_load + suffix;
+				size_t features_count = pool.getInstanceCount();
+				final_model = [=](std::vector<Instance>& objects)
+				{
+					std::shared_ptr<HnswIndex> final_index(new HnswIndex(distance, hnsw_m, hnsw_ef_construction, hnsw_ef_search));
+					if (!load_path.empty())
+					{
+						final_index->load(load_path, objects);
+						std::cout << "hnsw graph is loaded from " << load_path << std::endl;
+					}
+
+					KNearestNeighbours model(features_count, distance, weight, do_selecting, max_neighbours, final_index, false, knn_pivots, false);
+					std::vector<double> weights;
+					std::vector<std::pair<double, double>> learning_curve;
+					model.learn(objects, weights, learning_curve);
+
+					if (!save_path.empty())
+					{
+						final_index->save(save_path);
+						if (!final_index->saved_graph_matches(save_path))
+							throw std::logic_error("hnsw graph differs after save and load");
+						std::cout << "hnsw graph is saved to " << save_path << " and checked by loading it back" << std::endl;
+					}
+				};
+			}
+
+			if (near_duplicates >= 0.0)
+			{
+				LshIndex duplicates_index(distance, lsh_type.compare("simhash") == 0 ? LshType::SIMHASH : LshType::MINHASH, lsh_bands, lsh_rows);
+				duplicates_index.build(pool.getInstance());
+				std::vector<std::pair<size_t, size_t>> duplicates;
+				duplicates_index.near_duplicates(near_duplicates, duplicates);
+				std::cout << "near duplicates pairs: " << duplicates.size() << std::endl;
+			}
 		}
 		if (predictor_type.compare("log_regressor") == 0 || (ensemble_method && estimator_type.compare("log_regressor") == 0) || (decision_tree && lr_cart))
         {
@@ -279,7 +472,7 @@ try
 											  , auto_precision
 											  , early_stop);
         }
-		if (predictor_type.compare("cart") == 0 || (ensemble_method && predictor_type.compare("cart") == 0))
+		if (decision_tree || (ensemble_method && predictor_type.compare("cart") == 0))
 		{
 			WeakClassifier::PurityType purity_type = WeakClassifier::PurityType::INFO_BENEFIT;
 			if (weak_impurity.compare("gini") == 0)
@@ -290,7 +483,7 @@ try
 				purity_type = WeakClassifier::PurityType::MUTUAL;
 			else if (weak_impurity.compare("khi_2") == 0)
 				purity_type = WeakClassifier::PurityType::KHI_2;
-			PredictorPtr weak_type(new WeakClassifier(pool.getInstanceCount(), purity_type));
+			PredictorPtr weak_type(new WeakClassifier(pool.getInstanceCount(), purity_type, feature_fraction));
 
 			PredictorPtr lr_type = nullptr;
 			if (lr_cart)
@@ -307,6 +500,16 @@ try
 										, pruning_factor);
 
 		}
+		if (random_forest)
+		{
+			PredictorPtr tree_type(predictor);
+			predictor = new RandomForest( pool.getInstanceCount()
+										, tree_type
+										, trees_count
+										, threads_count
+										, sampling_type
+										, bagging_seed);
+		}
 		if (predictor_type.compare("adaboost") == 0)
 		{
 			Metrics::Metric quality = Metrics::F1ScoreMetric;
@@ -325,11 +528,46 @@ try
 									, quality
 									, max_quality
 									, bagging
-									, bagging_factor);
+									, bagging_factor
+									, sampling_type
+									, bagging_seed);
 		
 		}
 
+		if (gradient_boosting)
+		{
+			predictor = new GradientBoosting( pool.getInstanceCount()
+											, trees_count
+											, shrinkage
+											, max_leaves
+											, max_bins
+											, row_fraction
+											, feature_fraction
+											, l2_regular
+											, min_leaf_objects);
+		}
+
+		if (benchmark)
+		{
+			PredictorPtr stump(new WeakClassifier(pool.getInstanceCount(), WeakClassifier::PurityType::GINI));
+			AdaBoost adaboost(pool.getInstanceCount(), stump, estimators);
+			DecisionTree cart(pool.getInstanceCount(), stump, quality_max, false);
+
+			std::vector<std::pair<std::string, Predictor*>> predictors;
+			predictors.push_back(std::make_pair(std::string("gbdt"), predictor));
+			predictors.push_back(std::make_pair(std::string("adaboost"), (Predictor*)&adaboost));
+			predictors.push_back(std::make_pair(std::string("cart"), (Predictor*)&cart));
+			CrossValidation::compare(predictors, pool, fold_count);
+			continue;
+		}
+
 	    CrossValidation::test(predictor, pool, fold_count, it->first.c_str(), outdir, true);
+
+		if (final_model)
+		{
+			std::cout << "learn the final model on the whole pool" << std::endl;
+			final_model(pool.getInstance());
+		}
 	}
 
 	std::cout << "cv control finished" << std::endl;
@@ -29,7 +29,7 @@ namespace MathCore
 		{
 		private:
 			MathVector<T>& parent;
-			std::set<size_t>::iterator m_element_it;
+			typename MathVector<T>::indexes_type::iterator m_element_it;
 
 		public:
 			FastMathVectorIterator(MathVector<T>& _parent, size_t _position) 
@@ -44,7 +44,7 @@ namespace MathCore
 					m_element_it = parent.not_nulls.find(_position);
 					if (m_element_it == parent.not_nulls.end())
 					{
-						std::set<size_t>::iterator it = parent.not_nulls.begin();
+						typename MathVector<T>::indexes_type::iterator it = parent.not_nulls.begin();
 						size_t min = parent.size;
 
 						for (; it != parent.not_nulls.end(); ++it)
@@ -87,7 +87,7 @@ namespace MathCore
 		{
 		private:
 			const MathVector<T>& parent;
-			std::set<size_t>::const_iterator m_element_it;
+			typename MathVector<T>::indexes_type::const_iterator m_element_it;
 
 		public:
 			ConstFastMathVectorIterator(const MathVector<T>& _parent, size_t _position) 
@@ -102,7 +102,7 @@ namespace MathCore
 					m_element_it = parent.not_nulls.find(_position);
 					if (m_element_it == parent.not_nulls.cend())
 					{
-						std::set<size_t>::const_iterator it = parent.not_nulls.cbegin();
+						typename MathVector<T>::indexes_type::const_iterator it = parent.not_nulls.cbegin();
 						size_t min = parent.size;
 
 						for (; it != parent.not_nulls.end(); ++it)
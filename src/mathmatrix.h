@@ -2,9 +2,12 @@
 #define MATHMATRIX_H
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include "mathvector.h"
 
+#include "mathmatrix_expression.h"
+
 #include "mathmatrix_invertor.h"
 
 using namespace MathCore::AlgebraCore::VectorCore;
@@ -27,10 +30,16 @@ namespace MathCore
 					template <typename T> class MathMatrixSolver;
 				}
 
+				namespace MatrixInvertor
+				{
+					template <typename T> class MathMatrixInvertor;
+					template <typename T> class QRInvertor;
+				}
+
 
 			};
 
-			template<typename T> class MathMatrix
+			template<typename T> class MathMatrix : public MatrixExpression<T, MathMatrix<T>>
 			{
 			protected:
 
@@ -49,19 +58,25 @@ namespace MathCore
 
 			protected:
 
-				MatrixAlgorithm::MatrixInvertor::MathMatrixInvertor< T >* invertor;
+				// shared by the copies of a matrix
+				std::shared_ptr<MatrixAlgorithm::MatrixInvertor::MathMatrixInvertor< T >> invertor;
 
 			public:
+				typedef MathVector<T> row_type;
+
 				//---------------------------constructors---------------------------------
 				MathMatrix();
 				MathMatrix(size_t _rows_size, size_t _cols_size, T _default_value = 0);
 				MathMatrix(const MathMatrix& x);
+				MathMatrix(MathMatrix&& x);
 				MathMatrix(std::vector<std::vector<T>>& _matrix);
 				MathMatrix(std::vector<MathVector<T>>& _math_matrix);
+				MathMatrix(std::vector<MathVector<T>>&& _math_matrix);
 				MathMatrix(size_t size, T _default_value = 0);
+				template<typename E> MathMatrix(const MatrixExpression<T, E>& expression);
 
 				void setValues(std::vector<MathVector<T>>& _math_matrix);
-				static MathMatrix& createIdentityMatrix(size_t size, T _default_value = 0);
+				static MathMatrix createIdentityMatrix(size_t size, T _default_value = 0);
 				//------------------------------------------------------------------------
 
 				//--------------------------usual-operators------------------------------
@@ -75,39 +90,40 @@ namespace MathCore
 
 				void pop_at(size_t position);
 
-				void set_invertor(MatrixAlgorithm::MatrixInvertor::MathMatrixInvertor<T> invertor);
+				void set_invertor(std::shared_ptr<MatrixAlgorithm::MatrixInvertor::MathMatrixInvertor<T>> invertor);
 
 				void insert_element(T elemenet, size_t rowIndex, size_t colIndex);
                 MathVector<T> row(size_t rowIndex);
+				const MathVector<T>& row_expression(size_t rowIndex) const;
 				T at(size_t rowIndex, size_t colIndex);
 				//---------------------------------------------------------------------
 
 				//-------------------------operators------------------------------------
 				MathMatrix& operator=(MathMatrix const & _MathMatrix);
+				MathMatrix& operator=(MathMatrix&& _MathMatrix);
+				template<typename E> MathMatrix& operator=(const MatrixExpression<T, E>& expression);
 
 				//MathVector<T>& operator*(MathVector<T> &_vector);
 
-				MathMatrix& operator+(MathMatrix &_MathMatrix);
-				MathMatrix& operator-(MathMatrix &_MathMatrix);
-				MathMatrix& operator*(MathMatrix &_MathMatrix);
-				MathMatrix& raw_multiply(MathMatrix &_MathMatrix);
+				// sums, differences and products by a number are lazy
+				// expressions declared in mathmatrix_expression.h, the product
+				// of matrices is below the class
+				MathMatrix raw_multiply(const MathMatrix &_MathMatrix) const;
 
-				MathMatrix& operator+=(MathMatrix &_MathMatrix);
-				MathMatrix& operator-=(MathMatrix &_MathMatrix);
-				MathMatrix& operator*=(MathMatrix &_MathMatrix);
+				template<typename E> MathMatrix& operator+=(const MatrixExpression<T, E>& expression);
+				template<typename E> MathMatrix& operator-=(const MatrixExpression<T, E>& expression);
+				template<typename E> MathMatrix& operator*=(const MatrixExpression<T, E>& expression);
 
-				MathMatrix& operator+(const T& _value);
-				MathMatrix& operator-(const T& _value);
-				MathMatrix& operator*(const T& _value);
-				MathMatrix& operator/(const T& _value);
+				MathMatrix operator+(const T& _value) const;
+				MathMatrix operator-(const T& _value) const;
 
 				MathMatrix& operator+=(const T& _value);
 				MathMatrix& operator-=(const T& _value);
 				MathMatrix& operator*=(const T& _value);
 				MathMatrix& operator/=(const T& _value);
 
-				MathMatrix& operator!();
-				MathMatrix& operator~();
+				MathMatrix operator!();
+				MathMatrix operator~() const;
 
 				bool operator==(MathMatrix &_MathMatrix) const;
 				bool operator!=(MathMatrix &_MathMatrix) const;
@@ -120,21 +136,21 @@ namespace MathCore
 			template<typename T> MathMatrix<T>::MathMatrix()
 				: row_size(0), col_size(0)
 			{
-				this->invertor = new MatrixAlgorithm::MatrixInvertor::QRInvertor<T>();
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
 			}
 
 			template<typename T> MathMatrix<T>::MathMatrix(size_t _rows_size, size_t _cols_size, T _default_value)
 				: row_size(_rows_size), col_size(_cols_size)
 			{
 				this->values.resize(this->row_size, MathVector<T>(col_size, _default_value));
-				this->invertor = new MatrixAlgorithm::MatrixInvertor::QRInvertor<T>();
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
 			}
 
 			template<typename T> MathMatrix<T>::MathMatrix(size_t _size, T _default_value)
 				: row_size(_size), col_size(_size)
 			{
 				this->values.resize(this->row_size, MathVector<T>(col_size, 0));
-				this->invertor = new MatrixAlgorithm::MatrixInvertor::QRInvertor<T>();
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
 
 				for (size_t rowIndex = 0; rowIndex < _size; ++rowIndex)
 				{
@@ -142,7 +158,7 @@ namespace MathCore
 				}
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::createIdentityMatrix(size_t size, T _default_value)
+			template<typename T> MathMatrix<T> MathMatrix<T>::createIdentityMatrix(size_t size, T _default_value)
 			{
 				std::vector<MathVector<T>> identityValues(size, MathVector<T>(size, 0.));
 
@@ -151,9 +167,7 @@ namespace MathCore
 					identityValues.at(index).insert(_default_value, index);
 				}
 
-				MathMatrix<T>* identityMatrix = new MathMatrix<T>(identityValues);
-
-				return *identityMatrix;
+				return MathMatrix<T>(std::move(identityValues));
 			}
 
 			template<typename T> MathMatrix<T>::MathMatrix(const MathMatrix& x)
@@ -165,9 +179,24 @@ namespace MathCore
 				this->invertor = x.invertor;
 			}
 
+			template<typename T> MathMatrix<T>::MathMatrix(MathMatrix&& x)
+				: row_size(x.row_size), col_size(x.col_size), values(std::move(x.values)), invertor(x.invertor)
+			{
+				x.row_size = 0;
+				x.col_size = 0;
+			}
+
+			template<typename T> template<typename E> MathMatrix<T>::MathMatrix(const MatrixExpression<T, E>& expression)
+				: row_size(0), col_size(0)
+			{
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
+
+				*this = expression;
+			}
+
 			template<typename T> MathMatrix<T>::MathMatrix(std::vector<std::vector<T>>& _raw_values)
 			{
-				this->invertor = new MatrixAlgorithm::MatrixInvertor::QRInvertor<T>();
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
 
 				this->row_size = _raw_values.size();
 
@@ -190,7 +219,7 @@ namespace MathCore
 			template<typename T> MathMatrix<T>::MathMatrix(std::vector<MathVector<T>>& _values)
 			{
 				this->row_size = _values.size();
-				this->invertor = new MatrixAlgorithm::MatrixInvertor::QRInvertor<T>();
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
 
 				if (this->row_size != 0)
 				{
@@ -205,10 +234,18 @@ namespace MathCore
 				}
 			}
 
+			template<typename T> MathMatrix<T>::MathMatrix(std::vector<MathVector<T>>&& _values)
+			{
+				this->row_size = _values.size();
+				this->col_size = _values.empty() ? 0 : _values.begin()->getSize();
+				this->values = std::move(_values);
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
+			}
+
 			template<typename T> void MathMatrix<T>::setValues(std::vector<MathVector<T>>& _values)
 			{
 				this->row_size = _values.size();
-				this->invertor = new MatrixAlgorithm::MatrixInvertor::QRInvertor<T>();
+				this->invertor = std::make_shared<MatrixAlgorithm::MatrixInvertor::QRInvertor<T>>();
 
 				this->values.clear();
 
@@ -245,6 +282,8 @@ namespace MathCore
 				this->col_size = 0;
 
 				this->values.clear();
+
+				return *this;
 			}
 
 			template<typename T>  void MathMatrix<T>::push_back(MathVector<T> row)
@@ -292,9 +331,9 @@ namespace MathCore
 				return;
 			}
 
-			template<typename T>  void MathMatrix<T>::set_invertor(MatrixAlgorithm::MatrixInvertor::MathMatrixInvertor<T> invertor)
+			template<typename T>  void MathMatrix<T>::set_invertor(std::shared_ptr<MatrixAlgorithm::MatrixInvertor::MathMatrixInvertor<T>> invertor)
 			{
-				this->invetor = &invertor;
+				this->invertor = invertor;
 			}
 
 			template<typename T> void MathMatrix<T>::insert_element(T element, size_t rowIndex, size_t colIndex)
@@ -307,6 +346,11 @@ namespace MathCore
                 return this->values.at(rowIndex);
             }
 
+			template<typename T> const MathVector<T>& MathMatrix<T>::row_expression(size_t rowIndex) const
+			{
+				return this->values[rowIndex];
+			}
+
 
 			template<typename T> T MathMatrix<T>::at(size_t rowIndex, size_t colIndex)
 			{
@@ -327,220 +371,132 @@ namespace MathCore
 				return *this;
 			}
 
-
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator+(MathMatrix<T>& _other)
+			template<typename T> MathMatrix<T>& MathMatrix<T>::operator=(MathMatrix<T>&& _MathMatrix)
 			{
-				MathMatrix<T> *result = new MathMatrix<T>(*this);
-
-				if (this->row_size != _other.row_size || this->col_size != _other.col_size)
-				{
-					throw std::logic_error("summarizing dimensions mismatch");
-				}
-				else
-				{
-					for (size_t index = 0; index < result->row_size(); ++index)
-					{
-						result->values.at(index) += _other.values.at(index);
-					}
-				}
+				this->col_size = _MathMatrix.col_size;
+				this->row_size = _MathMatrix.row_size;
 
-				return *result;
-			}
+				this->values = std::move(_MathMatrix.values);
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator-(MathMatrix<T>& _other)
-			{
-				MathMatrix<T>* result = new MathMatrix<T>(*this);
+				this->invertor = _MathMatrix.invertor;
 
-				if (this->row_size != _other.row_size || this->col_size != _other.col_size)
-				{
-					throw std::logic_error("summarizing dimensions mismatch");
-				}
-				else
-				{
-					for (size_t index = 0; index < result->rows_size(); ++index)
-					{
-						result->values.at(index) -= _other.values.at(index);
-					}
-				}
+				_MathMatrix.col_size = 0;
+				_MathMatrix.row_size = 0;
 
-				return *result;
+				return *this;
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::raw_multiply(MathMatrix<T>& _other)
+			template<typename T> template<typename E> MathMatrix<T>& MathMatrix<T>::operator=(const MatrixExpression<T, E>& _expression)
 			{
-				if (this->col_size != _other.col_size)
+				const E& expression = _expression.expression();
+				size_t rows = expression.rows_size();
+
+				// an expression holding this matrix has its dimensions, so the
+				// rows are not moved, and a row is only read by its own evaluation
+				this->values.resize(rows);
+#pragma omp parallel for schedule(dynamic, 16)
+				for (size_t rowindex = 0; rowindex < rows; ++rowindex)
 				{
-					throw std::exception();
+					this->values[rowindex] = expression.row_expression(rowindex);
 				}
-				else
-				{
-					size_t new_rows = this->row_size;
-					size_t new_cols = _other.row_size;
 
-					std::vector<std::vector<T>> raw_values(new_rows, std::vector<T>(col_size, 0));
+				this->row_size = rows;
+				this->col_size = expression.cols_size();
 
-					for (size_t rowindex = 0; rowindex < new_rows; ++rowindex)
-					{
-#pragma omp parallel for
-						for (int colindex = 0; colindex < new_cols; ++colindex)
-						{
-							T value = this->values.at(rowindex) * _other.values.at(colindex);
-
-							raw_values.at(rowindex).at(colindex) = value;
-						}
-					}
-
-					return *(new MathMatrix<T>(raw_values));
-
-				}
+				return *this;
 			}
 
-
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator*(MathMatrix<T>& _other)
+			template<typename T> MathMatrix<T> MathMatrix<T>::raw_multiply(const MathMatrix<T>& _other) const
 			{
-				if (this->col_size != _other.row_size)
+				if (this->col_size != _other.col_size)
 				{
-					throw std::logic_error("summarizing dimensions mismatch");
+					throw std::logic_error("multiplication dimensions mismatch");
 				}
 				else
 				{
 					size_t new_rows = this->row_size;
-					size_t new_cols = _other.col_size;
-
-					std::vector<std::vector<T>> raw_values(new_rows, std::vector<T>(col_size, 0));
+					size_t new_cols = _other.row_size;
 
-					MathMatrix<T> _other_transponate = ~_other;
+					std::vector<std::vector<T>> raw_values(new_rows, std::vector<T>(new_cols, 0));
 
+#pragma omp parallel for schedule(dynamic, 16)
 					for (size_t rowindex = 0; rowindex < new_rows; ++rowindex)
 					{
-#pragma omp parallel for
-						for (int colindex = 0; colindex < new_cols; ++colindex)
+						for (size_t colindex = 0; colindex < new_cols; ++colindex)
 						{
-							T value = this->values.at(rowindex) * _other_transponate.values.at(colindex);
-
-							raw_values.at(rowindex).at(colindex) = value;
+							raw_values[rowindex][colindex] = this->values[rowindex] * _other.values[colindex];
 						}
 					}
 
-					return  *(new MathMatrix<T>(raw_values));
+					return MathMatrix<T>(raw_values);
 				}
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator+=(MathMatrix<T>& _other)
+			template<typename T> template<typename E> MathMatrix<T>& MathMatrix<T>::operator+=(const MatrixExpression<T, E>& _expression)
 			{
+				const E& expression = _expression.expression();
 
-				if (this->row_size != _other.row_size || this->col_size != _other.col_size)
+				if (this->row_size != expression.rows_size() || this->col_size != expression.cols_size())
 				{
 					throw std::logic_error("summarizing dimensions mismatch");
 				}
-				else
-				{
-					for (size_t index = 0; index < this->row_size; ++index)
-					{
-						this->values.at(index) += _other.values.at(index);
-					}
-				}
 
-				return *this;
-			}
-
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator-=(MathMatrix<T>& _other)
-			{
-				if (this->row_size != _other.row_size || this->col_size != _other.col_size)
-				{
-					throw std::exception();
-				}
-				else
+#pragma omp parallel for schedule(dynamic, 16)
+				for (size_t rowindex = 0; rowindex < this->row_size; ++rowindex)
 				{
-					for (size_t index = 0; index < this->row_size(); ++index)
-					{
-						this->values.at(index) -= _other.values.at(index);
-					}
+					this->values[rowindex] += expression.row_expression(rowindex);
 				}
 
 				return *this;
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator*=(MathMatrix<T>& _other)
+			template<typename T> template<typename E> MathMatrix<T>& MathMatrix<T>::operator-=(const MatrixExpression<T, E>& _expression)
 			{
-				if (this->col_size != _other.row_size)
+				const E& expression = _expression.expression();
+
+				if (this->row_size != expression.rows_size() || this->col_size != expression.cols_size())
 				{
 					throw std::logic_error("summarizing dimensions mismatch");
 				}
-				else
-				{
-					size_t new_rows = this->row_size;
-					size_t new_cols = _other.col_size;
-
-					std::vector<std::vector<T>> raw_values(new_rows, std::vector<T>(col_size, 0));
-
-					MathMatrix<T> _other_transponate = ~(*this);
-
-					for (size_t rowindex = 0; rowindex < new_rows; ++rowindex)
-					{
-						for (size_t colindex = 0; colindex < new_cols; ++colindex)
-						{
-							T value = this->values.at(rowindex) * _other_transponate.values.at(colindex);
-
-							raw_values.at(rowindex).at(colindex) = value;
-						}
-					}
 
-					this->row_size = new_rows;
-					this->col_size = new_cols;
-
-					this->values = (MathMatrix<T>(raw_values)).values;
-
-					return  *this;
-
-				}
-			}
-
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator+(const T& _value)
-			{
-
-				MathMatrix<T>* result = new MathMatrix<T>(*this);
-
-				for (size_t index = 0; index < result->row_size; ++index)
+#pragma omp parallel for schedule(dynamic, 16)
+				for (size_t rowindex = 0; rowindex < this->row_size; ++rowindex)
 				{
-					result->values.at(index) += _value;
+					this->values[rowindex] -= expression.row_expression(rowindex);
 				}
 
-				return *result;
+				return *this;
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator-(const T& _value)
+			template<typename T> template<typename E> MathMatrix<T>& MathMatrix<T>::operator*=(const MatrixExpression<T, E>& _expression)
 			{
-				MathMatrix<T>* result = new MathMatrix<T>(*this);
-
-				for (size_t index = 0; index < result->row_size; ++index)
-				{
-					result->values.at(index) -= _value;
-				}
+				*this = *this * _expression;
 
-				return *result;
+				return *this;
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator*(const T& _value)
+			template<typename T> MathMatrix<T> MathMatrix<T>::operator+(const T& _value) const
 			{
-				MathMatrix<T>* result = new MathMatrix<T>(*this);
+				MathMatrix<T> result(*this);
 
-				for (size_t index = 0; index < result->row_size; ++index)
+				for (size_t index = 0; index < result.row_size; ++index)
 				{
-					result->values.at(index) *= _value;
+					result.values.at(index) += _value;
 				}
 
-				return *result;
+				return result;
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator/(const T& _value)
+			template<typename T> MathMatrix<T> MathMatrix<T>::operator-(const T& _value) const
 			{
-				MathMatrix result(*this);
+				MathMatrix<T> result(*this);
 
 				for (size_t index = 0; index < result.row_size; ++index)
 				{
-					result.values.at(index) /= _value;
+					result.values.at(index) -= _value;
 				}
+
+				return result;
 			}
 
 			template<typename T> MathMatrix<T>& MathMatrix<T>::operator+=(const T& _value)
@@ -583,31 +539,26 @@ namespace MathCore
 				return *this;
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator!()
+			template<typename T> MathMatrix<T> MathMatrix<T>::operator!()
 			{
 				return this->invertor->invert(*this);
 			}
 
-			template<typename T> MathMatrix<T>& MathMatrix<T>::operator~()
+			template<typename T> MathMatrix<T> MathMatrix<T>::operator~() const
 			{
-				size_t row_size_t = this->col_size;
-				size_t col_size_t = this->row_size;
-
 				std::vector<MathVector<T>> values_t(this->col_size, MathVector<T>(this->row_size, 0));
 
 				for (size_t rowindex = 0; rowindex < this->row_size; ++rowindex)
 				{
-					typename MathVector<T>::fast_iterator  it = this->values.at(rowindex).fast_begin();
-					typename MathVector<T>::fast_iterator  end = this->values.at(rowindex).fast_end();
+					typename MathVector<T>::const_fast_iterator  it = this->values.at(rowindex).const_fast_begin();
+					typename MathVector<T>::const_fast_iterator  end = this->values.at(rowindex).const_fast_end();
 					for (; it != end; ++it)
 					{
 						values_t.at(it.index()).insert(it.getElem(), rowindex);
 					}
 				}
 
-				MathMatrix<T>* result = new MathMatrix<T>(values_t);
-
-				return *result;
+				return MathMatrix<T>(std::move(values_t));
 			}
 
 			template<typename T> bool MathMatrix<T>::operator==(MathMatrix &_other) const
@@ -672,6 +623,37 @@ namespace MathCore
 				}
 			}
 			//----------------------------------------------------------------------
+
+			// A row of the product is the sum of the rows of second scaled by
+			// the not null elements of the row of first. It is accumulated in
+			// place, no transposed copy of second is made.
+			template<typename T, typename L, typename R> MathMatrix<T> operator*(const MatrixExpression<T, L>& _first, const MatrixExpression<T, R>& _second)
+			{
+				const L& first  = _first.expression();
+				const R& second = _second.expression();
+
+				if (first.cols_size() != second.rows_size())
+				{
+					throw std::logic_error("multiplication dimensions mismatch");
+				}
+
+				std::vector<MathVector<T>> rows(first.rows_size(), MathVector<T>(second.cols_size(), 0));
+
+#pragma omp parallel for schedule(dynamic, 16)
+				for (size_t rowindex = 0; rowindex < rows.size(); ++rowindex)
+				{
+					const typename L::row_type& row = first.row_expression(rowindex);
+					for (typename L::row_type::cursor it = row.cursor_begin(); it.index() != VectorCore::Expression::end_index; it.advance())
+					{
+						if (it.index() < second.rows_size())
+						{
+							rows[rowindex] += second.row_expression(it.index()) * it.value();
+						}
+					}
+				}
+
+				return MathMatrix<T>(std::move(rows));
+			}
 		}
 	}
 }
@@ -0,0 +1,173 @@
+#ifndef MATHMATRIX_CHOLESKY_H
+#define MATHMATRIX_CHOLESKY_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <math.h>
+
+#include "mathmatrix_dense.h"
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace MatrixCore
+		{
+			namespace MatrixAlgorithm
+			{
+				namespace Cholesky
+				{
+					const size_t block_size = 128;
+
+					// unblocked factorization of the size x size block at matrix,
+					// only its lower triangle is read
+					template<typename T> void factor_block(T* matrix, size_t stride, size_t size)
+					{
+						for (size_t col_index = 0; col_index < size; ++col_index)
+						{
+							T* col_row = matrix + col_index * stride;
+							T diagonal = col_row[col_index];
+							for (size_t position = 0; position < col_index; ++position)
+								diagonal -= col_row[position] * col_row[position];
+							if (!(diagonal > 0))
+								throw std::logic_error("matrix is not positive definite");
+
+							diagonal = sqrt(diagonal);
+							col_row[col_index] = diagonal;
+							for (size_t row_index = col_index + 1; row_index < size; ++row_index)
+							{
+								T* row = matrix + row_index * stride;
+								T value = row[col_index];
+								for (size_t position = 0; position < col_index; ++position)
+									value -= row[position] * col_row[position];
+								row[col_index] = value / diagonal;
+							}
+						}
+					}
+				}
+
+				// Factors the symmetric positive definite matrix as L * L^T in
+				// place: L takes the lower triangle and the upper one is zeroed,
+				// only the lower triangle of the input is read. Right-looking
+				// blocked algorithm: a diagonal block is factored, the panel
+				// under it is solved against it in parallel by rows, then the
+				// lower triangle of the trailing matrix is updated by syrk,
+				// which carries almost all of the work.
+				template<typename T> void cholesky(DenseMatrix<T>& matrix)
+				{
+					using namespace Cholesky;
+					size_t size = matrix.rows();
+					if (size != matrix.cols())
+						throw std::logic_error("cholesky decomposition of a non square matrix");
+
+					size_t stride = matrix.stride();
+					T* values = matrix.data();
+					for (size_t block_first = 0; block_first < size; block_first += block_size)
+					{
+						size_t block_count = std::min(block_size, size - block_first);
+						T* diagonal_block = values + block_first * stride + block_first;
+						factor_block(diagonal_block, stride, block_count);
+
+						size_t panel_first = block_first + block_count;
+#pragma omp parallel for schedule(static)
+						for (size_t row_index = panel_first; row_index < size; ++row_index)
+						{
+							T* row = values + row_index * stride + block_first;
+							for (size_t col_index = 0; col_index < block_count; ++col_index)
+							{
+								const T* l_row = diagonal_block + col_index * stride;
+								T value = row[col_index];
+								for (size_t position = 0; position < col_index; ++position)
+									value -= row[position] * l_row[position];
+								row[col_index] = value / l_row[col_index];
+							}
+						}
+
+						syrk( false, size - panel_first, block_count
+							, T(-1), values + panel_first * stride + block_first, stride
+							, T(1), values + panel_first * stride + panel_first, stride);
+					}
+
+#pragma omp parallel for schedule(static)
+					for (size_t row_index = 0; row_index < size; ++row_index)
+						std::fill(values + row_index * stride + row_index + 1, values + row_index * stride + size, T(0));
+				}
+
+				// Solves op(l) * x = b for every column of b in place, l is lower
+				// triangular and op transposes it when the flag is set. Rows of
+				// x are found by blocks: a block is solved by substitution in
+				// parallel over the columns of b, then its contribution is
+				// removed from the rest of b by gemm.
+				template<typename T> void triangular_solve(bool transpose, const DenseMatrix<T>& l, DenseMatrix<T>& b)
+				{
+					using namespace Cholesky;
+					size_t size = l.rows();
+					if (size != l.cols() || size != b.rows())
+						throw std::logic_error("triangular solve dimensions mismatch");
+
+					size_t columns = b.cols();
+					size_t l_stride = l.stride();
+					size_t b_stride = b.stride();
+					const T* l_values = l.data();
+					T* b_values = b.data();
+					size_t blocks = (size + block_size - 1) / block_size;
+					for (size_t step = 0; step < blocks; ++step)
+					{
+						// forward for l, backward for l^T
+						size_t block_index = transpose ? blocks - 1 - step : step;
+						size_t block_first = block_index * block_size;
+						size_t block_count = std::min(block_size, size - block_first);
+
+#pragma omp parallel for schedule(static)
+						for (size_t column = 0; column < columns; ++column)
+						{
+							for (size_t offset = 0; offset < block_count; ++offset)
+							{
+								size_t row_index = transpose ? block_first + block_count - 1 - offset : block_first + offset;
+								T value = b_values[row_index * b_stride + column];
+								if (transpose)
+								{
+									for (size_t other = row_index + 1; other < block_first + block_count; ++other)
+										value -= l_values[other * l_stride + row_index] * b_values[other * b_stride + column];
+								}
+								else
+								{
+									for (size_t other = block_first; other < row_index; ++other)
+										value -= l_values[row_index * l_stride + other] * b_values[other * b_stride + column];
+								}
+								b_values[row_index * b_stride + column] = value / l_values[row_index * l_stride + row_index];
+							}
+						}
+
+						if (transpose && block_first > 0)
+						{
+							// b[0, first) -= l[first, first + count)^T * x[first, first + count)
+							gemm( true, false, block_first, columns, block_count
+								, T(-1), l_values + block_first * l_stride, l_stride
+								, b_values + block_first * b_stride, b_stride
+								, T(1), b_values, b_stride);
+						}
+						else if (!transpose && block_first + block_count < size)
+						{
+							// b[first + count, size) -= l[first + count, size)[first, first + count) * x[first, first + count)
+							size_t rest_first = block_first + block_count;
+							gemm( false, false, size - rest_first, columns, block_count
+								, T(-1), l_values + rest_first * l_stride + block_first, l_stride
+								, b_values + block_first * b_stride, b_stride
+								, T(1), b_values + rest_first * b_stride, b_stride);
+						}
+					}
+				}
+
+				// solves a * x = b in place of b, l is the cholesky factor of a
+				template<typename T> void cholesky_solve(const DenseMatrix<T>& l, DenseMatrix<T>& b)
+				{
+					triangular_solve(false, l, b);
+					triangular_solve(true, l, b);
+				}
+			}
+		}
+	}
+}
+
+#endif //MATHMATRIX_CHOLESKY_H
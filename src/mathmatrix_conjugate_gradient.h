@@ -0,0 +1,148 @@
+#ifndef MATHMATRIX_CONJUGATE_GRADIENT_H
+#define MATHMATRIX_CONJUGATE_GRADIENT_H
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include <math.h>
+
+#include "mathmatrix_dense.h"
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace MatrixCore
+		{
+			namespace MatrixAlgorithm
+			{
+				namespace ConjugateGradient
+				{
+					// sum over the rows of first[column] * second[column]
+					template<typename T> T column_product(const DenseMatrix<T>& first, const DenseMatrix<T>& second, size_t column)
+					{
+						T value = 0;
+#pragma omp parallel for reduction(+:value) schedule(static)
+						for (size_t row_index = 0; row_index < first.rows(); ++row_index)
+							value += first(row_index, column) * second(row_index, column);
+						return value;
+					}
+				}
+
+				// Jacobi preconditioned conjugate gradient for a * x = b with a
+				// symmetric positive definite a known only by its product:
+				// multiply sets y = a * x for size x k matrices, y comes sized.
+				// Every column of b is its own system, the columns advance
+				// together so each step is one product with a block of vectors.
+				// diagonal is the diagonal of a, x holds the start on entry and
+				// the solution on return. A column stops once its residual is
+				// within tolerance of its right side. Returns the steps made.
+				template<typename T> size_t conjugate_gradient( const std::function<void(const DenseMatrix<T>&, DenseMatrix<T>&)>& multiply
+															  , const std::vector<T>& diagonal
+															  , const DenseMatrix<T>& b
+															  , DenseMatrix<T>& x
+															  , T tolerance
+															  , size_t max_iterations)
+				{
+					using namespace ConjugateGradient;
+					size_t size    = b.rows();
+					size_t columns = b.cols();
+					if (diagonal.size() != size || x.rows() != size || x.cols() != columns)
+						throw std::logic_error("conjugate gradient dimensions mismatch");
+
+					std::vector<T> inverse_diagonal(size);
+					for (size_t index = 0; index < size; ++index)
+					{
+						if (!(diagonal[index] > 0))
+							throw std::logic_error("matrix is not positive definite");
+						inverse_diagonal[index] = T(1) / diagonal[index];
+					}
+
+					DenseMatrix<T> residual(size, columns);
+					DenseMatrix<T> products(size, columns);
+					multiply(x, products);
+#pragma omp parallel for schedule(static)
+					for (size_t row_index = 0; row_index < size; ++row_index)
+					{
+						for (size_t column = 0; column < columns; ++column)
+							residual(row_index, column) = b(row_index, column) - products(row_index, column);
+					}
+
+					DenseMatrix<T> preconditioned(size, columns);
+					std::vector<T> bounds(columns);
+					std::vector<T> residual_products(columns);
+					std::vector<bool> converged(columns, false);
+					for (size_t column = 0; column < columns; ++column)
+						bounds[column] = tolerance * sqrt(column_product(b, b, column));
+
+					DenseMatrix<T> directions(size, columns);
+					size_t iteration = 0;
+					for (; iteration <= max_iterations; ++iteration)
+					{
+						bool all_converged = true;
+						for (size_t column = 0; column < columns; ++column)
+						{
+							if (!converged[column] && sqrt(column_product(residual, residual, column)) <= bounds[column])
+								converged[column] = true;
+							all_converged = all_converged && converged[column];
+						}
+						if (all_converged || iteration == max_iterations)
+							break;
+
+						// z = M^-1 r, p = z + (r^T z / previous r^T z) p, a converged
+						// column keeps a zero direction
+#pragma omp parallel for schedule(static)
+						for (size_t row_index = 0; row_index < size; ++row_index)
+						{
+							for (size_t column = 0; column < columns; ++column)
+								preconditioned(row_index, column) = converged[column] ? T(0) : inverse_diagonal[row_index] * residual(row_index, column);
+						}
+						std::vector<T> betas(columns, T(0));
+						for (size_t column = 0; column < columns; ++column)
+						{
+							T product = column_product(residual, preconditioned, column);
+							if (iteration > 0 && residual_products[column] != T(0))
+								betas[column] = product / residual_products[column];
+							residual_products[column] = product;
+						}
+#pragma omp parallel for schedule(static)
+						for (size_t row_index = 0; row_index < size; ++row_index)
+						{
+							for (size_t column = 0; column < columns; ++column)
+								directions(row_index, column) = preconditioned(row_index, column) + betas[column] * directions(row_index, column);
+						}
+
+						multiply(directions, products);
+
+						std::vector<T> alphas(columns, T(0));
+						for (size_t column = 0; column < columns; ++column)
+						{
+							if (converged[column])
+								continue;
+							// no curvature along the direction: a is singular on it, the column can not advance
+							T curvature = column_product(directions, products, column);
+							if (curvature > 0)
+								alphas[column] = residual_products[column] / curvature;
+							else
+								converged[column] = true;
+						}
+#pragma omp parallel for schedule(static)
+						for (size_t row_index = 0; row_index < size; ++row_index)
+						{
+							for (size_t column = 0; column < columns; ++column)
+							{
+								x(row_index, column)        += alphas[column] * directions(row_index, column);
+								residual(row_index, column) -= alphas[column] * products(row_index, column);
+							}
+						}
+					}
+
+					return iteration;
+				}
+			}
+		}
+	}
+}
+
+#endif //MATHMATRIX_CONJUGATE_GRADIENT_H
@@ -0,0 +1,451 @@
+#ifndef MATHMATRIX_DENSE_H
+#define MATHMATRIX_DENSE_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "mathvector.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace MatrixCore
+		{
+			template<typename T> class MathMatrix;
+
+			// allocates blocks starting on an Alignment bytes boundary, the
+			// offset to the raw block is kept in front of the aligned one
+			template<typename T, size_t Alignment> class AlignedAllocator
+			{
+			public:
+				typedef T value_type;
+
+				template<typename U> struct rebind
+				{
+					typedef AlignedAllocator<U, Alignment> other;
+				};
+
+				AlignedAllocator() {}
+				template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+				T* allocate(size_t count)
+				{
+					if (count > (std::numeric_limits<size_t>::max() - Alignment - sizeof(void*)) / sizeof(T))
+						throw std::bad_alloc();
+
+					char* raw = static_cast<char*>(::operator new(count * sizeof(T) + Alignment + sizeof(void*)));
+					size_t address = reinterpret_cast<size_t>(raw + sizeof(void*));
+					char* aligned = raw + sizeof(void*) + (Alignment - address % Alignment) % Alignment;
+					reinterpret_cast<void**>(aligned)[-1] = raw;
+					return reinterpret_cast<T*>(aligned);
+				}
+
+				void deallocate(T* pointer, size_t)
+				{
+					::operator delete(reinterpret_cast<void**>(pointer)[-1]);
+				}
+
+				template<typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true;};
+				template<typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false;};
+			};
+
+			// Dense row-major matrix in one contiguous block. Rows are padded
+			// to whole cache lines so every row starts aligned, the padding is
+			// kept zero. Unlike MathMatrix it has no per-element lookups and is
+			// meant for the numeric kernels of MatrixAlgorithm.
+			template<typename T> class DenseMatrix
+			{
+			public:
+				static const size_t alignment = 64;
+
+			public:
+				DenseMatrix()
+				: m_rows(0)
+				, m_cols(0)
+				, m_stride(0)
+				{ }
+
+				DenseMatrix(size_t rows, size_t cols, T value = 0)
+				: m_rows(rows)
+				, m_cols(cols)
+				, m_stride(padded(cols))
+				, m_values(rows * padded(cols), 0)
+				{
+					if (value != 0)
+						fill(value);
+				}
+
+				explicit DenseMatrix(MathMatrix<T>& matrix)
+				: m_rows(matrix.rows_size())
+				, m_cols(matrix.cols_size())
+				, m_stride(padded(matrix.cols_size()))
+				, m_values(matrix.rows_size() * padded(matrix.cols_size()), 0)
+				{
+					for (size_t row_index = 0; row_index < m_rows; ++row_index)
+						set_row(row_index, matrix[row_index]);
+				}
+
+				DenseMatrix(const std::vector<MathVector<T>>& rows, size_t cols)
+				: m_rows(rows.size())
+				, m_cols(cols)
+				, m_stride(padded(cols))
+				, m_values(rows.size() * padded(cols), 0)
+				{
+					for (size_t row_index = 0; row_index < m_rows; ++row_index)
+						set_row(row_index, rows[row_index]);
+				}
+
+				static DenseMatrix identity(size_t size)
+				{
+					DenseMatrix result(size, size);
+					for (size_t index = 0; index < size; ++index)
+						result(index, index) = 1;
+					return result;
+				}
+
+				size_t rows()   const { return m_rows;};
+				size_t cols()   const { return m_cols;};
+				// distance between the starts of two neighbouring rows
+				size_t stride() const { return m_stride;};
+
+				T*       data()       { return m_values.data();};
+				const T* data() const { return m_values.data();};
+				T*       row(size_t index)       { return m_values.data() + index * m_stride;};
+				const T* row(size_t index) const { return m_values.data() + index * m_stride;};
+
+				T&       operator()(size_t row_index, size_t col_index)       { return m_values[row_index * m_stride + col_index];};
+				const T& operator()(size_t row_index, size_t col_index) const { return m_values[row_index * m_stride + col_index];};
+
+				void fill(T value)
+				{
+					for (size_t row_index = 0; row_index < m_rows; ++row_index)
+						std::fill(row(row_index), row(row_index) + m_cols, value);
+				}
+
+				void set_row(size_t row_index, const MathVector<T>& values)
+				{
+					T* destination = row(row_index);
+					std::fill(destination, destination + m_cols, 0);
+					for (typename MathVector<T>::const_fast_iterator it = values.const_fast_begin(); it != values.const_fast_end(); ++it)
+					{
+						if (it.index() < m_cols)
+							destination[it.index()] = it.getElem();
+					}
+				}
+
+				MathVector<T> row_vector(size_t row_index) const
+				{
+					return MathVector<T>(std::vector<T>(row(row_index), row(row_index) + m_cols));
+				}
+
+				std::vector<MathVector<T>> to_rows() const
+				{
+					std::vector<MathVector<T>> rows(m_rows);
+					for (size_t row_index = 0; row_index < m_rows; ++row_index)
+						rows[row_index] = row_vector(row_index);
+					return rows;
+				}
+
+				// transposes by square blocks so both matrices are walked a cache line at a time
+				DenseMatrix transpose() const
+				{
+					const size_t block = 32;
+					DenseMatrix result(m_cols, m_rows);
+#pragma omp parallel for schedule(dynamic, 1)
+					for (size_t row_block = 0; row_block < m_rows; row_block += block)
+					{
+						for (size_t col_block = 0; col_block < m_cols; col_block += block)
+						{
+							size_t row_end = std::min(row_block + block, m_rows);
+							size_t col_end = std::min(col_block + block, m_cols);
+							for (size_t row_index = row_block; row_index < row_end; ++row_index)
+							{
+								for (size_t col_index = col_block; col_index < col_end; ++col_index)
+									result(col_index, row_index) = (*this)(row_index, col_index);
+							}
+						}
+					}
+					return result;
+				}
+
+				DenseMatrix operator*(const DenseMatrix& other) const;
+
+			private:
+				static size_t padded(size_t cols)
+				{
+					const size_t line = alignment / sizeof(T) > 0 ? alignment / sizeof(T) : 1;
+					return (cols + line - 1) / line * line;
+				}
+
+			private:
+				size_t m_rows;
+				size_t m_cols;
+				size_t m_stride;
+				std::vector<T, AlignedAllocator<T, alignment>> m_values;
+			};
+
+			namespace MatrixAlgorithm
+			{
+				// Blocked matrix multiplication c = alpha * op(a) * op(b) + beta * c,
+				// where op transposes its matrix when the flag is set and c is
+				// rows x cols. Matrices are row-major with leading dimensions
+				// lda, ldb, ldc; with beta = 0 c is not read.
+				//
+				// A kc-deep slice of op(a) is packed into panels of MR rows and
+				// the same slice of op(b) into panels of NR columns, so the
+				// micro-kernel reads both sequentially whatever the transposes
+				// are. It keeps an MR x NR tile of c in local accumulators the
+				// compiler holds in vector registers. Threads share the packed
+				// slices and split the output into independent tiles of
+				// block_rows x block_cols; inside a tile the NR panel of b stays
+				// in L1 while the MR panels of a stream from L2.
+				namespace Gemm
+				{
+					const size_t MR         = 4;
+					const size_t NR         = 8;
+					const size_t block_rows = 128;
+					const size_t block_cols = 512;
+					const size_t block_deep = 256;
+
+					template<typename T> void pack_a( bool transpose, size_t rows, size_t deep, const T* a, size_t lda, T* packed)
+					{
+						size_t panels = (rows + MR - 1) / MR;
+#pragma omp parallel for schedule(static)
+						for (size_t panel = 0; panel < panels; ++panel)
+						{
+							T* destination = packed + panel * MR * deep;
+							size_t first = panel * MR;
+							size_t count = std::min(MR, rows - first);
+							for (size_t position = 0; position < deep; ++position)
+							{
+								for (size_t index = 0; index < MR; ++index)
+								{
+									T value = 0;
+									if (index < count)
+										value = transpose ? a[position * lda + first + index] : a[(first + index) * lda + position];
+									destination[position * MR + index] = value;
+								}
+							}
+						}
+					}
+
+					template<typename T> void pack_b( bool transpose, size_t deep, size_t cols, const T* b, size_t ldb, T* packed)
+					{
+						size_t panels = (cols + NR - 1) / NR;
+#pragma omp parallel for schedule(static)
+						for (size_t panel = 0; panel < panels; ++panel)
+						{
+							T* destination = packed + panel * NR * deep;
+							size_t first = panel * NR;
+							size_t count = std::min(NR, cols - first);
+							for (size_t position = 0; position < deep; ++position)
+							{
+								for (size_t index = 0; index < NR; ++index)
+								{
+									T value = 0;
+									if (index < count)
+										value = transpose ? b[(first + index) * ldb + position] : b[position * ldb + first + index];
+									destination[position * NR + index] = value;
+								}
+							}
+						}
+					}
+
+					template<typename T> inline void micro_kernel( size_t deep
+																 , const T* a
+																 , const T* b
+																 , T* c
+																 , size_t ldc
+																 , size_t rows
+																 , size_t cols
+																 , T alpha
+																 , T beta)
+					{
+						T accumulators[MR][NR];
+						for (size_t index_1 = 0; index_1 < MR; ++index_1)
+							for (size_t index_2 = 0; index_2 < NR; ++index_2)
+								accumulators[index_1][index_2] = 0;
+
+						for (size_t position = 0; position < deep; ++position)
+						{
+							const T* a_column = a + position * MR;
+							const T* b_row    = b + position * NR;
+							for (size_t index_1 = 0; index_1 < MR; ++index_1)
+							{
+								T a_value = a_column[index_1];
+								for (size_t index_2 = 0; index_2 < NR; ++index_2)
+									accumulators[index_1][index_2] += a_value * b_row[index_2];
+							}
+						}
+
+						for (size_t index_1 = 0; index_1 < rows; ++index_1)
+						{
+							T* c_row = c + index_1 * ldc;
+							for (size_t index_2 = 0; index_2 < cols; ++index_2)
+								c_row[index_2] = alpha * accumulators[index_1][index_2] + (beta == 0 ? 0 : beta * c_row[index_2]);
+						}
+					}
+				}
+
+				template<typename T> void gemm( bool transpose_a
+											  , bool transpose_b
+											  , size_t rows
+											  , size_t cols
+											  , size_t deep
+											  , T alpha
+											  , const T* a
+											  , size_t lda
+											  , const T* b
+											  , size_t ldb
+											  , T beta
+											  , T* c
+											  , size_t ldc)
+				{
+					using namespace Gemm;
+					if (rows == 0 || cols == 0)
+						return;
+
+					if (deep == 0 || alpha == 0)
+					{
+#pragma omp parallel for schedule(static)
+						for (size_t row_index = 0; row_index < rows; ++row_index)
+						{
+							for (size_t col_index = 0; col_index < cols; ++col_index)
+								c[row_index * ldc + col_index] = beta == 0 ? 0 : beta * c[row_index * ldc + col_index];
+						}
+						return;
+					}
+
+					size_t padded_rows = (rows + MR - 1) / MR * MR;
+					size_t padded_cols = (cols + NR - 1) / NR * NR;
+					std::vector<T, AlignedAllocator<T, 64>> packed_a(padded_rows * std::min(deep, block_deep));
+					std::vector<T, AlignedAllocator<T, 64>> packed_b(padded_cols * std::min(deep, block_deep));
+
+					size_t tile_rows  = (rows + block_rows - 1) / block_rows;
+					size_t tile_cols  = (cols + block_cols - 1) / block_cols;
+					size_t tile_count = tile_rows * tile_cols;
+
+					for (size_t deep_first = 0; deep_first < deep; deep_first += block_deep)
+					{
+						size_t deep_count = std::min(block_deep, deep - deep_first);
+						// later slices add to what the first one wrote
+						T slice_beta = deep_first == 0 ? beta : 1;
+
+						pack_a(transpose_a, rows, deep_count, transpose_a ? a + deep_first * lda : a + deep_first, lda, packed_a.data());
+						pack_b(transpose_b, deep_count, cols, transpose_b ? b + deep_first : b + deep_first * ldb, ldb, packed_b.data());
+
+#pragma omp parallel for schedule(dynamic, 1)
+						for (size_t tile = 0; tile < tile_count; ++tile)
+						{
+							size_t row_first = (tile / tile_cols) * block_rows;
+							size_t col_first = (tile % tile_cols) * block_cols;
+							size_t row_end   = std::min(row_first + block_rows, rows);
+							size_t col_end   = std::min(col_first + block_cols, cols);
+							for (size_t col_index = col_first; col_index < col_end; col_index += NR)
+							{
+								const T* b_panel = packed_b.data() + (col_index / NR) * NR * deep_count;
+								for (size_t row_index = row_first; row_index < row_end; row_index += MR)
+								{
+									const T* a_panel = packed_a.data() + (row_index / MR) * MR * deep_count;
+									micro_kernel( deep_count
+												, a_panel
+												, b_panel
+												, c + row_index * ldc + col_index
+												, ldc
+												, std::min(MR, row_end - row_index)
+												, std::min(NR, col_end - col_index)
+												, alpha
+												, slice_beta);
+								}
+							}
+						}
+					}
+				}
+
+				// c = alpha * op(a) * op(b) + beta * c on whole matrices, c is resized when its shape differs
+				template<typename T> void gemm( bool transpose_a
+											  , bool transpose_b
+											  , T alpha
+											  , const DenseMatrix<T>& a
+											  , const DenseMatrix<T>& b
+											  , T beta
+											  , DenseMatrix<T>& c)
+				{
+					size_t rows = transpose_a ? a.cols() : a.rows();
+					size_t deep = transpose_a ? a.rows() : a.cols();
+					size_t cols = transpose_b ? b.rows() : b.cols();
+					if (deep != (transpose_b ? b.cols() : b.rows()))
+						throw std::logic_error("multiplication dimensions mismatch");
+
+					if (c.rows() != rows || c.cols() != cols)
+					{
+						c = DenseMatrix<T>(rows, cols);
+						beta = 0;
+					}
+
+					gemm( transpose_a, transpose_b, rows, cols, deep
+						, alpha, a.data(), a.stride(), b.data(), b.stride()
+						, beta, c.data(), c.stride());
+				}
+			}
+
+			namespace MatrixAlgorithm
+			{
+				// Symmetric rank-k update of the lower triangle of the size x size
+				// matrix c: c = alpha * op(a) * op(a)^T + beta * c, where op(a) is
+				// size x deep and is a itself or, with the flag set, a^T. The
+				// triangle is swept by block rows, each is one gemm over the
+				// columns up to its diagonal block, so the upper triangle gets
+				// only the parts of the diagonal blocks.
+				template<typename T> void syrk( bool transpose
+											  , size_t size
+											  , size_t deep
+											  , T alpha
+											  , const T* a
+											  , size_t lda
+											  , T beta
+											  , T* c
+											  , size_t ldc)
+				{
+					const size_t block_rows = 256;
+					for (size_t row_first = 0; row_first < size; row_first += block_rows)
+					{
+						size_t row_count = std::min(block_rows, size - row_first);
+						gemm( transpose, !transpose, row_count, row_first + row_count, deep
+							, alpha, transpose ? a + row_first : a + row_first * lda, lda
+							, a, lda
+							, beta, c + row_first * ldc, ldc);
+					}
+				}
+
+				// copies the lower triangle of the square matrix over the upper one
+				template<typename T> void symmetrize(DenseMatrix<T>& matrix)
+				{
+					size_t size = matrix.rows();
+#pragma omp parallel for schedule(dynamic, 16)
+					for (size_t row_index = 0; row_index < size; ++row_index)
+					{
+						for (size_t col_index = row_index + 1; col_index < size; ++col_index)
+							matrix(row_index, col_index) = matrix(col_index, row_index);
+					}
+				}
+			}
+
+			template<typename T> DenseMatrix<T> DenseMatrix<T>::operator*(const DenseMatrix<T>& other) const
+			{
+				DenseMatrix<T> result(m_rows, other.cols());
+				MatrixAlgorithm::gemm(false, false, T(1), *this, other, T(0), result);
+				return result;
+			}
+		}
+	}
+}
+
+#endif //MATHMATRIX_DENSE_H
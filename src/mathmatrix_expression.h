@@ -0,0 +1,130 @@
+#ifndef MATHMATRIX_EXPRESSION_H
+#define MATHMATRIX_EXPRESSION_H
+
+#include <stdexcept>
+
+#include "mathvector.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace MatrixCore
+		{
+			template<typename T> class MathMatrix;
+
+			namespace Expression
+			{
+				template<typename E> struct Storage
+				{
+					typedef const E type;
+				};
+
+				template<typename T> struct Storage<MathMatrix<T>>
+				{
+					typedef const MathMatrix<T>& type;
+				};
+			}
+
+			// Base of lazy element wise matrix arithmetic. An expression is
+			// read by rows: row_expression(index) is a vector expression of
+			// the row, so a matrix sum is evaluated row by row by the fused
+			// vector loops and no temporary matrix is made.
+			template<typename T, typename E> class MatrixExpression
+			{
+			public:
+				typedef T value_type;
+
+				const E& expression() const { return static_cast<const E&>(*this);};
+			};
+
+			template<typename T, typename L, typename R> class MatrixSum : public MatrixExpression<T, MatrixSum<T, L, R>>
+			{
+			public:
+				typedef VectorSum<T, typename L::row_type, typename R::row_type> row_type;
+
+				MatrixSum(const L& first, const R& second, T sign)
+				: m_first(first)
+				, m_second(second)
+				, m_sign(sign)
+				{
+					if (first.rows_size() != second.rows_size() || first.cols_size() != second.cols_size())
+						throw std::logic_error("summarizing dimensions mismatch");
+				}
+
+				size_t rows_size() const { return m_first.rows_size();};
+				size_t cols_size() const { return m_first.cols_size();};
+
+				row_type row_expression(size_t index) const
+				{
+					return row_type(m_first.row_expression(index), m_second.row_expression(index), m_sign);
+				}
+
+			private:
+				typename Expression::Storage<L>::type m_first;
+				typename Expression::Storage<R>::type m_second;
+				T m_sign;
+			};
+
+			template<typename T, typename E> class MatrixScale : public MatrixExpression<T, MatrixScale<T, E>>
+			{
+			public:
+				typedef VectorScale<T, typename E::row_type> row_type;
+
+				MatrixScale(const E& expression, T factor)
+				: m_expression(expression)
+				, m_factor(factor)
+				{ }
+
+				size_t rows_size() const { return m_expression.rows_size();};
+				size_t cols_size() const { return m_expression.cols_size();};
+
+				row_type row_expression(size_t index) const
+				{
+					return row_type(m_expression.row_expression(index), m_factor);
+				}
+
+			private:
+				typename Expression::Storage<E>::type m_expression;
+				T m_factor;
+			};
+
+			template<typename T, typename L, typename R> MatrixSum<T, L, R> operator+(const MatrixExpression<T, L>& first, const MatrixExpression<T, R>& second)
+			{
+				return MatrixSum<T, L, R>(first.expression(), second.expression(), T(1));
+			}
+
+			template<typename T, typename L, typename R> MatrixSum<T, L, R> operator-(const MatrixExpression<T, L>& first, const MatrixExpression<T, R>& second)
+			{
+				return MatrixSum<T, L, R>(first.expression(), second.expression(), T(-1));
+			}
+
+			template<typename T, typename E> MatrixScale<T, E> operator-(const MatrixExpression<T, E>& expression)
+			{
+				return MatrixScale<T, E>(expression.expression(), T(-1));
+			}
+
+			template<typename T, typename E> MatrixScale<T, E> operator*(const MatrixExpression<T, E>& expression, const typename MatrixExpression<T, E>::value_type& value)
+			{
+				return MatrixScale<T, E>(expression.expression(), value);
+			}
+
+			template<typename T, typename E> MatrixScale<T, E> operator*(const typename MatrixExpression<T, E>::value_type& value, const MatrixExpression<T, E>& expression)
+			{
+				return MatrixScale<T, E>(expression.expression(), value);
+			}
+
+			template<typename T, typename E> MatrixScale<T, E> operator/(const MatrixExpression<T, E>& expression, const typename MatrixExpression<T, E>::value_type& value)
+			{
+				if (value == 0)
+					throw std::logic_error("division by zero");
+
+				return MatrixScale<T, E>(expression.expression(), T(1) / value);
+			}
+		}
+	}
+}
+
+#endif //MATHMATRIX_EXPRESSION_H
@@ -0,0 +1,318 @@
+#ifndef MATHMATRIX_HOUSEHOLDER_H
+#define MATHMATRIX_HOUSEHOLDER_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <math.h>
+
+#include "mathmatrix_dense.h"
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace MatrixCore
+		{
+			namespace MatrixAlgorithm
+			{
+				namespace Householder
+				{
+					const size_t block_size = 32;
+				}
+
+				// QR decomposition of a rows x cols matrix by Householder
+				// reflections H = I - tau * v * v^T, Q = H_0 * H_1 * ... The
+				// factor keeps R on and above the diagonal and the reflectors
+				// v below it, their leading unit is implied.
+				//
+				// Columns are factored by panels of block_size. The reflectors
+				// of a panel are gathered in the compact WY form
+				// H_first * ... * H_last = I - V * T * V^T with an upper
+				// triangular T, so the rest of the matrix is updated by three
+				// gemm calls instead of one reflection at a time. Q is never
+				// formed: solves apply the same panels to their right sides.
+				template<typename T> class HouseholderQR
+				{
+				public:
+					HouseholderQR() { }
+
+					explicit HouseholderQR(const DenseMatrix<T>& matrix)
+					{
+						decompose(matrix);
+					}
+
+					void decompose(const DenseMatrix<T>& matrix)
+					{
+						using namespace Householder;
+						m_factor = matrix;
+						size_t rows  = m_factor.rows();
+						size_t cols  = m_factor.cols();
+						size_t steps = std::min(rows, cols);
+						m_tau.assign(steps, T(0));
+						m_blocks.clear();
+
+						for (size_t first = 0; first < steps; first += block_size)
+						{
+							size_t count = std::min(block_size, steps - first);
+							factor_panel(first, count);
+
+							DenseMatrix<T> reflectors = panel_reflectors(first, count);
+							m_blocks.push_back(triangular_factor(reflectors, first));
+
+							size_t trailing_first = first + count;
+							if (trailing_first < cols)
+								apply_block( true, reflectors, m_blocks.back()
+										   , m_factor.row(first) + trailing_first, m_factor.stride(), cols - trailing_first);
+						}
+					}
+
+					size_t rows() const { return m_factor.rows();};
+					size_t cols() const { return m_factor.cols();};
+					const DenseMatrix<T>& factor() const { return m_factor;};
+
+					// b = Q * b, or Q^T * b with the flag set, b has rows rows
+					void apply_q(bool transpose, DenseMatrix<T>& b) const
+					{
+						using namespace Householder;
+						if (b.rows() != rows())
+							throw std::logic_error("householder reflection dimensions mismatch");
+
+						size_t blocks = m_blocks.size();
+						for (size_t step = 0; step < blocks; ++step)
+						{
+							// Q^T = H_last * ... * H_0 applies the first panel first
+							size_t block = transpose ? step : blocks - 1 - step;
+							size_t first = block * block_size;
+							DenseMatrix<T> reflectors = panel_reflectors(first, m_blocks[block].rows());
+							apply_block(transpose, reflectors, m_blocks[block], b.row(first), b.stride(), b.cols());
+						}
+					}
+
+					// solves R * x = b for every column of b in place of its
+					// leading cols rows, R is the square upper triangle of the
+					// factor. Blocks of rows are solved from the last one by
+					// substitution in parallel over the columns of b, then their
+					// contribution is removed from the rows above by gemm.
+					void solve_r(DenseMatrix<T>& b) const
+					{
+						using namespace Householder;
+						size_t size = cols();
+						if (rows() < size || b.rows() < size)
+							throw std::logic_error("triangular solve dimensions mismatch");
+						for (size_t index = 0; index < size; ++index)
+						{
+							if (m_factor(index, index) == T(0))
+								throw std::logic_error("matrix is rank deficient");
+						}
+
+						size_t columns  = b.cols();
+						size_t r_stride = m_factor.stride();
+						size_t b_stride = b.stride();
+						const T* r_values = m_factor.data();
+						T* b_values = b.data();
+						size_t blocks = (size + block_size - 1) / block_size;
+						for (size_t step = 0; step < blocks; ++step)
+						{
+							size_t block_first = (blocks - 1 - step) * block_size;
+							size_t block_count = std::min(block_size, size - block_first);
+
+#pragma omp parallel for schedule(static)
+							for (size_t column = 0; column < columns; ++column)
+							{
+								for (size_t offset = block_count; offset > 0; --offset)
+								{
+									size_t row_index = block_first + offset - 1;
+									const T* r_row = r_values + row_index * r_stride;
+									T value = b_values[row_index * b_stride + column];
+									for (size_t other = row_index + 1; other < block_first + block_count; ++other)
+										value -= r_row[other] * b_values[other * b_stride + column];
+									b_values[row_index * b_stride + column] = value / r_row[row_index];
+								}
+							}
+
+							if (block_first > 0)
+							{
+								// b[0, first) -= r[0, first)[first, first + count) * x[first, first + count)
+								gemm( false, false, block_first, columns, block_count
+									, T(-1), r_values + block_first, r_stride
+									, b_values + block_first * b_stride, b_stride
+									, T(1), b_values, b_stride);
+							}
+						}
+					}
+
+					// least squares solution of a * x = b for every column of b,
+					// a has at least as many rows as columns and full rank
+					DenseMatrix<T> solve(const DenseMatrix<T>& b) const
+					{
+						DenseMatrix<T> projection(b);
+						apply_q(true, projection);
+						solve_r(projection);
+
+						DenseMatrix<T> x(cols(), b.cols());
+						for (size_t row_index = 0; row_index < cols(); ++row_index)
+							std::copy(projection.row(row_index), projection.row(row_index) + b.cols(), x.row(row_index));
+						return x;
+					}
+
+					// rows x min(rows, cols) Q with orthonormal columns
+					DenseMatrix<T> q() const
+					{
+						size_t steps = std::min(rows(), cols());
+						DenseMatrix<T> result(rows(), steps);
+						for (size_t index = 0; index < steps; ++index)
+							result(index, index) = T(1);
+						apply_q(false, result);
+						return result;
+					}
+
+					// min(rows, cols) x cols upper triangular R
+					DenseMatrix<T> r() const
+					{
+						size_t steps = std::min(rows(), cols());
+						DenseMatrix<T> result(steps, cols());
+						for (size_t row_index = 0; row_index < steps; ++row_index)
+							std::copy(m_factor.row(row_index) + row_index, m_factor.row(row_index) + cols(), result.row(row_index) + row_index);
+						return result;
+					}
+
+				private:
+					// unblocked factorization of count columns from first, the
+					// reflections are applied to the rest of the panel only
+					void factor_panel(size_t first, size_t count)
+					{
+						size_t rows = m_factor.rows();
+						size_t panel_end = first + count;
+						std::vector<T> products(count);
+						for (size_t col_index = first; col_index < panel_end; ++col_index)
+						{
+							T alpha = m_factor(col_index, col_index);
+							T tail_norm = 0;
+							for (size_t row_index = col_index + 1; row_index < rows; ++row_index)
+								tail_norm += m_factor(row_index, col_index) * m_factor(row_index, col_index);
+
+							if (tail_norm == T(0))
+							{
+								// the column is already reduced, H = I
+								m_tau[col_index] = T(0);
+								continue;
+							}
+
+							// the reflection maps the column to beta * e, beta takes
+							// the sign opposite to alpha so that alpha - beta does
+							// not cancel
+							T beta = sqrt(alpha * alpha + tail_norm);
+							if (alpha > 0)
+								beta = -beta;
+							m_tau[col_index] = (beta - alpha) / beta;
+							T scale = T(1) / (alpha - beta);
+							for (size_t row_index = col_index + 1; row_index < rows; ++row_index)
+								m_factor(row_index, col_index) *= scale;
+							m_factor(col_index, col_index) = beta;
+
+							// w^T = v^T * panel, then panel -= tau * v * w^T
+							size_t rest = panel_end - col_index - 1;
+							if (rest == 0)
+								continue;
+							std::copy(m_factor.row(col_index) + col_index + 1, m_factor.row(col_index) + panel_end, products.begin());
+							for (size_t row_index = col_index + 1; row_index < rows; ++row_index)
+							{
+								const T* row = m_factor.row(row_index);
+								T reflector = row[col_index];
+								for (size_t offset = 0; offset < rest; ++offset)
+									products[offset] += reflector * row[col_index + 1 + offset];
+							}
+
+							T tau = m_tau[col_index];
+#pragma omp parallel for schedule(static)
+							for (size_t row_index = col_index; row_index < rows; ++row_index)
+							{
+								T* row = m_factor.row(row_index);
+								T reflector = row_index == col_index ? T(1) : row[col_index];
+								for (size_t offset = 0; offset < rest; ++offset)
+									row[col_index + 1 + offset] -= tau * reflector * products[offset];
+							}
+						}
+					}
+
+					// (rows - first) x count V of the panel with its unit
+					// diagonal and zeros above it
+					DenseMatrix<T> panel_reflectors(size_t first, size_t count) const
+					{
+						size_t rows = m_factor.rows();
+						DenseMatrix<T> reflectors(rows - first, count);
+#pragma omp parallel for schedule(static)
+						for (size_t row_index = first; row_index < rows; ++row_index)
+						{
+							const T* source = m_factor.row(row_index) + first;
+							T* row = reflectors.row(row_index - first);
+							size_t below = std::min(count, row_index - first);
+							std::copy(source, source + below, row);
+							if (below < count)
+								row[below] = T(1);
+						}
+						return reflectors;
+					}
+
+					// T of the compact WY form, column i is
+					// T[0, i)[i] = -tau_i * T[0, i)[0, i) * V[0, i)^T * v_i
+					DenseMatrix<T> triangular_factor(const DenseMatrix<T>& reflectors, size_t first) const
+					{
+						size_t count = reflectors.cols();
+						DenseMatrix<T> products;
+						gemm(true, false, T(1), reflectors, reflectors, T(0), products);
+
+						DenseMatrix<T> factor(count, count);
+						for (size_t col_index = 0; col_index < count; ++col_index)
+						{
+							T tau = m_tau[first + col_index];
+							factor(col_index, col_index) = tau;
+							for (size_t row_index = 0; row_index < col_index; ++row_index)
+							{
+								T value = 0;
+								for (size_t position = row_index; position < col_index; ++position)
+									value += factor(row_index, position) * products(position, col_index);
+								factor(row_index, col_index) = -tau * value;
+							}
+						}
+						return factor;
+					}
+
+					// c = (I - V * op(T) * V^T) * c for the cols columns of c at
+					// ldc, op transposes T for the product of the transposed
+					// reflections
+					static void apply_block( bool transpose
+										   , const DenseMatrix<T>& reflectors
+										   , const DenseMatrix<T>& factor
+										   , T* c
+										   , size_t ldc
+										   , size_t cols)
+					{
+						size_t rows  = reflectors.rows();
+						size_t count = reflectors.cols();
+						DenseMatrix<T> products(count, cols);
+						DenseMatrix<T> scaled(count, cols);
+						gemm( true, false, count, cols, rows
+							, T(1), reflectors.data(), reflectors.stride(), c, ldc
+							, T(0), products.data(), products.stride());
+						gemm( transpose, false, count, cols, count
+							, T(1), factor.data(), factor.stride(), products.data(), products.stride()
+							, T(0), scaled.data(), scaled.stride());
+						gemm( false, false, rows, cols, count
+							, T(-1), reflectors.data(), reflectors.stride(), scaled.data(), scaled.stride()
+							, T(1), c, ldc);
+					}
+
+				private:
+					DenseMatrix<T> m_factor;
+					std::vector<T> m_tau;
+					// T of every panel
+					std::vector<DenseMatrix<T>> m_blocks;
+				};
+			}
+		}
+	}
+}
+
+#endif //MATHMATRIX_HOUSEHOLDER_H
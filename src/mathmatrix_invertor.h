@@ -1,11 +1,12 @@
 #ifndef MATHMATRIXINVERTOR_H
 #define MATHMATRIXINVERTOR_H
 
-#include <iostream>
-#include <math.h>
+#include <stdexcept>
+#include <vector>
 
 #include "mathmatrix.h"
-#include "mathmatrix_decomposer.h"
+#include "mathmatrix_dense.h"
+#include "mathmatrix_householder.h"
 #include "mathmatrix_solver.h"
 
 #include "mathvector.h"
@@ -29,7 +30,7 @@ namespace MathCore
 					{
 					public:
 
-						virtual MathMatrix<T>& invert(MathMatrix<T>& matrix)
+						virtual MathMatrix<T> invert(MathMatrix<T>& matrix)
 						{
 							return matrix;
 						}
@@ -41,45 +42,22 @@ namespace MathCore
 					{
 					public:
 
-						MathMatrix<T>& invert(MathMatrix<T>& matrix)
+						// A^-1 = R^-1 * Q^T: Q^T is applied to the identity by the
+						// reflections and R is solved against it
+						MathMatrix<T> invert(MathMatrix<T>& matrix)
 						{
-							MathMatrix<T> e = MathMatrix<T>::createIdentityMatrix(matrix.cols_size(), 1);
+							size_t size = matrix.rows_size();
+							if (size != matrix.cols_size())
+								throw std::logic_error("inverting a non square matrix");
 
-							MathMatrix<T> q;
-							MathMatrix<T> r;
+							DenseMatrix<T> dense(matrix);
+							HouseholderQR<T> qr(dense);
 
-                            std::cout << "start decomposing" << std::endl;
-							std::vector<MathMatrix<T>> decompose = (new MatrixDecomposer::QRDecomposerGS<T>())->decompose(matrix);
+							DenseMatrix<T> inverse = DenseMatrix<T>::identity(size);
+							qr.apply_q(true, inverse);
+							qr.solve_r(inverse);
 
-							q = decompose.at(0);
-							r = decompose.at(1);
-
-							size_t row_size = matrix.rows_size();
-                            std::vector<MathVector<T>> inverse_r_raw(row_size);
-
-                            size_t total_count = 0;
-                            size_t part = pow(10, 3);
-                            std::cout << "start inverting R" << std::endl;
-
-                            #pragma omp parallel for
-							for (size_t index = 0; index < row_size; index++)
-							{
-								MathVector<T> step = (new MatrixSolver::UpTriangleSolver<T>())->solve(r, e[index]);
-								inverse_r_raw.at(index) = step;
-
-                                #pragma omp atomic
-                                total_count++;
-                                #pragma omp atomic
-                                if ((total_count % part) == 0)
-                                    std::cout << "total count: " << total_count << std::endl;
-							}
-
-							MathMatrix<T> inverse_r(inverse_r_raw);
-
-                            std::cout << "final inverting" << std::endl;
-							MathMatrix<T>* inverse_t = &(~(q * inverse_r));
-
-							return *inverse_t;
+							return MathMatrix<T>(inverse.to_rows());
 						}
 					};
 				}
@@ -0,0 +1,185 @@
+#ifndef MATHMATRIX_RANDOMIZED_SVD_H
+#define MATHMATRIX_RANDOMIZED_SVD_H
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+#include <math.h>
+
+#include "mathmatrix_dense.h"
+#include "mathmatrix_householder.h"
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace MatrixCore
+		{
+			namespace MatrixAlgorithm
+			{
+				namespace RandomizedSvd
+				{
+					// extra random directions beyond the rank, they catch the
+					// part of the range the rank ones miss
+					const size_t oversampling = 10;
+					const size_t max_sweeps   = 64;
+
+					template<typename T> DenseMatrix<T> orthonormal_columns(const DenseMatrix<T>& matrix)
+					{
+						return HouseholderQR<T>(matrix).q();
+					}
+				}
+
+				// Eigen decomposition of a small symmetric matrix by cyclic
+				// Jacobi rotations. Values are sorted in decreasing order and
+				// the columns of vectors are the matching eigenvectors.
+				template<typename T> void symmetric_eigen(const DenseMatrix<T>& matrix, std::vector<T>& values, DenseMatrix<T>& vectors)
+				{
+					using namespace RandomizedSvd;
+					size_t size = matrix.rows();
+					DenseMatrix<T> a(matrix);
+					DenseMatrix<T> rotated = DenseMatrix<T>::identity(size);
+					T epsilon = std::numeric_limits<T>::epsilon();
+
+					for (size_t sweep = 0; sweep < max_sweeps; ++sweep)
+					{
+						T off_diagonal = 0;
+						T diagonal = 0;
+						for (size_t row_index = 0; row_index < size; ++row_index)
+						{
+							diagonal += a(row_index, row_index) * a(row_index, row_index);
+							for (size_t col_index = row_index + 1; col_index < size; ++col_index)
+								off_diagonal += a(row_index, col_index) * a(row_index, col_index);
+						}
+						if (off_diagonal <= epsilon * epsilon * diagonal)
+							break;
+
+						for (size_t p = 0; p < size; ++p)
+						{
+							for (size_t q = p + 1; q < size; ++q)
+							{
+								if (a(p, q) == T(0))
+									continue;
+
+								// the rotation by tan t zeroes a(p, q), the smaller root keeps it stable
+								T theta = (a(q, q) - a(p, p)) / (2 * a(p, q));
+								T t = T(1) / (fabs(theta) + sqrt(theta * theta + 1));
+								if (theta < 0)
+									t = -t;
+								T c = T(1) / sqrt(t * t + 1);
+								T s = t * c;
+
+								for (size_t k = 0; k < size; ++k)
+								{
+									T kp = a(k, p);
+									T kq = a(k, q);
+									a(k, p) = c * kp - s * kq;
+									a(k, q) = s * kp + c * kq;
+								}
+								for (size_t k = 0; k < size; ++k)
+								{
+									T pk = a(p, k);
+									T qk = a(q, k);
+									a(p, k) = c * pk - s * qk;
+									a(q, k) = s * pk + c * qk;
+								}
+								for (size_t k = 0; k < size; ++k)
+								{
+									T kp = rotated(k, p);
+									T kq = rotated(k, q);
+									rotated(k, p) = c * kp - s * kq;
+									rotated(k, q) = s * kp + c * kq;
+								}
+							}
+						}
+					}
+
+					std::vector<size_t> order(size);
+					for (size_t index = 0; index < size; ++index)
+						order[index] = index;
+					std::sort(order.begin(), order.end(), [&a](size_t first, size_t second) { return a(first, first) > a(second, second);});
+
+					values.resize(size);
+					vectors = DenseMatrix<T>(size, size);
+					for (size_t index = 0; index < size; ++index)
+					{
+						values[index] = a(order[index], order[index]);
+						for (size_t row_index = 0; row_index < size; ++row_index)
+							vectors(row_index, index) = rotated(row_index, order[index]);
+					}
+				}
+
+				// Leading singular values and right singular vectors of a rows x
+				// cols matrix A known only by its products: multiply sets y = A * x
+				// for cols x k x, multiply_transposed sets y = A^T * x for rows x k
+				// x, y comes sized.
+				//
+				// The range of A is caught by A applied to a few more random
+				// directions than the rank, refined by power iterations that
+				// orthonormalize between the products. A projected on that range
+				// is small, its singular vectors come from the eigen decomposition
+				// of its Gram matrix. Memory is O((rows + cols) * rank).
+				template<typename T> void randomized_svd( size_t rows
+														, size_t cols
+														, size_t rank
+														, size_t power_iterations
+														, unsigned int seed
+														, const std::function<void(const DenseMatrix<T>&, DenseMatrix<T>&)>& multiply
+														, const std::function<void(const DenseMatrix<T>&, DenseMatrix<T>&)>& multiply_transposed
+														, std::vector<T>& singular_values
+														, DenseMatrix<T>& right_vectors)
+				{
+					using namespace RandomizedSvd;
+					size_t samples = std::min(rank + oversampling, std::min(rows, cols));
+					rank = std::min(rank, samples);
+
+					std::mt19937 generator(seed);
+					std::normal_distribution<T> normal;
+					DenseMatrix<T> directions(cols, samples);
+					for (size_t row_index = 0; row_index < cols; ++row_index)
+					{
+						for (size_t col_index = 0; col_index < samples; ++col_index)
+							directions(row_index, col_index) = normal(generator);
+					}
+
+					DenseMatrix<T> range(rows, samples);
+					multiply(directions, range);
+					for (size_t iteration = 0; iteration < power_iterations; ++iteration)
+					{
+						range = orthonormal_columns(range);
+						multiply_transposed(range, directions);
+						directions = orthonormal_columns(directions);
+						multiply(directions, range);
+					}
+					range = orthonormal_columns(range);
+
+					// B = Q^T * A is kept transposed, B * B^T = U * S^2 * U^T and
+					// the right vectors are B^T * U / S
+					DenseMatrix<T> projection(cols, samples);
+					multiply_transposed(range, projection);
+					DenseMatrix<T> gram;
+					gemm(true, false, T(1), projection, projection, T(0), gram);
+
+					std::vector<T> values;
+					DenseMatrix<T> vectors;
+					symmetric_eigen(gram, values, vectors);
+
+					DenseMatrix<T> leading(samples, rank);
+					singular_values.assign(rank, T(0));
+					for (size_t index = 0; index < rank; ++index)
+					{
+						singular_values[index] = sqrt(std::max(values[index], T(0)));
+						T scale = singular_values[index] > 0 ? T(1) / singular_values[index] : T(0);
+						for (size_t row_index = 0; row_index < samples; ++row_index)
+							leading(row_index, index) = vectors(row_index, index) * scale;
+					}
+					gemm(false, false, T(1), projection, leading, T(0), right_vectors);
+				}
+			}
+		}
+	}
+}
+
+#endif //MATHMATRIX_RANDOMIZED_SVD_H
@@ -1,7 +1,14 @@
 #ifndef MATHMATRIXSOLVER_H
 #define MATHMATRIXSOLVER_H
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 #include "mathmatrix.h"
+#include "mathmatrix_conjugate_gradient.h"
+#include "mathmatrix_dense.h"
+#include "mathmatrix_householder.h"
 
 
 using namespace MathCore::AlgebraCore::VectorCore;
@@ -28,6 +35,10 @@ namespace MathCore
 						}
 					};
 
+					// Substitution by columns: once an unknown is found its column is
+					// removed from the right side of the rows still to solve. The
+					// unknowns depend on each other and are found in turn, only the
+					// removal from the other rows is split between threads.
 					template <typename T> class DownTriangleSolver : public MathMatrixSolver < T >
 					{
 					public:
@@ -36,25 +47,50 @@ namespace MathCore
 						{
 							std::vector<T> result(vector.to_std_vector());
 
-							size_t row_size = matrix.row_size();
+							int row_size = (int)matrix.rows_size();
+							result.resize(row_size, T(0));
 
 							for (int index1 = 0; index1 < row_size; ++index1)
 							{
-
 								if (result.at(index1) != 0)
 								{
 									result.at(index1) /= matrix.at(index1, index1);
 
 									T value = result.at(index1);
 
-#pragma omp parallel for private(value);
+#pragma omp parallel for
 									for (int index2 = index1 + 1; index2 < row_size; ++index2)
-									{
-										T coefficient = matrix.at(index2, index1);
+										result.at(index2) -= matrix.at(index2, index1) * value;
+								}
+							}
 
-										result.at(index2) -= coefficient * value;
-									}
+							return MathVector<T>(result);
+						}
 
+					};
+
+					template <typename T> class UpTriangleSolver : public MathMatrixSolver < T >
+					{
+					public:
+
+						MathVector<T> solve(MathMatrix<T>& matrix, MathVector<T>& vector)
+						{
+							std::vector<T> result(vector.to_std_vector());
+
+							int row_size = (int)matrix.rows_size();
+							result.resize(row_size, T(0));
+
+							for (int index1 = row_size - 1; index1 >= 0; --index1)
+							{
+								if (result.at(index1) != 0)
+								{
+									result.at(index1) /= matrix.at(index1, index1);
+
+									T value = result.at(index1);
+
+#pragma omp parallel for
+									for (int index2 = 0; index2 < index1; ++index2)
+										result.at(index2) -= matrix.at(index2, index1) * value;
 								}
 							}
 
@@ -63,37 +99,93 @@ namespace MathCore
 
 					};
 
-						template <typename T> class UpTriangleSolver : public MathMatrixSolver < T >
+					// Jacobi preconditioned conjugate gradient on a symmetric
+					// positive definite matrix, its product is a dense gemm. For a
+					// matrix that is not formed, call conjugate_gradient with a
+					// product over the data instead.
+					template <typename T> class ConjugateGradientSolver : public MathMatrixSolver < T >
+					{
+					public:
+
+						ConjugateGradientSolver(T tolerance = T(1e-10), size_t max_iterations = 1000)
+						: m_tolerance(tolerance)
+						, m_max_iterations(max_iterations)
+						{ }
+
+						MathVector<T> solve(MathMatrix<T>& matrix, MathVector<T>& vector)
 						{
-						public:
+							DenseMatrix<T> dense(matrix);
+							size_t size = dense.rows();
+							std::vector<T> diagonal(size);
+							for (size_t index = 0; index < size; ++index)
+								diagonal[index] = dense(index, index);
+
+							std::vector<T> values(vector.to_std_vector());
+							DenseMatrix<T> b(size, 1);
+							for (size_t index = 0; index < std::min(size, values.size()); ++index)
+								b(index, 0) = values[index];
+
+							std::function<void(const DenseMatrix<T>&, DenseMatrix<T>&)> multiply =
+								[&dense](const DenseMatrix<T>& x, DenseMatrix<T>& y) { gemm(false, false, T(1), dense, x, T(0), y);};
+							DenseMatrix<T> x(size, 1);
+							conjugate_gradient(multiply, diagonal, b, x, m_tolerance, m_max_iterations);
+
+							std::vector<T> result(size);
+							for (size_t index = 0; index < size; ++index)
+								result[index] = x(index, 0);
 
-							MathVector<T> solve(MathMatrix<T>& matrix, MathVector<T>& vector)
-							{
-								std::vector<T> result(vector.to_std_vector());
+							return MathVector<T>(result);
+						}
 
-								size_t row_size = matrix.rows_size();
-                                #pragma omp parallel for
-								for (int index1 = row_size - 1; index1 >= 0; index1--)
-								{
-                                    T value = result.at(index1) / matrix.at(index1, index1);
+					private:
+						T m_tolerance;
+						size_t m_max_iterations;
+					};
 
-                                    #pragma omp atomic
-									result.at(index1) = value;
+					// x minimizing |matrix * x - vector| by the householder QR of
+					// the matrix, which needs at least as many rows as columns and
+					// full rank. A factored matrix is kept for the next solves.
+					template <typename T> class LeastSquaresSolver : public MathMatrixSolver < T >
+					{
+					public:
 
-                                    #pragma omp parallel for
-									for (int index2 = index1 - 1; index2 >= 0; index2--)
-									{
+						LeastSquaresSolver() { }
 
-										T coefficient = result.at(index2) - matrix.at(index2, index1) * value;
-                                        #pragma omp atomic
-										result.at(index2) = coefficient;
-									}
-								}
+						explicit LeastSquaresSolver(const DenseMatrix<T>& matrix)
+						: m_qr(matrix)
+						{ }
 
-								return MathVector<T>(result);
-							}
+						MathVector<T> solve(MathMatrix<T>& matrix, MathVector<T>& vector)
+						{
+							DenseMatrix<T> dense(matrix);
+							m_qr.decompose(dense);
+
+							std::vector<T> values(vector.to_std_vector());
+							values.resize(m_qr.rows(), T(0));
+							DenseMatrix<T> b(m_qr.rows(), 1);
+							for (size_t index = 0; index < values.size(); ++index)
+								b(index, 0) = values[index];
+
+							DenseMatrix<T> x = solve(b);
+							std::vector<T> result(m_qr.cols());
+							for (size_t index = 0; index < result.size(); ++index)
+								result[index] = x(index, 0);
+
+							return MathVector<T>(result);
+						}
+
+						// solutions for every column of b with the factored matrix
+						DenseMatrix<T> solve(const DenseMatrix<T>& b) const
+						{
+							if (m_qr.rows() < m_qr.cols())
+								throw std::logic_error("least squares of an underdetermined system");
 
-						};
+							return m_qr.solve(b);
+						}
+
+					private:
+						HouseholderQR<T> m_qr;
+					};
 				}
 			}
 		}
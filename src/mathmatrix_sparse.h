@@ -0,0 +1,163 @@
+#ifndef MATHMATRIX_SPARSE_H
+#define MATHMATRIX_SPARSE_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "mathvector.h"
+#include "mathmatrix_dense.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace MatrixCore
+		{
+			// Compressed sparse rows: the not null elements of all rows in one
+			// array in row and index order, offsets tell where every row
+			// starts. Elements with an index out of cols are dropped, a product
+			// with a cols sized operand ignores them the same way a dot
+			// product of MathVector does.
+			template<typename T> class SparseMatrix
+			{
+			public:
+				SparseMatrix()
+				: m_cols(0)
+				, m_offsets(1, 0)
+				{ }
+
+				SparseMatrix(const std::vector<MathVector<T>>& rows, size_t cols)
+				: m_cols(0)
+				, m_offsets(1, 0)
+				{
+					assign(rows.size(), cols, [&rows](size_t index) -> const MathVector<T>& { return rows[index];});
+				}
+
+				// rows come from row_at(index), a callable returning a MathVector
+				// reference; rows are counted and then copied in parallel
+				template<typename RowAt> void assign(size_t rows, size_t cols, RowAt row_at)
+				{
+					m_cols = cols;
+					m_offsets.assign(rows + 1, 0);
+#pragma omp parallel for schedule(dynamic, 256)
+					for (size_t row_index = 0; row_index < rows; ++row_index)
+					{
+						const MathVector<T>& row = row_at(row_index);
+						size_t count = 0;
+						for (typename MathVector<T>::const_fast_iterator it = row.const_fast_begin(); it != row.const_fast_end(); ++it)
+						{
+							if (it.index() < cols)
+								++count;
+						}
+						m_offsets[row_index + 1] = count;
+					}
+					for (size_t row_index = 0; row_index < rows; ++row_index)
+						m_offsets[row_index + 1] += m_offsets[row_index];
+
+					m_indexes.resize(m_offsets[rows]);
+					m_values.resize(m_offsets[rows]);
+#pragma omp parallel for schedule(dynamic, 256)
+					for (size_t row_index = 0; row_index < rows; ++row_index)
+					{
+						const MathVector<T>& row = row_at(row_index);
+						size_t position = m_offsets[row_index];
+						for (typename MathVector<T>::const_fast_iterator it = row.const_fast_begin(); it != row.const_fast_end(); ++it)
+						{
+							if (it.index() < cols)
+							{
+								m_indexes[position] = it.index();
+								m_values[position]  = it.getElem();
+								++position;
+							}
+						}
+					}
+				}
+
+				size_t rows()      const { return m_offsets.size() - 1;};
+				size_t cols()      const { return m_cols;};
+				size_t not_nulls() const { return m_values.size();};
+
+				size_t row_begin(size_t index) const { return m_offsets[index];};
+				size_t row_end(size_t index)   const { return m_offsets[index + 1];};
+				const size_t* indexes() const { return m_indexes.data();};
+				const T*      values()  const { return m_values.data();};
+
+			private:
+				size_t m_cols;
+				std::vector<size_t> m_offsets;
+				std::vector<size_t> m_indexes;
+				std::vector<T> m_values;
+			};
+
+			namespace MatrixAlgorithm
+			{
+				namespace Sparse
+				{
+					// rows of a thread task, small enough to balance uneven rows
+					const size_t block_rows = 256;
+				}
+
+				// y = a * x, x has a.cols() elements and y a.rows()
+				template<typename T> void spmv(const SparseMatrix<T>& a, const T* x, T* y)
+				{
+					using namespace Sparse;
+					const size_t* indexes = a.indexes();
+					const T*      values  = a.values();
+					size_t blocks = (a.rows() + block_rows - 1) / block_rows;
+#pragma omp parallel for schedule(dynamic, 1)
+					for (size_t block = 0; block < blocks; ++block)
+					{
+						size_t row_end = std::min(a.rows(), (block + 1) * block_rows);
+						for (size_t row_index = block * block_rows; row_index < row_end; ++row_index)
+						{
+							T value = 0;
+							for (size_t position = a.row_begin(row_index); position < a.row_end(row_index); ++position)
+								value += values[position] * x[indexes[position]];
+							y[row_index] = value;
+						}
+					}
+				}
+
+				// c = a * b, b is a.cols() x k and c is resized to a.rows() x k.
+				// Every not null element adds its multiple of a row of b to the
+				// row of c, a contiguous loop over k the compiler vectorizes.
+				template<typename T> void spmm(const SparseMatrix<T>& a, const DenseMatrix<T>& b, DenseMatrix<T>& c)
+				{
+					using namespace Sparse;
+					if (a.cols() != b.rows())
+						throw std::logic_error("multiplication dimensions mismatch");
+
+					size_t columns = b.cols();
+					if (c.rows() != a.rows() || c.cols() != columns)
+						c = DenseMatrix<T>(a.rows(), columns);
+
+					const size_t* indexes = a.indexes();
+					const T*      values  = a.values();
+					size_t blocks = (a.rows() + block_rows - 1) / block_rows;
+#pragma omp parallel for schedule(dynamic, 1)
+					for (size_t block = 0; block < blocks; ++block)
+					{
+						size_t row_end = std::min(a.rows(), (block + 1) * block_rows);
+						for (size_t row_index = block * block_rows; row_index < row_end; ++row_index)
+						{
+							T* c_row = c.row(row_index);
+							std::fill(c_row, c_row + columns, T(0));
+							for (size_t position = a.row_begin(row_index); position < a.row_end(row_index); ++position)
+							{
+								const T* b_row = b.row(indexes[position]);
+								T value = values[position];
+								for (size_t column = 0; column < columns; ++column)
+									c_row[column] += value * b_row[column];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+#endif //MATHMATRIX_SPARSE_H
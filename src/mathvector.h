@@ -2,6 +2,7 @@
 #define MATHVECTOR_H
 
 #include <memory>
+#include <memory_resource>
 #include <algorithm>
 #include <vector>
 #include <map>
@@ -15,6 +16,7 @@
 #include <iostream>
 
 #include "math_vector_iterator.h"
+#include "mathvector_expression.h"
 
 using namespace std;
 
@@ -44,12 +46,18 @@ namespace MathCore
 				}
 			}
 
-			template<typename T> class MathVector
+			template<typename T> class MathVector : public VectorExpression<T, MathVector<T>>
 			{
+			public:
+				// elements are kept in polymorphic containers, a vector built
+				// with a memory resource, e.g. an arena, allocates from it
+				typedef std::pmr::unordered_map<size_t, T> elements_type;
+				typedef std::pmr::set<size_t> indexes_type;
+
 			private:
 				size_t size;
-				std::unordered_map<size_t, T> data;
-				std::set<size_t> not_nulls;
+				elements_type data;
+				indexes_type not_nulls;
 
 			public:
 
@@ -63,6 +71,7 @@ namespace MathCore
 				
 				typedef FastMathVectorIterator<T> fast_iterator;
 				typedef ConstFastMathVectorIterator<T> const_fast_iterator;
+				typedef MathVectorCursor<T> cursor;
 
 				friend fast_iterator;
 				friend const_fast_iterator;
@@ -71,11 +80,18 @@ namespace MathCore
 				friend VectorAlgorithm::MatrixSolver::MathMatrixSolver < T > ;
 
 				MathVector<T>();
-				MathVector<T>(size_t _size, T _default_value);
+				explicit MathVector<T>(std::pmr::memory_resource* resource);
+				MathVector<T>(size_t _size, T _default_value, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+				// a copy allocates from the default resource, not from the one of other
 				MathVector<T>(const MathVector<T>& other);
+				MathVector<T>(const MathVector<T>& other, std::pmr::memory_resource* resource);
+				MathVector<T>(MathVector<T>&& other) noexcept;
+				template<typename E> MathVector<T>(const VectorExpression<T, E>& expression);
 				MathVector<T>(const vector<T>& other);
-				MathVector<T>(const std::unordered_map<size_t, T>& other);
-				MathVector<T>(const std::unordered_map<size_t, T>& other, const std::set<size_t>& not_nulls);
+				MathVector<T>(const std::unordered_map<size_t, T>& other, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+				MathVector<T>(const std::unordered_map<size_t, T>& other, const std::set<size_t>& not_nulls, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+				std::pmr::memory_resource* resource() const { return data.get_allocator().resource();};
 
 				void setValues(const vector<T>& other);
 				void setValues(size_t _size, T _default_value);
@@ -94,12 +110,16 @@ namespace MathCore
 				const size_t& getSize() const;
 				size_t getSizeOfNotNullElements();
 
-				std::vector<T>& to_std_vector();
+				std::vector<T> to_std_vector() const;
 
-				T operator*(const MathVector<T>& other);
+				MathVector<T>& operator=(const MathVector<T>& other);
+				MathVector<T>& operator=(MathVector<T>&& other);
+				// the expression is evaluated in one pass over its operands, it
+				// may hold this vector
+				template<typename E> MathVector<T>& operator=(const VectorExpression<T, E>& expression);
+
+				T operator*(const MathVector<T>& other) const;
 
-				MathVector<T> operator*(const T& value);
-				MathVector<T> operator/(const T& value);
 				MathVector<T> operator+(const T& value);
 				MathVector<T> operator-(const T& value);
 
@@ -108,11 +128,9 @@ namespace MathCore
 				MathVector<T>& operator+=(const T& value);
 				MathVector<T>& operator-=(const T& value);
 
-				MathVector<T> operator+(const MathVector<T>& other);
-				MathVector<T> operator-(const MathVector<T>& other);
-
-				MathVector<T>& operator+=(const MathVector<T>& other);
-				MathVector<T>& operator-=(const MathVector<T>& other);
+				// added in place, elements that become zero are removed
+				template<typename E> MathVector<T>& operator+=(const VectorExpression<T, E>& expression);
+				template<typename E> MathVector<T>& operator-=(const VectorExpression<T, E>& expression);
 
 				bool operator==(const MathVector &other) const;
 				bool operator!=(const MathVector &other) const;
@@ -136,6 +154,15 @@ namespace MathCore
 				{
 					return const_fast_iterator(*this, (size_t)size);
 				}
+
+				cursor cursor_begin() const
+				{
+					return cursor(*this);
+				}
+
+			private:
+
+				template<typename E> void add(const VectorExpression<T, E>& expression, T sign);
 			};
 
 			template<typename T> MathVector<T>::MathVector()
@@ -143,8 +170,13 @@ namespace MathCore
 			{
 			}
 
-			template<typename T> MathVector<T>::MathVector(size_t _size, T _default_value)
-				: size(_size)
+			template<typename T> MathVector<T>::MathVector(std::pmr::memory_resource* resource)
+				: size(0), data(resource), not_nulls(resource)
+			{
+			}
+
+			template<typename T> MathVector<T>::MathVector(size_t _size, T _default_value, std::pmr::memory_resource* resource)
+				: size(_size), data(resource), not_nulls(resource)
 			{
 				if (_default_value != 0)
 				{
@@ -162,25 +194,40 @@ namespace MathCore
 			{
 			}
 
-			template<typename T> MathVector<T>::MathVector(const std::unordered_map<size_t, T>& other, const std::set<size_t>& not_nulls)
+			template<typename T> MathVector<T>::MathVector(const MathVector<T>& other, std::pmr::memory_resource* resource)
+				: size(other.size), data(other.data, resource), not_nulls(other.not_nulls, resource)
 			{
-				this->data = other;
-				this->not_nulls = not_nulls;
 			}
 
-			template<typename T> MathVector<T>::MathVector(const std::unordered_map<size_t, T>& other)
+			template<typename T> MathVector<T>::MathVector(MathVector<T>&& other) noexcept
+				: size(other.size), data(std::move(other.data)), not_nulls(std::move(other.not_nulls))
 			{
-				this->data = other;
+				other.size = 0;
+			}
 
-				typename std::unordered_map<size_t, T>::const_iterator begin = this->data.begin();
-				typename std::unordered_map<size_t, T>::const_iterator end = this->data.end();
+			template<typename T> template<typename E> MathVector<T>::MathVector(const VectorExpression<T, E>& expression)
+				: size(0)
+			{
+				*this = expression;
+			}
+
+			template<typename T> MathVector<T>::MathVector(const std::unordered_map<size_t, T>& other, const std::set<size_t>& not_nulls, std::pmr::memory_resource* resource)
+				: data(other.begin(), other.end(), other.size(), resource), not_nulls(not_nulls.begin(), not_nulls.end(), resource)
+			{
+			}
+
+			template<typename T> MathVector<T>::MathVector(const std::unordered_map<size_t, T>& other, std::pmr::memory_resource* resource)
+				: data(other.begin(), other.end(), other.size(), resource), not_nulls(resource)
+			{
+				typename elements_type::const_iterator begin = this->data.begin();
+				typename elements_type::const_iterator end = this->data.end();
 
 				for (; begin != end; ++begin)
 				{
 					this->not_nulls.insert(begin->first);
 				}
 
-                typename std::set<size_t, T>::iterator last = this->not_nulls.end();
+                typename indexes_type::iterator last = this->not_nulls.end();
 				last--;
 				this->size = *last + 1;
 			}
@@ -236,7 +283,7 @@ namespace MathCore
 
 			template<typename T> T MathVector<T>::getElement(size_t position) const
 			{
-				typename std::unordered_map<size_t, T>::const_iterator elem_it = this->data.find(position);
+				typename elements_type::const_iterator elem_it = this->data.find(position);
 				if (elem_it == this->data.end())
 				{
 					return 0;
@@ -249,7 +296,7 @@ namespace MathCore
 
 			template<typename T> T MathVector<T>::getMaximalElement()
 			{
-				typename std::unordered_map<size_t, T>::iterator position = std::max_element(this->data.begin(), this->data.end(), predicate());
+				typename elements_type::iterator position = std::max_element(this->data.begin(), this->data.end(), predicate());
 
 				if (position == this->data.end() ||
 					position->second < 0)
@@ -283,12 +330,12 @@ namespace MathCore
 					if (this->not_nulls.find(this->size)
 						!= this->not_nulls.end())
 					{
-						std::set<size_t>::iterator backIt
+						typename indexes_type::iterator backIt
 							= this->not_nulls.end();
 						backIt--;
 						this->not_nulls.erase(backIt);
 						poppedElement = this->data.at(this->size);
-						typename std::unordered_map<size_t, T>::iterator it = this->data.end();
+						typename elements_type::iterator it = this->data.end();
 						this->data.erase(--it);
 					}
 					else
@@ -324,7 +371,7 @@ namespace MathCore
 
 				if (element != 0)
 				{
-					typename std::unordered_map<size_t, T>::iterator pos_it = this->data.find(position);
+					typename elements_type::iterator pos_it = this->data.find(position);
 					if (pos_it != this->data.end())
 						pos_it->second = element;
 					else
@@ -339,14 +386,14 @@ namespace MathCore
 
 			template<typename T> size_t  MathVector<T>::first_not_null()
 			{
-				std::set<size_t>::iterator begin = this->not_nulls.begin();
+				typename indexes_type::iterator begin = this->not_nulls.begin();
 
 				return this->data.find(*begin)->second;
 			}
 
 			template<typename T> size_t  MathVector<T>::last_not_null()
 			{
-				std::set<size_t>::iterator end = this->not_nulls.end();
+				typename indexes_type::iterator end = this->not_nulls.end();
 
 				return this->data.find(*end)->second;
 			}
@@ -361,19 +408,19 @@ namespace MathCore
 				return this->data.size();
 			}
 
-			template<typename T> std::vector<T>& MathVector<T>::to_std_vector()
+			template<typename T> std::vector<T> MathVector<T>::to_std_vector() const
 			{
-				std::vector<T>* converted = new std::vector<T>(this->size, 0);
+				std::vector<T> converted(this->size, 0);
 
-				typename std::set<size_t>::iterator begin = this->not_nulls.begin();
-				typename std::set<size_t>::iterator end = this->not_nulls.end();
+				typename indexes_type::const_iterator begin = this->not_nulls.begin();
+				typename indexes_type::const_iterator end = this->not_nulls.end();
 
 				for (; begin != end; ++begin)
 				{
-					converted->at(*begin) = this->data.find(*begin)->second;
+					converted.at(*begin) = this->data.find(*begin)->second;
 				}
 
-				return *converted;
+				return converted;
 			}
 
 
@@ -395,7 +442,7 @@ namespace MathCore
             }
 
 
-			template<typename T> T  MathVector<T>::operator*(const MathVector<T>& other)
+			template<typename T> T  MathVector<T>::operator*(const MathVector<T>& other) const
 			{
 				T result = 0;
 
@@ -420,8 +467,8 @@ namespace MathCore
 					}
 					else
 					{
-						MathVector<T>::fast_iterator it  = this->fast_begin();
-						MathVector<T>::fast_iterator end = this->fast_end(); 
+						MathVector<T>::const_fast_iterator it  = this->const_fast_begin();
+						MathVector<T>::const_fast_iterator end = this->const_fast_end();
 						for (; it != end; ++it)
 						{
 							if (other.not_nulls.find(it.index())
@@ -434,8 +481,8 @@ namespace MathCore
 				}
 				else
 				{
-					fast_iterator firstBegin = this->fast_begin();
-					fast_iterator firstEnd   = this->fast_end();
+					const_fast_iterator firstBegin = this->const_fast_begin();
+					const_fast_iterator firstEnd   = this->const_fast_end();
 					const_fast_iterator secondBegin = other.const_fast_begin();
 					const_fast_iterator secondEnd   = other.const_fast_end();
 
@@ -470,51 +517,6 @@ namespace MathCore
 				return result;
 			}
 
-			template<typename T>MathVector<T> MathVector<T>::operator*(const T& value)
-			{
-				MathVector<T> result(*this);
-
-				if (value == 0)
-				{
-					result.data.clear();
-					result.not_nulls.clear();
-				}
-				else
-				{
-					fast_iterator begin = result.fast_begin();
-					fast_iterator end = result.fast_end();
-
-					for (; begin != end; ++begin)
-					{
-						 T new_value = begin.getElem() * value;
-						 begin.setElement(new_value);
-					}
-				}
-				return result;
-			}
-
-			template<typename T>MathVector<T> MathVector<T>::operator/(const T& value)
-			{
-				MathVector<T> result(*this);
-
-				if (value == 0)
-				{
-					throw std::logic_error("division by zero");
-				}
-				else
-				{
-					fast_iterator begin = result.fast_begin();
-					fast_iterator end = result.fast_end();
-
-					for (; begin != end; ++begin)
-					{
-						T new_value = begin.getElem() / value;
-						begin.setElement(new_value);
-					}
-				}
-				return result;
-			}
-
 			template<typename T>MathVector<T> MathVector<T>::operator+(const T& value)
 			{
 				MathVector<T> result(*this);
@@ -682,376 +684,96 @@ namespace MathCore
 				return *this;
 			}
 
-			template<typename T> MathVector<T>  MathVector<T>::operator+(const MathVector<T>& other)
+			template<typename T> MathVector<T>& MathVector<T>::operator=(const MathVector<T>& other)
 			{
-				double thisLoadFactor = (double)this->not_nulls.size() / (double)this->size;
-				double otherLoadFactor = (double)other.not_nulls.size() / (double)other.size;
-				if (thisLoadFactor <= 0.5 || otherLoadFactor <= 0.5)
-				{
-					if (this->not_nulls.size() > other.not_nulls.size())
-					{
-						MathVector<T> result(*this);
-						MathVector<T>::const_fast_iterator it = other.const_fast_begin();
-						MathVector<T>::const_fast_iterator end = other.const_fast_end();
-						for (; it != end; ++it)
-						{
-						    T value = it.getElem() + result.getElement(it.index());
-							result.insert(value, it.index());
-						}
+				this->size = other.size;
+				this->data = other.data;
+				this->not_nulls = other.not_nulls;
 
-						return result;
-					}
-					else
-					{
-					    MathVector<T> result(other);
-						MathVector<T>::fast_iterator it  = this->fast_begin();
-						MathVector<T>::fast_iterator end = this->fast_end();
-						for (; it != end; ++it)
-						{
-							T value = it.getElem() + result.getElement(it.index());
-							result.insert(value, it.index());
-						}
-
-						return result;
-					}
-				}
-				else
-				{
-					MathVector<T> result(this->size, 0);
-					fast_iterator firstBegin = this->fast_begin();
-					fast_iterator firstEnd   = this->fast_end();
-					const_fast_iterator secondBegin = other.const_fast_begin();
-					const_fast_iterator secondEnd   = other.const_fast_end();
-
-					while (firstBegin != firstEnd || secondBegin != secondEnd)
-					{
-						if (firstBegin == firstEnd)
-						{
-							T newvalue = secondBegin.getElem();
-							result.insert(newvalue, secondBegin.index());
-							++secondBegin;
-						}
-						else if (secondBegin == secondEnd)
-						{
-							T newvalue = firstBegin.getElem();
-							result.insert(newvalue, firstBegin.index());
-							++firstBegin;
-						}
-						else if (firstBegin.index() == secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem() + secondBegin.getElem();
-							result.insert(newvalue, firstBegin.index());
-							++firstBegin;
-							++secondBegin;
-						}
-						else if (firstBegin.index() > secondBegin.index())
-						{
-							T newvalue = secondBegin.getElem();
-							result.insert(newvalue, secondBegin.index());
-							++secondBegin;
-						}
-						else if (firstBegin.index() < secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem();
-							result.insert(newvalue, firstBegin.index());
-							++firstBegin;
-						}
-					}
-
-					return result;
-				}
+				return *this;
 			}
 
-			template<typename T>MathVector<T> MathVector<T>::operator-(const MathVector<T>& other)
+			template<typename T> MathVector<T>& MathVector<T>::operator=(MathVector<T>&& other)
 			{
-				MathVector<T> result(this->size, 0.0);
-				double thisLoadFactor = (double)this->not_nulls.size() / (double)this->size;
-				double otherLoadFactor = (double)other.not_nulls.size() / (double)other.size;
-
-				if (thisLoadFactor <= 0.5 || otherLoadFactor <= 0.5)
-				{
-					if (this->not_nulls.size() > other.not_nulls.size())
-					{
-						MathVector<T>::const_fast_iterator it = other.const_fast_begin();
-						MathVector<T>::const_fast_iterator end = other.const_fast_end();
-
-						for (; it != end; ++it)
-						{
-							T value = this->getElement(it.index()) - it.getElem();
-							result.insert(value, it.index());
-						}
-					}
-					else
-					{
-						MathVector<T>::fast_iterator it  = this->fast_begin();
-						MathVector<T>::fast_iterator end = this->fast_end(); 
-						for (; it != end; ++it)
-						{
-							T value = it.getElem() - other.getElement(it.index());
-							result.insert(value, it.index());
-						}
-					}
-				}
-				else
-				{
-					fast_iterator firstBegin = this->fast_begin();
-					fast_iterator firstEnd   = this->fast_end();
-					const_fast_iterator secondBegin = other.const_fast_begin();
-					const_fast_iterator secondEnd   = other.const_fast_end();
-
-					while (firstBegin != firstEnd || secondBegin != secondEnd)
-					{
-						if (firstBegin == firstEnd)
-						{
-							T newvalue = (-1.0) * secondBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								result.insert(newvalue, secondBegin.index());
-							}
-							++secondBegin;
-						}
-						else if (secondBegin == secondEnd)
-						{
-							T newvalue = firstBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								result.insert(newvalue, firstBegin.index());
-							}
-							++firstBegin;
-						}
-						else if (firstBegin.index() == secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem() - secondBegin.getElem();
+				this->size = other.size;
+				this->data = std::move(other.data);
+				this->not_nulls = std::move(other.not_nulls);
+				other.size = 0;
 
-							if (newvalue != 0.0)
-							{
-								result.insert(newvalue, firstBegin.index());
-							}
-
-							++firstBegin;
-							++secondBegin;
-						}
-						else if (firstBegin.index() > secondBegin.index())
-						{
-							T newvalue = (-1.0) * secondBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								result.insert(newvalue, secondBegin.index());
-							}
-
-							++secondBegin;
-						}
-						else if (firstBegin.index() < secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								result.insert(newvalue, firstBegin.index());
-							}
-
-							++firstBegin;
-						}
-					}
-				}
-				return result;
+				return *this;
 			}
 
-			template<typename T> MathVector<T>& MathVector<T>::operator+=(const MathVector<T>& other)
+			template<typename T> template<typename E> MathVector<T>& MathVector<T>::operator=(const VectorExpression<T, E>& _expression)
 			{
-				double thisLoadFactor = (double)this->not_nulls.size() / (double)this->size;
-				double otherLoadFactor = (double)other.not_nulls.size() / (double)other.size;
+				const E& expression = _expression.expression();
 
-				if (thisLoadFactor <= 0.5 || otherLoadFactor <= 0.5)
+				// filled aside, the expression may read this vector; with the
+				// resource of this vector, so the containers can be swapped
+				elements_type values(this->data.get_allocator());
+				indexes_type indexes(this->not_nulls.get_allocator());
+				for (typename E::cursor it = expression.cursor_begin(); it.index() != Expression::end_index; it.advance())
 				{
-					if (this->not_nulls.size() > other.not_nulls.size())
-					{
-						MathVector<T>::const_fast_iterator it = other.const_fast_begin();
-						MathVector<T>::const_fast_iterator end = other.const_fast_end();
-
-						for (; it != end; ++it)
-						{
-							T value = this->getElement(it.index()) + it.getElem();
-							this->insert(value, it.index());
-						}
-					}
-					else
+					T value = it.value();
+					if (value != 0)
 					{
-						MathVector<T>::fast_iterator it  = this->fast_begin();
-						MathVector<T>::fast_iterator end = this->fast_end(); 
-						for (; it != end; ++it)
-						{
-							T value = it.getElem() + other.getElement(it.index());
-							this->insert(value, it.index());
-						}
+						indexes.insert(indexes.end(), it.index());
+						values.insert(std::make_pair(it.index(), value));
 					}
 				}
-				else
-				{
-					fast_iterator firstBegin = this->fast_begin();
-					fast_iterator firstEnd   = this->fast_end();
-					const_fast_iterator secondBegin = other.const_fast_begin();
-					const_fast_iterator secondEnd   = other.const_fast_end();
-
-					while (firstBegin != firstEnd || secondBegin != secondEnd)
-					{
-						if (firstBegin == firstEnd)
-						{
-							T newvalue = secondBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, secondBegin.index());
-							}
-							++secondBegin;
-						}
-						else if (secondBegin == secondEnd)
-						{
-							T newvalue = firstBegin.getElem();
 
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, firstBegin.index());
-							}
-							++firstBegin;
-						}
-						else if (firstBegin.index() == secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem() + secondBegin.getElem();
+				this->size = expression.getSize();
+				this->data.swap(values);
+				this->not_nulls.swap(indexes);
 
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, firstBegin.index());
-							}
-
-							++firstBegin;
-							++secondBegin;
-						}
-						else if (firstBegin.index() > secondBegin.index())
-						{
-							T newvalue = secondBegin.getElem();
+				return *this;
+			}
 
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, secondBegin.index());
-							}
+			template<typename T> template<typename E> MathVector<T>& MathVector<T>::operator+=(const VectorExpression<T, E>& expression)
+			{
+				this->add(expression, T(1));
 
-							++secondBegin;
-						}
-						else if (firstBegin.index() < secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem();
+				return *this;
+			}
 
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, firstBegin.index());
-							}
+			template<typename T> template<typename E> MathVector<T>& MathVector<T>::operator-=(const VectorExpression<T, E>& expression)
+			{
+				this->add(expression, T(-1));
 
-							++firstBegin;
-						}
-					}
-				}
 				return *this;
 			}
 
-			template<typename T> MathVector<T>& MathVector<T>::operator-=(const MathVector<T>& other)
+			template<typename T> template<typename E> void MathVector<T>::add(const VectorExpression<T, E>& _expression, T sign)
 			{
-				double thisLoadFactor = (double)this->not_nulls.size() / (double)this->size;
-				double otherLoadFactor = (double)other.not_nulls.size() / (double)other.size;
+				const E& expression = _expression.expression();
+				this->size = std::max(this->size, expression.getSize());
 
-				if (thisLoadFactor <= 0.5 || otherLoadFactor <= 0.5)
+				typename E::cursor it = expression.cursor_begin();
+				while (it.index() != Expression::end_index)
 				{
-					if (this->not_nulls.size() > other.not_nulls.size())
-					{
-						MathVector<T>::const_fast_iterator it = other.const_fast_begin();
-						MathVector<T>::const_fast_iterator end = other.const_fast_end();
+					// the cursor leaves an element before it is changed, so the
+					// expression may hold this vector
+					size_t index = it.index();
+					T value = sign * it.value();
+					it.advance();
+					if (value == 0)
+						continue;
 
-						for (; it != end; ++it)
-						{
-							T value = this->getElement(it.index()) - it.getElem();
-							this->insert(value, it.index());
-						}
+					typename elements_type::iterator position = this->data.find(index);
+					if (position == this->data.end())
+					{
+						this->data.insert(std::make_pair(index, value));
+						this->not_nulls.insert(index);
 					}
-					else
+					else if (position->second + value == 0)
 					{
-						MathVector<T>::fast_iterator it  = this->fast_begin();
-						MathVector<T>::fast_iterator end = this->fast_end(); 
-						for (; it != end; ++it)
-						{
-							T value = it.getElem() - other.getElement(it.index());
-							this->insert(value, it.index());
-						}
+						this->data.erase(position);
+						this->not_nulls.erase(index);
 					}
-				}
-				else
-				{
-					fast_iterator firstBegin = this->fast_begin();
-					fast_iterator firstEnd   = this->fast_end();
-					const_fast_iterator secondBegin = other.const_fast_begin();
-					const_fast_iterator secondEnd   = other.const_fast_end();
-
-					while (firstBegin != firstEnd || secondBegin != secondEnd)
+					else
 					{
-						if (firstBegin == firstEnd)
-						{
-							T newvalue = (-1.0) * secondBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, secondBegin.index());
-							}
-							++secondBegin;
-						}
-						else if (secondBegin == secondEnd)
-						{
-							T newvalue = firstBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, firstBegin.index());
-							}
-							++firstBegin;
-						}
-						else if (firstBegin.index() == secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem() - secondBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, firstBegin.index());
-							}
-
-							++firstBegin;
-							++secondBegin;
-						}
-						else if (firstBegin.index() > secondBegin.index())
-						{
-							T newvalue = (-1.0) * secondBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, secondBegin.index());
-							}
-
-							++secondBegin;
-						}
-						else if (firstBegin.index() < secondBegin.index())
-						{
-							T newvalue = firstBegin.getElem();
-
-							if (newvalue != 0.0)
-							{
-								this->insert(newvalue, firstBegin.index());
-							}
-
-							++firstBegin;
-						}
+						position->second += value;
 					}
 				}
-				return *this;
 			}
 
 			template<typename T> bool MathVector<T>::operator==(const MathVector &_other) const
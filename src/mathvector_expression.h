@@ -0,0 +1,215 @@
+#ifndef MATHVECTOR_EXPRESSION_H
+#define MATHVECTOR_EXPRESSION_H
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace MathCore
+{
+	namespace AlgebraCore
+	{
+		namespace VectorCore
+		{
+			template<typename T> class MathVector;
+
+			namespace Expression
+			{
+				// index of a cursor past its last not null element
+				const size_t end_index = std::numeric_limits<size_t>::max();
+
+				// vectors are held by reference, expression nodes are small
+				// temporaries and are held by value
+				template<typename E> struct Storage
+				{
+					typedef const E type;
+				};
+
+				template<typename T> struct Storage<MathVector<T>>
+				{
+					typedef const MathVector<T>& type;
+				};
+			}
+
+			// Base of lazy vector arithmetic. An expression is not computed
+			// until it is assigned to or added to a MathVector, then all of
+			// its operands are walked at once in index order by a cursor:
+			// index() of the current not null element, value() of it and
+			// advance() to the next one. Sums of sparse vectors visit only
+			// the union of their not null indexes and no temporary vector is
+			// made for the inner nodes.
+			template<typename T, typename E> class VectorExpression
+			{
+			public:
+				typedef T value_type;
+
+				const E& expression() const { return static_cast<const E&>(*this);};
+			};
+
+			template<typename T> class MathVectorCursor
+			{
+			public:
+				MathVectorCursor(const MathVector<T>& vector)
+				: m_it(vector.const_fast_begin())
+				, m_end(vector.const_fast_end())
+				{ }
+
+				size_t index() const { return m_it != m_end ? m_it.index() : Expression::end_index;};
+				T value() const { return m_it.getElem();};
+				void advance() { ++m_it;};
+
+			private:
+				typename MathVector<T>::const_fast_iterator m_it;
+				typename MathVector<T>::const_fast_iterator m_end;
+			};
+
+			// first + sign * second, a difference is a sum with sign -1
+			template<typename T, typename L, typename R> class VectorSum : public VectorExpression<T, VectorSum<T, L, R>>
+			{
+			public:
+				class cursor
+				{
+				public:
+					cursor(const VectorSum& sum)
+					: m_first(sum.m_first.cursor_begin())
+					, m_second(sum.m_second.cursor_begin())
+					, m_sign(sum.m_sign)
+					{
+						m_index = std::min(m_first.index(), m_second.index());
+					}
+
+					size_t index() const { return m_index;};
+
+					T value() const
+					{
+						T value = 0;
+						if (m_first.index() == m_index)
+							value += m_first.value();
+						if (m_second.index() == m_index)
+							value += m_sign * m_second.value();
+						return value;
+					}
+
+					void advance()
+					{
+						if (m_first.index() == m_index)
+							m_first.advance();
+						if (m_second.index() == m_index)
+							m_second.advance();
+						m_index = std::min(m_first.index(), m_second.index());
+					}
+
+				private:
+					typename L::cursor m_first;
+					typename R::cursor m_second;
+					T m_sign;
+					size_t m_index;
+				};
+
+				VectorSum(const L& first, const R& second, T sign)
+				: m_first(first)
+				, m_second(second)
+				, m_sign(sign)
+				{ }
+
+				size_t getSize() const { return std::max(m_first.getSize(), m_second.getSize());};
+				cursor cursor_begin() const { return cursor(*this);};
+
+			private:
+				typename Expression::Storage<L>::type m_first;
+				typename Expression::Storage<R>::type m_second;
+				T m_sign;
+			};
+
+			template<typename T, typename E> class VectorScale : public VectorExpression<T, VectorScale<T, E>>
+			{
+			public:
+				class cursor
+				{
+				public:
+					cursor(const VectorScale& scale)
+					: m_it(scale.m_expression.cursor_begin())
+					, m_factor(scale.m_factor)
+					{ }
+
+					size_t index() const { return m_it.index();};
+					T value() const { return m_factor * m_it.value();};
+					void advance() { m_it.advance();};
+
+				private:
+					typename E::cursor m_it;
+					T m_factor;
+				};
+
+				VectorScale(const E& expression, T factor)
+				: m_expression(expression)
+				, m_factor(factor)
+				{ }
+
+				size_t getSize() const { return m_expression.getSize();};
+				cursor cursor_begin() const { return cursor(*this);};
+
+			private:
+				typename Expression::Storage<E>::type m_expression;
+				T m_factor;
+			};
+
+			template<typename T, typename L, typename R> VectorSum<T, L, R> operator+(const VectorExpression<T, L>& first, const VectorExpression<T, R>& second)
+			{
+				return VectorSum<T, L, R>(first.expression(), second.expression(), T(1));
+			}
+
+			template<typename T, typename L, typename R> VectorSum<T, L, R> operator-(const VectorExpression<T, L>& first, const VectorExpression<T, R>& second)
+			{
+				return VectorSum<T, L, R>(first.expression(), second.expression(), T(-1));
+			}
+
+			template<typename T, typename E> VectorScale<T, E> operator-(const VectorExpression<T, E>& expression)
+			{
+				return VectorScale<T, E>(expression.expression(), T(-1));
+			}
+
+			template<typename T, typename E> VectorScale<T, E> operator*(const VectorExpression<T, E>& expression, const typename VectorExpression<T, E>::value_type& value)
+			{
+				return VectorScale<T, E>(expression.expression(), value);
+			}
+
+			template<typename T, typename E> VectorScale<T, E> operator*(const typename VectorExpression<T, E>::value_type& value, const VectorExpression<T, E>& expression)
+			{
+				return VectorScale<T, E>(expression.expression(), value);
+			}
+
+			template<typename T, typename E> VectorScale<T, E> operator/(const VectorExpression<T, E>& expression, const typename VectorExpression<T, E>::value_type& value)
+			{
+				if (value == 0)
+					throw std::logic_error("division by zero");
+
+				return VectorScale<T, E>(expression.expression(), T(1) / value);
+			}
+
+			// dot product, only indexes not null in both operands are summed
+			template<typename T, typename L, typename R> T operator*(const VectorExpression<T, L>& first, const VectorExpression<T, R>& second)
+			{
+				T result = 0;
+				typename L::cursor first_it  = first.expression().cursor_begin();
+				typename R::cursor second_it = second.expression().cursor_begin();
+				while (first_it.index() != Expression::end_index && second_it.index() != Expression::end_index)
+				{
+					if (first_it.index() < second_it.index())
+						first_it.advance();
+					else if (second_it.index() < first_it.index())
+						second_it.advance();
+					else
+					{
+						result += first_it.value() * second_it.value();
+						first_it.advance();
+						second_it.advance();
+					}
+				}
+				return result;
+			}
+		}
+	}
+}
+
+#endif //MATHVECTOR_EXPRESSION_H
@@ -29,6 +29,13 @@ namespace MathCore
 					{
 						return 0;
 					}
+
+					// exact distance if it does not exceed bound, otherwise any value
+					// greater than bound that is not greater than the distance
+					virtual T calc_bounded(const MathVector<T>& first, const MathVector<T>& second, T bound)
+					{
+						return calc(first, second);
+					}
 				};
 
 
@@ -108,6 +115,108 @@ namespace MathCore
 
 						return std::pow(value, 0.5);
 					}
+
+					T calc_bounded(const MathVector<T>& first, const MathVector<T>& second, T bound)
+					{
+						typename MathVector<T>::const_fast_iterator firstBegin = first.const_fast_begin();
+						typename MathVector<T>::const_fast_iterator firstEnd   = first.const_fast_end();
+
+						typename MathVector<T>::const_fast_iterator secondBegin = second.const_fast_begin();
+						typename MathVector<T>::const_fast_iterator secondEnd   = second.const_fast_end();
+
+						T value       = 0.;
+						T squareBound = bound * bound;
+
+						while (firstBegin != firstEnd || secondBegin != secondEnd)
+						{
+							if (secondBegin == secondEnd || (firstBegin != firstEnd && firstBegin.index() < secondBegin.index()))
+							{
+								value += firstBegin.getElem() * firstBegin.getElem();
+								++firstBegin;
+							}
+							else if (firstBegin == firstEnd || firstBegin.index() > secondBegin.index())
+							{
+								value += secondBegin.getElem() * secondBegin.getElem();
+								++secondBegin;
+							}
+							else
+							{
+								T difference = firstBegin.getElem() - secondBegin.getElem();
+								value += difference * difference;
+								++firstBegin;
+								++secondBegin;
+							}
+
+							// the partial sum only grows, past the bound the rest is not needed
+							if (value > squareBound)
+								return sqrt(value);
+						}
+
+						return sqrt(value);
+					}
+				};
+
+				// cosine distance in its metric form sqrt(2 - 2 cos(a, b)), the
+				// euclidean distance between a / |a| and b / |b|. It orders
+				// neighbours as 1 - cos does, but it satisfies the triangle
+				// inequality the vp trees and pivot tables prune with. Zero
+				// vectors are at distance sqrt(2), as if orthogonal
+				template <typename T> class CosineNorm : public MathVectorNorm < T >
+				{
+				public:
+
+					CosineNorm()
+				    : MathVectorNorm<T>()
+					{
+
+					}
+
+					T calc(MathVector<T>& vector)
+					{
+						T norm = vector * vector;
+
+						return sqrt(norm);
+					}
+
+					T calc(const MathVector<T>& first, const MathVector<T>& second)
+					{
+						typename MathVector<T>::const_fast_iterator firstBegin = first.const_fast_begin();
+						typename MathVector<T>::const_fast_iterator firstEnd   = first.const_fast_end();
+
+						typename MathVector<T>::const_fast_iterator secondBegin = second.const_fast_begin();
+						typename MathVector<T>::const_fast_iterator secondEnd   = second.const_fast_end();
+
+						T dot          = 0.;
+						T first_norm   = 0.;
+						T second_norm  = 0.;
+
+						while (firstBegin != firstEnd || secondBegin != secondEnd)
+						{
+							if (secondBegin == secondEnd || (firstBegin != firstEnd && firstBegin.index() < secondBegin.index()))
+							{
+								first_norm += firstBegin.getElem() * firstBegin.getElem();
+								++firstBegin;
+							}
+							else if (firstBegin == firstEnd || firstBegin.index() > secondBegin.index())
+							{
+								second_norm += secondBegin.getElem() * secondBegin.getElem();
+								++secondBegin;
+							}
+							else
+							{
+								dot         += firstBegin.getElem() * secondBegin.getElem();
+								first_norm  += firstBegin.getElem() * firstBegin.getElem();
+								second_norm += secondBegin.getElem() * secondBegin.getElem();
+								++firstBegin;
+								++secondBegin;
+							}
+						}
+
+						if (first_norm <= 0. || second_norm <= 0.)
+							return sqrt(T(2));
+
+						return sqrt(std::max(T(0), T(2) - T(2) * dot / sqrt(first_norm * second_norm)));
+					}
 				};
 			}
 		}
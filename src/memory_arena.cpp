@@ -0,0 +1,141 @@
+#include <atomic>
+#include <memory_resource>
+#include <new>
+#include <stdlib.h>
+
+#include "memory_arena.h"
+
+namespace Memory
+{
+	namespace
+	{
+		// constant initialised, so counted before any static constructor runs
+		std::atomic<bool>   statistics(false);
+		std::atomic<size_t> global_allocations(0);
+		std::atomic<size_t> global_deallocations(0);
+		std::atomic<size_t> global_bytes(0);
+
+		void* counted_allocate(size_t bytes, size_t alignment, bool nothrow)
+		{
+			if (bytes == 0)
+				bytes = 1;
+			// aligned_alloc wants a size multiple of the alignment
+			if (alignment > alignof(std::max_align_t))
+				bytes = (bytes + alignment - 1) / alignment * alignment;
+
+			void* pointer = nullptr;
+			while ((pointer = alignment > alignof(std::max_align_t) ? aligned_alloc(alignment, bytes) : malloc(bytes)) == nullptr)
+			{
+				std::new_handler handler = std::get_new_handler();
+				if (handler == nullptr)
+				{
+					if (nothrow)
+						return nullptr;
+					throw std::bad_alloc();
+				}
+				handler();
+			}
+
+			if (statistics.load(std::memory_order_relaxed))
+			{
+				global_allocations.fetch_add(1, std::memory_order_relaxed);
+				global_bytes.fetch_add(bytes, std::memory_order_relaxed);
+			}
+			return pointer;
+		}
+
+		void counted_deallocate(void* pointer)
+		{
+			if (pointer == nullptr)
+				return;
+			if (statistics.load(std::memory_order_relaxed))
+				global_deallocations.fetch_add(1, std::memory_order_relaxed);
+			free(pointer);
+		}
+	}
+
+	CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+	: m_upstream(upstream)
+	, m_allocations(0)
+	, m_deallocations(0)
+	, m_bytes(0)
+	{ }
+
+	void* CountingResource::do_allocate(size_t bytes, size_t alignment)
+	{
+		void* pointer = m_upstream->allocate(bytes, alignment);
+		m_allocations.fetch_add(1, std::memory_order_relaxed);
+		m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+		return pointer;
+	}
+
+	void CountingResource::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+	{
+		m_upstream->deallocate(pointer, bytes, alignment);
+		m_deallocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return this == &other;
+	}
+
+	CountingResource& heap()
+	{
+		// never destroyed, containers may be freed after main returns
+		static CountingResource* resource = new CountingResource();
+		return *resource;
+	}
+
+	void enable_statistics()
+	{
+		std::pmr::set_default_resource(&heap());
+		statistics.store(true);
+	}
+
+	bool statistics_enabled()
+	{
+		return statistics.load();
+	}
+
+	size_t heap_allocations()   { return global_allocations.load(std::memory_order_relaxed);}
+	size_t heap_deallocations() { return global_deallocations.load(std::memory_order_relaxed);}
+	size_t heap_bytes()         { return global_bytes.load(std::memory_order_relaxed);}
+
+	Arena::Arena(size_t block_size)
+	: m_resource(block_size, &heap())
+	{ }
+
+	Arena::Arena(void* buffer, size_t size)
+	: m_resource(buffer, size, &heap())
+	{ }
+
+	PoolArena::PoolArena()
+	: m_resource(&heap())
+	{ }
+}
+
+// every heap allocation of the program goes through these, polymorphic or
+// not, so the statistics also see std containers, strings and the per
+// thread scratch of the indexes
+void* operator new(size_t bytes) { return Memory::counted_allocate(bytes, 0, false);}
+void* operator new[](size_t bytes) { return Memory::counted_allocate(bytes, 0, false);}
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept { return Memory::counted_allocate(bytes, 0, true);}
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept { return Memory::counted_allocate(bytes, 0, true);}
+void* operator new(size_t bytes, std::align_val_t alignment) { return Memory::counted_allocate(bytes, (size_t)alignment, false);}
+void* operator new[](size_t bytes, std::align_val_t alignment) { return Memory::counted_allocate(bytes, (size_t)alignment, false);}
+void* operator new(size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Memory::counted_allocate(bytes, (size_t)alignment, true);}
+void* operator new[](size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Memory::counted_allocate(bytes, (size_t)alignment, true);}
+
+void operator delete(void* pointer) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete[](void* pointer) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete(void* pointer, size_t) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete[](void* pointer, size_t) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete(void* pointer, std::align_val_t) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete[](void* pointer, std::align_val_t) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Memory::counted_deallocate(pointer);}
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { Memory::counted_deallocate(pointer);}
@@ -0,0 +1,109 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+namespace Memory
+{
+	// Passes allocations to an upstream resource and counts them. The
+	// counters are atomic, the resource is thread safe if its upstream is.
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+		size_t allocations()   const { return m_allocations.load(std::memory_order_relaxed);};
+		size_t deallocations() const { return m_deallocations.load(std::memory_order_relaxed);};
+		size_t bytes()         const { return m_bytes.load(std::memory_order_relaxed);};
+
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment);
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment);
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept;
+
+	private:
+		std::pmr::memory_resource* m_upstream;
+		std::atomic<size_t>        m_allocations;
+		std::atomic<size_t>        m_deallocations;
+		std::atomic<size_t>        m_bytes;
+	};
+
+	// The heap as polymorphic containers see it: every arena takes its
+	// blocks from it, and once statistics are enabled it is also the
+	// default resource. Only polymorphic allocations are counted here, the
+	// whole program is counted by heap_allocations().
+	CountingResource& heap();
+
+	// makes heap() the default resource and starts counting every global
+	// operator new and delete; call it before the data are read
+	void enable_statistics();
+	bool statistics_enabled();
+
+	// allocations of the whole program through the global operator new
+	// since the statistics were enabled, std and polymorphic containers alike
+	size_t heap_allocations();
+	size_t heap_deallocations();
+	size_t heap_bytes();
+
+	// Monotonic arena for the temporaries of one fold, tree or query, e.g.
+	// the predictions and neighbour lists of a fold check.
+	// An allocation bumps a pointer in the current block, a deallocation
+	// does nothing, and all blocks go back to the heap at once when the
+	// arena is destroyed. The first block may be a buffer of the caller,
+	// e.g. on the stack, so a small query makes no heap allocation at all
+	// when its temporaries fit in it.
+	// An arena is not thread safe, and containers allocated from it must
+	// not outlive it.
+	class Arena
+	{
+	public:
+		static const size_t default_block_size = 64 * 1024;
+
+		explicit Arena(size_t block_size = default_block_size);
+		Arena(void* buffer, size_t size);
+
+		std::pmr::memory_resource* resource() { return &m_resource;};
+
+		// gives the blocks back to the heap, the caller buffer is reused
+		void release() { m_resource.release();};
+
+	private:
+		std::pmr::monotonic_buffer_resource m_resource;
+	};
+
+	// Arena that recycles what is freed: deallocated blocks are kept in
+	// pools by size and reused by the next allocations of that size. It
+	// suits temporaries replaced many times over its scope, such as the
+	// object lists and histograms of the nodes of one tree. Not thread safe.
+	class PoolArena
+	{
+	public:
+		PoolArena();
+
+		std::pmr::memory_resource* resource() { return &m_resource;};
+
+	private:
+		std::pmr::unsynchronized_pool_resource m_resource;
+	};
+
+	// heap allocations made since the scope was opened, by all threads
+	class AllocationScope
+	{
+	public:
+		AllocationScope()
+		: m_allocations(heap_allocations())
+		, m_bytes(heap_bytes())
+		{ }
+
+		size_t allocations() const { return heap_allocations() - m_allocations;};
+		size_t bytes()       const { return heap_bytes() - m_bytes;};
+
+	private:
+		size_t m_allocations;
+		size_t m_bytes;
+	};
+}
+
+#endif //MEMORY_ARENA_H
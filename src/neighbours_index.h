@@ -0,0 +1,81 @@
+#ifndef NEIGHBOURS_INDEX_H
+#define NEIGHBOURS_INDEX_H
+
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "instance.h"
+#include "mathvector.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MachineLearning;
+
+namespace DataStructures
+{
+	// Nearest neighbours search backend of KNearestNeighbours. An index is
+	// built once over the learn objects and is then queried concurrently:
+	// search and search_batch are const and keep no per-query state.
+	class NeighboursIndex
+	{
+	public:
+		struct Neighbour
+		{
+			double distance;
+			size_t index;
+
+			bool operator<(const Neighbour& other) const
+			{
+				return distance < other.distance;
+			}
+		};
+
+	public:
+		virtual ~NeighboursIndex() {}
+
+		virtual void build(const std::vector<Instance>& items) = 0;
+
+		// k nearest items to target sorted by distance; index is the position
+		// of the item in the vector given to build
+		virtual void search( const MathVector<double>& target
+						   , size_t k
+						   , std::vector<Neighbour>& neighbours) const = 0;
+
+		// neighbours of the i-th target are neighbours[i * k, i * k + counts[i]),
+		// both are grown only here and with their own memory resource, e.g.
+		// the arena of a fold
+		virtual void search_batch( const std::vector<Instance>& targets
+								 , size_t k
+								 , std::pmr::vector<Neighbour>& neighbours
+								 , std::pmr::vector<size_t>& counts) const
+		{
+			neighbours.assign(targets.size() * k, Neighbour{0.0, 0});
+			counts.assign(targets.size(), 0);
+#pragma omp parallel
+			{
+				std::vector<Neighbour> found;
+#pragma omp for schedule(dynamic, 16)
+				for (size_t index = 0; index < targets.size(); ++index)
+				{
+					search(targets[index].getFeatures(), k, found);
+					std::copy(found.begin(), found.end(), neighbours.begin() + index * k);
+					counts[index] = found.size();
+				}
+			}
+		}
+
+		// an exact index returns the true k nearest items, kNN measures the
+		// recall of one that is not
+		virtual bool exact() const { return true; }
+
+		virtual size_t size() const = 0;
+		virtual std::string name() const = 0;
+		virtual NeighboursIndex* clone() const = 0;
+	};
+
+	typedef std::shared_ptr<NeighboursIndex> NeighboursIndexPtr;
+}
+
+#endif //NEIGHBOURS_INDEX_H
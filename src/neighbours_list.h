@@ -0,0 +1,110 @@
+#ifndef NEIGHBOURS_LIST_H
+#define NEIGHBOURS_LIST_H
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+
+namespace MachineLearning
+{
+	// Nearest neighbours of every object truncated to the max_count closest
+	// ones. All lists live in one contiguous array of objects_count * max_count
+	// entries; while filled a list is a max-heap by distance, finish() sorts
+	// it by distance ascending.
+	class NeighboursList
+	{
+	public:
+		struct Neighbour
+		{
+			double   distance;
+			uint32_t index;
+			float    goal;
+
+			bool operator<(const Neighbour& other) const
+			{
+				return distance < other.distance || (distance == other.distance && index < other.index);
+			}
+		};
+
+	public:
+		NeighboursList() : m_max_count(0) {}
+
+		void reset(size_t objects_count, size_t max_count)
+		{
+			m_max_count = max_count;
+			m_counts.assign(objects_count, 0);
+			m_neighbours.assign(objects_count * max_count, Neighbour{0.0, 0, 0.0f});
+		}
+
+		void clear()
+		{
+			m_max_count = 0;
+			std::vector<size_t>().swap(m_counts);
+			std::vector<Neighbour>().swap(m_neighbours);
+		}
+
+		size_t objects_count() const { return m_counts.size();};
+		size_t max_count()     const { return m_max_count;};
+		size_t count(size_t object) const { return m_counts[object];};
+
+		const Neighbour* begin(size_t object) const { return m_neighbours.data() + object * m_max_count;};
+		const Neighbour* end(size_t object)   const { return begin(object) + m_counts[object];};
+		const Neighbour& at(size_t object, size_t position) const { return begin(object)[position];};
+
+		// distance a candidate has to beat to enter the full list of the object
+		double radius(size_t object) const
+		{
+			if (m_counts[object] < m_max_count)
+				return std::numeric_limits<double>::max();
+			return m_neighbours[object * m_max_count].distance;
+		}
+
+		// keeps the candidate if it is closer than the farthest kept neighbour,
+		// lists of different objects may be filled concurrently
+		void offer(size_t object, const Neighbour& candidate)
+		{
+			if (m_max_count == 0)
+				return;
+
+			Neighbour* row = m_neighbours.data() + object * m_max_count;
+			size_t& count = m_counts[object];
+			if (count < m_max_count)
+			{
+				row[count++] = candidate;
+				std::push_heap(row, row + count);
+			}
+			else if (candidate < row[0])
+			{
+				std::pop_heap(row, row + count);
+				row[count - 1] = candidate;
+				std::push_heap(row, row + count);
+			}
+		}
+
+		void finish(size_t object)
+		{
+			Neighbour* row = m_neighbours.data() + object * m_max_count;
+			std::sort_heap(row, row + m_counts[object]);
+		}
+
+		// distance from the object to other if other is in its list, negative otherwise
+		double find_distance(size_t object, size_t other) const
+		{
+			for (const Neighbour* it = begin(object); it != end(object); ++it)
+			{
+				if (it->index == other)
+					return it->distance;
+			}
+
+			return -1.0;
+		}
+
+	private:
+		size_t                 m_max_count;
+		std::vector<size_t>    m_counts;
+		std::vector<Neighbour> m_neighbours;
+	};
+}
+
+#endif //NEIGHBOURS_LIST_H
@@ -0,0 +1,80 @@
+#ifndef PIVOT_TABLE_H
+#define PIVOT_TABLE_H
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <math.h>
+
+namespace DataStructures
+{
+	// LAESA pivot table: distances from every item to a few pivot items.
+	// By the triangle inequality max over pivots of |d(a, p) - d(b, p)| is a
+	// lower bound of d(a, b), so a candidate whose bound already exceeds the
+	// search radius is rejected without computing its distance.
+	class PivotTable
+	{
+	public:
+		typedef std::function<double(size_t first, size_t second)> distance_t;
+
+	public:
+		PivotTable() {}
+
+		// the first pivot is item 0, every next one is the item farthest in
+		// sum from the pivots already chosen
+		void build(size_t items_count, size_t pivots_count, const distance_t& distance)
+		{
+			pivots_count = std::min(pivots_count, items_count);
+			m_pivots.clear();
+			m_distances.assign(items_count * pivots_count, 0.0);
+			if (pivots_count == 0)
+				return;
+
+			std::vector<double> distances_sums(items_count, 0.0);
+			std::vector<bool> is_pivot(items_count, false);
+			size_t pivot = 0;
+			for (size_t pivot_index = 0; pivot_index < pivots_count; ++pivot_index)
+			{
+				m_pivots.push_back(pivot);
+				is_pivot[pivot] = true;
+#pragma omp parallel for schedule(dynamic, 256)
+				for (size_t item = 0; item < items_count; ++item)
+				{
+					double dist = item == pivot ? 0.0 : distance(item, pivot);
+					m_distances[item * pivots_count + pivot_index] = dist;
+					distances_sums[item] += dist;
+				}
+
+				double farthest = -1.0;
+				for (size_t item = 0; item < items_count; ++item)
+				{
+					if (!is_pivot[item] && distances_sums[item] > farthest)
+					{
+						farthest = distances_sums[item];
+						pivot = item;
+					}
+				}
+			}
+		}
+
+		size_t pivots_count() const { return m_pivots.size();};
+		size_t pivot(size_t index) const { return m_pivots[index];};
+		const double* distances(size_t item) const { return m_distances.data() + item * m_pivots.size();};
+
+		double lower_bound(const double* target_distances, size_t item) const
+		{
+			const double* item_distances = distances(item);
+			double bound = 0.0;
+			for (size_t index = 0; index < m_pivots.size(); ++index)
+				bound = std::max(bound, fabs(target_distances[index] - item_distances[index]));
+			return bound;
+		}
+
+	private:
+		std::vector<size_t> m_pivots;
+		// row of an item holds its distances to all pivots
+		std::vector<double> m_distances;
+	};
+}
+
+#endif //PIVOT_TABLE_H
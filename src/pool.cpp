@@ -35,7 +35,7 @@ size_t Pool::getInstanceCount()
 }
 
 Pool::Pool (std::vector<Instance> _instances)
-		: instances(_instances)
+		: instances(std::move(_instances))
 {
 	
 }
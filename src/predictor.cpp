@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <iostream>
 #include <vector>
 #include <math.h>
 
@@ -9,6 +11,8 @@
 #include "predictor.h"
 #endif
 
+#include "mathmatrix_sparse.h"
+
 using namespace MachineLearning;
 
 std::vector<double> Predictor::rmse(std::vector<Instance>& instances)
@@ -52,14 +56,14 @@ std::vector<double> Predictor::rmse(std::vector<Instance>& instances)
 
 	sumSquaredError /= instances.size();
 
-	std::vector<double>* characteristics = new std::vector<double>();
-	characteristics->push_back(std::pow(sumSquaredError, 0.5));
-	characteristics->push_back(true_positive);
-	characteristics->push_back(false_positive);
-	characteristics->push_back(true_negative);
-	characteristics->push_back(false_negative);
+	std::vector<double> characteristics;
+	characteristics.push_back(std::pow(sumSquaredError, 0.5));
+	characteristics.push_back(true_positive);
+	characteristics.push_back(false_positive);
+	characteristics.push_back(true_negative);
+	characteristics.push_back(false_negative);
 
-	return *characteristics;
+	return characteristics;
 }
 
 double Predictor::predict(MathVector<double>& features)
@@ -74,24 +78,98 @@ void Predictor::learn( std::vector<Instance>& learnSet
 	return;
 }
 
-std::vector<double> Predictor::test(std::vector<Instance>& learnSet, std::vector<Metrics::Metric>& metrics)
+void Predictor::predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions)
 {
-	std::vector<double>* results = new std::vector<double>();
+	predictions.resize(objects.size());
+
+	std::vector<const MathVector<double>*> weights;
+	if (this->linear_weights(weights) > 0)
+	{
+		DenseMatrix<double> products;
+		linear_products(objects, weights, products);
+#pragma omp parallel for schedule(static)
+		for (size_t index = 0; index < objects.size(); index++)
+		{
+			predictions[index] = this->predict_scores(products.row(index));
+		}
+		return;
+	}
+
+#pragma omp parallel for schedule(dynamic, 256)
+	for (size_t index = 0; index < objects.size(); index++)
+	{
+		predictions[index] = this->predict(objects[index].getFeatures());
+	}
+}
+
+size_t Predictor::linear_weights(std::vector<const MathVector<double>*>& weights)
+{
+	return 0;
+}
+
+double Predictor::predict_scores(const double* products)
+{
+	return 0;
+}
+
+void Predictor::linear_products( std::vector<Instance>& objects
+							   , const std::vector<const MathVector<double>*>& weights
+							   , DenseMatrix<double>& products)
+{
+	size_t features_count = 0;
+	for (const MathVector<double>* weight: weights)
+	{
+		for (MathVector<double>::const_fast_iterator it = weight->const_fast_begin(); it != weight->const_fast_end(); ++it)
+			features_count = std::max(features_count, it.index() + 1);
+	}
+
+	// weight vectors are the columns of a dense features x weights matrix,
+	// features out of it have zero weight and are dropped from the objects
+	DenseMatrix<double> weights_matrix(features_count, weights.size());
+	for (size_t column = 0; column < weights.size(); ++column)
+	{
+		for (MathVector<double>::const_fast_iterator it = weights[column]->const_fast_begin(); it != weights[column]->const_fast_end(); ++it)
+			weights_matrix(it.index(), column) = it.getElem();
+	}
+
+	SparseMatrix<double> objects_matrix;
+	objects_matrix.assign(objects.size(), features_count, [&objects](size_t index) -> const MathVector<double>& { return objects[index].getFeatures();});
+
+	if (weights.size() == 1)
+	{
+		std::vector<double> weight(features_count);
+		for (size_t feature = 0; feature < features_count; ++feature)
+			weight[feature] = weights_matrix(feature, 0);
+		std::vector<double> scores(objects.size());
+		MatrixAlgorithm::spmv(objects_matrix, weight.data(), scores.data());
+
+		products = DenseMatrix<double>(objects.size(), 1);
+		for (size_t index = 0; index < objects.size(); ++index)
+			products(index, 0) = scores[index];
+		return;
+	}
+
+	MatrixAlgorithm::spmm(objects_matrix, weights_matrix, products);
+}
+
+std::vector<double> Predictor::test(std::vector<Instance>& learnSet, std::vector<Metrics::Metric>& metrics, std::pmr::memory_resource* resource)
+{
+	std::vector<double> results;
 	double sumSquaredError = 0.;
 
 	double true_positive = 0.;
 	double false_positive = 0.;
 	double true_negative = 0.;
 	double false_negative = 0.;
-	
-	size_t total_count = 0;
-	size_t part = 1e4;
+
+	std::pmr::vector<double> predictions(resource);
+	this->predict_batch(learnSet, predictions);
 
 #pragma omp parallel for reduction (+:true_positive,false_positive,true_negative,false_negative,sumSquaredError)
 	for (size_t index = 0; index < learnSet.size(); index++)
 	{
 
-		double prediction = this->predict(learnSet.at(index).getFeatures());
+		double prediction = predictions[index];
 		double sse = std::pow(prediction - learnSet.at(index).getGoal(), 2);
 		sumSquaredError = sumSquaredError + sse;
 
@@ -117,30 +195,51 @@ std::vector<double> Predictor::test(std::vector<Instance>& learnSet, std::vector
 				false_negative = false_negative + 1;
 			}
 		}
-
-#pragma omp atomic
-		total_count++;
-#pragma omp atomic
-		if (total_count % part == 0)
-			std::cout << "processed " << total_count << " objects" << std::endl;
 	}
 
+	if (!this->quiet())
+		std::cout << "processed " << learnSet.size() << " objects" << std::endl;
+
     sumSquaredError /= learnSet.size();
-	results->clear();
 
 	for (size_t index = 0; index < metrics.size(); index++)
 	{
 		double result = metrics.at(index)(true_positive, false_positive, true_negative, false_negative);
 
-		results->push_back(result);
+		results.push_back(result);
 	}
 
-    results->push_back(sumSquaredError);
+    results.push_back(sumSquaredError);
+
+	return results;
+}
+
+
+
+void Predictor::prepare_folds(std::vector<Instance>& objects, const std::vector<std::vector<size_t>>& learn_indexes)
+{
+	return;
+}
+
+void Predictor::select_objects(const std::vector<size_t>& indexes)
+{
+	return;
+}
 
-	return *results;
+void Predictor::finish_folds()
+{
+	return;
 }
 
+void Predictor::set_seed(unsigned int seed)
+{
+	return;
+}
 
+void Predictor::set_quiet(bool quiet)
+{
+	return;
+}
 
 size_t Predictor::getFeaturesCount()
 {
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <memory>
+#include <memory_resource>
 
 #ifndef INSTANCE_H
 #include "instance.h"
@@ -12,6 +13,10 @@
 #include "metric.h"
 #endif
 
+#include "mathmatrix_dense.h"
+
+using namespace MathCore::AlgebraCore::MatrixCore;
+
 namespace MachineLearning
 {
 	class Predictor
@@ -29,20 +34,64 @@ namespace MachineLearning
 
 
 			virtual double predict(MathVector<double>& features);
+			// predicts every object. The default scores a linear predictor by
+			// one sparse product over all objects, otherwise it splits objects
+			// between threads and calls predict for each of them. Temporaries
+			// of an override are allocated with the resource of predictions
+			virtual void predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions);
+
+			// A linear predictor sees an object only through a few products
+			// w * x. linear_weights appends its weight vectors, which live as
+			// long as the predictor, and returns their count, 0 when it is not
+			// linear. predict_scores maps the products of an object, in the
+			// same order, to its prediction.
+			virtual size_t linear_weights(std::vector<const MathVector<double>*>& weights);
+			virtual double predict_scores(const double* products);
 
 			virtual void learn( std::vector<Instance>& learnSet
 					          , std::vector<double>& objectsWeights
 					          , std::vector<std::pair<double, double>>& learning_curve);
-			virtual std::vector<double> test(std::vector<Instance>& testSet, std::vector<Metrics::Metric>& metrics);
+			// the predictions and the temporaries of predict_batch are taken
+			// from the resource, cross validation gives the arena of the fold
+			virtual std::vector<double> test( std::vector<Instance>& testSet
+											, std::vector<Metrics::Metric>& metrics
+											, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+			// cross validation hooks, the defaults do nothing. prepare_folds is
+			// called once with all objects of the pool and the pool positions
+			// of the learn objects of every fold, select_objects tells that the
+			// objects of the next learn, test or predict_batch calls are the
+			// pool objects at these positions (empty when they are not pool
+			// objects), finish_folds is called after the last fold
+			virtual void prepare_folds(std::vector<Instance>& objects, const std::vector<std::vector<size_t>>& learn_indexes);
+			virtual void select_objects(const std::vector<size_t>& indexes);
+			virtual void finish_folds();
+
+			// set_seed seeds the random choices of learn, e.g. the sampled
+			// features, 0 keeps them random. set_quiet turns off the progress
+			// and test output of learners run concurrently. The defaults do
+			// nothing and a predictor is never quiet
+			virtual void set_seed(unsigned int seed);
+			virtual void set_quiet(bool quiet);
+			virtual bool quiet() const { return false;};
 
 			size_t getFeaturesCount();
 			virtual size_t get_model_complexity() = 0;
 
 			virtual Predictor* clone() const = 0;
+
+			// whether learn takes objectsWeights into account; a sample for a
+			// learner that does not must be given as a set of objects
+			virtual bool uses_weights() const { return false;};
 		protected:
 
 			std::vector<double> rmse(std::vector<Instance>& instances);
 
+			// products of every object with every weight vector, a row per object
+			static void linear_products( std::vector<Instance>& objects
+									   , const std::vector<const MathVector<double>*>& weights
+									   , DenseMatrix<double>& products);
+
 	};
 
 	typedef std::shared_ptr<Predictor> PredictorPtr;
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <omp.h>
+
+#include "random_forest.h"
+
+#include "predictor.h"
+#include "instance.h"
+#include "metric.h"
+#include "sampling.h"
+
+#include "mathvector.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+
+namespace MachineLearning
+{
+	RandomForest::RandomForest( size_t       _featuresCount
+							  , PredictorPtr tree_type
+							  , size_t       trees_count
+							  , size_t       threads_count
+							  , BaggingType  bagging_type
+							  , unsigned int bagging_seed)
+	: Predictor(_featuresCount)
+	, m_tree_type(tree_type)
+	, m_trees_count(trees_count)
+	, m_threads_count(threads_count)
+	, m_bagging_type(bagging_type)
+	, m_bagging_seed(bagging_seed)
+	{ }
+
+	int RandomForest::threads() const
+	{
+		return m_threads_count > 0 ? (int)m_threads_count : omp_get_max_threads();
+	}
+
+	double RandomForest::predict(MathVector<double>& features)
+	{
+		double votes = 0.0;
+		for (size_t index = 0; index < m_trees.size(); ++index)
+			votes += m_trees[index]->predict(features);
+
+		return votes > 0.0 ? 1.0 : -1.0;
+	}
+
+	void RandomForest::predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions)
+	{
+		predictions.assign(objects.size(), 0.0);
+		size_t blocks_count = (objects.size() + predict_block_size - 1) / predict_block_size;
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads())
+		for (size_t block = 0; block < blocks_count; ++block)
+		{
+			size_t begin = block * predict_block_size;
+			size_t end   = std::min(objects.size(), begin + predict_block_size);
+			for (size_t index = 0; index < m_trees.size(); ++index)
+			{
+				for (size_t obj_index = begin; obj_index < end; ++obj_index)
+					predictions[obj_index] += m_trees[index]->predict(objects[obj_index].getFeatures());
+			}
+			for (size_t obj_index = begin; obj_index < end; ++obj_index)
+				predictions[obj_index] = predictions[obj_index] > 0.0 ? 1.0 : -1.0;
+		}
+	}
+
+	void RandomForest::learn( std::vector<Instance>& learnSet
+							, std::vector<double>& objectsWeights
+							, std::vector<std::pair<double, double>>& learning_curve)
+	{
+		m_trees.clear();
+		m_trees.resize(m_trees_count);
+
+		std::random_device rd;
+		unsigned int base_seed = m_bagging_seed > 0 ? m_bagging_seed : rd();
+
+		std::cout << "train forest of " << m_trees_count << " trees on " << threads() << " threads" << std::endl;
+#pragma omp parallel for schedule(dynamic) num_threads(threads())
+		for (size_t tree_index = 0; tree_index < m_trees_count; ++tree_index)
+		{
+			std::vector<double> multiplicities;
+			sample_multiplicities( m_bagging_type
+								 , objectsWeights
+								 , learnSet.size()
+								 , 1.0
+								 , base_seed
+								 , (unsigned int)tree_index
+								 , multiplicities);
+
+			// the split features of a tree depend on the seed and its index only
+			std::seed_seq sequence {base_seed, (unsigned int)tree_index, 1u};
+			std::mt19937 tree_generator(sequence);
+
+			std::vector<std::pair<double, double>> tree_curve;
+			PredictorPtr tree(m_tree_type->clone());
+			tree->set_seed(std::uniform_int_distribution<unsigned int>(1)(tree_generator));
+			tree->set_quiet(true);
+			tree->learn(learnSet, multiplicities, tree_curve);
+			m_trees[tree_index] = tree;
+		}
+
+		std::cout << "learning finished"  << std::endl
+		          << "\t     trees count: " << m_trees.size()         << std::endl
+				  << "\tmodel complexity: " << get_model_complexity() << std::endl;
+	}
+
+	size_t RandomForest::get_model_complexity()
+	{
+		size_t model_complexity = 0;
+		for (const PredictorPtr& tree: m_trees)
+		{
+			model_complexity += tree->get_model_complexity();
+		}
+
+		return model_complexity;
+	}
+}
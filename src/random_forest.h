@@ -0,0 +1,62 @@
+#ifndef RANDOM_FOREST_H
+#define RANDOM_FOREST_H
+
+#include <vector>
+#include <memory>
+
+#include "predictor.h"
+#include "instance.h"
+#include "metric.h"
+#include "sampling.h"
+
+#include "mathvector.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+
+namespace MachineLearning
+{
+	// Bagged ensemble of decision trees. Every tree is learned on its own
+	// bootstrap sample, given as integer multiplicities of the learn objects,
+	// so the features are shared by all trees and a tree keeps only the
+	// objects drawn at least once. Feature subsampling at each split is
+	// configured on the weak predicate of the tree prototype and seeded from
+	// the bagging seed, so a forest with a bagging seed is reproducible.
+	class RandomForest : public Predictor
+	{
+	public:
+		RandomForest( size_t       _featuresCount
+					, PredictorPtr tree_type
+					, size_t       trees_count   = 100
+					, size_t       threads_count = 0
+					, BaggingType  bagging_type  = BaggingType::MULTINOMIAL
+					, unsigned int bagging_seed  = 0);
+
+		double predict(MathVector<double>& features);
+		// blocks of objects are shared between threads, a block is voted
+		// on tree by tree so a tree is walked for many objects in turn
+		void predict_batch(std::vector<Instance>& objects, std::pmr::vector<double>& predictions);
+		void learn( std::vector<Instance>& learnSet
+				  , std::vector<double>& objectsWeights
+				  , std::vector<std::pair<double, double>>& learning_curve);
+
+		size_t get_model_complexity();
+
+		Predictor* clone() const { return new RandomForest(*this);};
+		bool uses_weights() const { return true;};
+
+	private:
+		static const size_t predict_block_size = 256;
+
+		int threads() const;
+
+	private:
+		std::vector<PredictorPtr> m_trees;
+		PredictorPtr              m_tree_type;
+		size_t                    m_trees_count;
+		size_t                    m_threads_count;
+		BaggingType               m_bagging_type;
+		unsigned int              m_bagging_seed;
+	};
+}
+
+#endif //RANDOM_FOREST_H
@@ -0,0 +1,78 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <algorithm>
+#include <vector>
+#include <numeric>
+#include <random>
+
+namespace MachineLearning
+{
+	enum class BaggingType { MULTINOMIAL, POISSON };
+
+	// Bootstrap sample given as integer multiplicities of the objects, so a
+	// learner gets the original learn set with multiplicities as weights.
+	// Probabilities are proportional to the given weights (uniform if empty),
+	// bagging_factor * objects_count objects are drawn on average.
+	// Multinomial draws exactly that many objects one by one. Poisson draws
+	// every multiplicity independently, objects are split into fixed blocks
+	// each with its own generator seeded by (seed, stream, block), so the
+	// sample does not depend on the count of threads.
+	inline void sample_multiplicities( BaggingType                type
+									 , const std::vector<double>& probabilities
+									 , size_t                     objects_count
+									 , double                     bagging_factor
+									 , unsigned int               seed
+									 , unsigned int               stream
+									 , std::vector<double>&       multiplicities)
+	{
+		const size_t block_size = 4096;
+		multiplicities.assign(objects_count, 0.0);
+		if (objects_count == 0)
+			return;
+
+		double total = probabilities.empty() ? (double)objects_count
+		                                     : std::accumulate(probabilities.begin(), probabilities.end(), 0.0);
+		double draws = bagging_factor * objects_count;
+		if (total <= 0.0)
+			return;
+
+		if (type == BaggingType::POISSON)
+		{
+			size_t blocks_count = (objects_count + block_size - 1) / block_size;
+#pragma omp parallel for
+			for (size_t block = 0; block < blocks_count; ++block)
+			{
+				std::seed_seq sequence {seed, stream, (unsigned int)block};
+				std::mt19937 gen(sequence);
+				size_t end = std::min(objects_count, (block + 1) * block_size);
+				for (size_t index = block * block_size; index < end; ++index)
+				{
+					double rate = draws * (probabilities.empty() ? 1.0 : probabilities[index]) / total;
+					if (rate > 0.0)
+						multiplicities[index] = std::poisson_distribution<int>(rate)(gen);
+				}
+			}
+		}
+		else
+		{
+			std::seed_seq sequence {seed, stream};
+			std::mt19937 gen(sequence);
+			size_t draws_count = (size_t)draws;
+			if (probabilities.empty())
+			{
+				std::uniform_int_distribution<size_t> distribution(0, objects_count - 1);
+				for (size_t draw = 0; draw < draws_count; ++draw)
+					multiplicities[distribution(gen)] += 1.0;
+			}
+			else
+			{
+				std::discrete_distribution<size_t> distribution(probabilities.begin(), probabilities.end());
+				for (size_t draw = 0; draw < draws_count; ++draw)
+					multiplicities[distribution(gen)] += 1.0;
+			}
+		}
+	}
+}
+
+#endif //SAMPLING_H
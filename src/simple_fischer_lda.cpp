@@ -1,7 +1,11 @@
 #include <algorithm>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <numeric>
 #include <vector>
 #include <math.h>
+#include <omp.h>
 
 #include "simple_fischer_lda.h"
 
@@ -15,15 +19,33 @@
 #endif
 
 #include "mathmatrix.h"
+#include "mathmatrix_cholesky.h"
+#include "mathmatrix_conjugate_gradient.h"
+#include "mathmatrix_dense.h"
+#include "mathmatrix_randomized_svd.h"
 #include "mathvector.h"
-#include "mathvector_norm.h"
 
 using namespace MathCore::AlgebraCore::VectorCore;
-using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
 using namespace MathCore::AlgebraCore::MatrixCore;
 
 using namespace MachineLearning;
 
+// share of not null features above which x * x^T is summed densely
+static const double dense_covariation_density = 0.25;
+// power iterations of the randomized SVD of the low rank covariation
+static const size_t low_rank_power_iterations = 2;
+// relative residual and steps limit of the conjugate gradient alpha
+static const double cg_tolerance = 1e-8;
+static const size_t cg_max_iterations = 1000;
+
+static size_t features_size(std::vector<Instance>& objects)
+{
+	size_t features_count = 0;
+	for (Instance& instance: objects)
+		features_count = std::max(features_count, instance.getFeatures().getSize());
+	return features_count;
+}
+
 void SimpleFischerLDA::setFine(std::pair<double, double> _fine)
 {
 	this->fine = _fine;
@@ -37,6 +59,22 @@ double SimpleFischerLDA::predict(MathVector<double>& features)
 	return ((_prediction_positive - _prediction_negative ) > threshold) ? 1. : -1.;
 }
 
+size_t SimpleFischerLDA::linear_weights(std::vector<const MathVector<double>*>& weights)
+{
+	weights.push_back(&this->alpha_positive);
+	weights.push_back(&this->alpha_negative);
+
+	return 2;
+}
+
+double SimpleFischerLDA::predict_scores(const double* products)
+{
+	double _prediction_positive = products[0] + this->betta_positive + std::log(this->fine.first * this->prioriProbability.first);
+	double _prediction_negative = products[1] + this->betta_negative + std::log(this->fine.second * this->prioriProbability.second);
+
+	return ((_prediction_positive - _prediction_negative ) > threshold) ? 1. : -1.;
+}
+
 size_t SimpleFischerLDA::get_model_complexity()
 {
 	return 7 + alpha_positive.getSize() + alpha_negative.getSize();
@@ -46,164 +84,638 @@ void SimpleFischerLDA::learn( std::vector<Instance>& learnSet
 		                    , std::vector<double>& objectsWeights
 		                    , std::vector<std::pair<double, double>>& learning_curve)
 {
-	std::vector<MathVector<double>> *_features = new std::vector<MathVector<double>>();
-    _features->reserve(learnSet.size());
-    std::for_each(learnSet.begin(), learnSet.end(),
-                    [_features](Instance& instance)
-                    {
-                        _features->push_back(instance.getFeatures());
-                    });
+	if (covariation_type != DENSE)
+	{
+		this->learnFactored(learnSet);
+		return;
+	}
 
-	MathMatrix<double> learnF(*_features);
+	if (folds_statistics && selected_objects.size() == learnSet.size())
+	{
+		const FoldsStatistics& folds = *folds_statistics;
+		for (size_t fold = 0; fold < folds.learn_indexes.size(); ++fold)
+		{
+			if (folds.learn_indexes[fold] == selected_objects)
+			{
+				std::cout << "sufficient statistics are taken from the fold statistics" << std::endl;
+				this->learnStatistics(folds.statistics[fold]);
+				return;
+			}
+		}
+	}
 
-	std::vector<double> learnYValue(learnSet.begin(), learnSet.end());
+    std::cout << "calculating sufficient statistics" << std::endl;
+	std::vector<size_t> indexes(learnSet.size());
+	std::iota(indexes.begin(), indexes.end(), 0);
+	SufficientStatistics statistics;
+	this->sufficientStatistics(learnSet, indexes, features_size(learnSet), statistics);
+	this->learnStatistics(statistics);
 
-	MathVector<double> learnY(learnYValue);
+	return;
+}
 
-    std::cout << "sample means calculating" << std::endl;
-	MathMatrix<double> _sample_means = this->sampleMeans(*_features, learnY);
+void SimpleFischerLDA::learnStatistics(const SufficientStatistics& _statistics)
+{
+	size_t features_count = _statistics.scatter.rows();
+	double objects_count  = _statistics.counts[0] + _statistics.counts[1];
+	double regularizeValue = std::pow(10, -5);
+	double normalizing = objects_count - 2;
 
-	delete _features;
+	DenseMatrix<double> means = this->classMeans(_statistics.counts, _statistics.sums, features_count);
 
+	// (x - m)(x - m)^T summed over a class of n objects with the mean m is
+	// (x - c)(x - c)^T summed less n (m - c)(m - c)^T, the offsets m - c
+	// are small or null as the shift c is taken near the mean
     std::cout << "calculating covariation" << std::endl;
-    MathMatrix<double> _covariation_inverse;
-	this->covariation(learnF, learnY, _sample_means, _covariation_inverse);
-    std::cout << "inverse covariation" << std::endl;
-    _covariation_inverse = !_covariation_inverse;
-
-	MathMatrix<double> sampleMeans_positive(0, _sample_means[0].getSize());
-	MathMatrix<double> sampleMeans_negative(0, _sample_means[1].getSize());
-
-	sampleMeans_positive.push_back(_sample_means[0]);
-	sampleMeans_negative.push_back(_sample_means[1]);
-
-    MathMatrix<double> _alpha_negative;
-    MathMatrix<double> _alpha_positive;
-    std::cout << "calculating alpha positive" << std::endl;
-	_alpha_positive = _covariation_inverse * ~sampleMeans_positive;
-
-    std::cout << "calculating alpha negative" << std::endl;
-	_alpha_negative = _covariation_inverse * ~sampleMeans_negative;
+	DenseMatrix<double> offsets(2, features_count);
+	for (size_t class_index = 0; class_index < 2; ++class_index)
+	{
+		for (size_t feature = 0; feature < features_count; ++feature)
+			offsets(class_index, feature) = means(class_index, feature) - _statistics.shifts[class_index][feature];
+	}
 
-    std::cout << "calculating betta positive" << std::endl;
-	this->betta_positive = (-0.5) * (sampleMeans_positive * _alpha_positive).at(0,0);
+	DenseMatrix<double> covariation_factor(features_count, features_count);
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (size_t row_index = 0; row_index < features_count; ++row_index)
+	{
+		const double* scatter = _statistics.scatter.row(row_index);
+		double* row = covariation_factor.row(row_index);
+		for (size_t col_index = 0; col_index <= row_index; ++col_index)
+		{
+			double value = scatter[col_index];
+			for (size_t class_index = 0; class_index < 2; ++class_index)
+				value -= _statistics.counts[class_index] * offsets(class_index, row_index) * offsets(class_index, col_index);
+			row[col_index] = value / normalizing;
+		}
+		row[row_index] += regularizeValue;
+	}
 
-    std::cout << "calculating betta negative" << std::endl;
-	this->betta_negative = (-0.5) * (sampleMeans_negative * _alpha_negative).at(0,0);
+	// no inverse is formed: the covariation is factored once and both
+	// alpha = covariation^-1 * mean are solved as the columns of one system
+    std::cout << "cholesky decomposition of covariation" << std::endl;
+	MatrixAlgorithm::cholesky(covariation_factor);
 
-    this->alpha_positive = _alpha_positive.row(0);
-    this->alpha_negative = _alpha_negative.row(0);
+    std::cout << "calculating alpha" << std::endl;
+	DenseMatrix<double> alpha_columns = means.transpose();
+	MatrixAlgorithm::cholesky_solve(covariation_factor, alpha_columns);
 
-    std::cout << "Simple Fischer LDA parameters:" << std::endl
-              << "\t          treshold : " << threshold << std::endl
-              << "\tpriori probability : positive - " << prioriProbability.first << " negative - " << prioriProbability.second << std::endl
-              << "\t              fine : positive - " << fine.first << " negative - " << fine.second << std::endl
-              << "\t betta coefficient : positive - " << betta_positive << " negative - " << betta_negative << std::endl;
+	this->setParameters(means, alpha_columns.transpose());
 
 	return;
 }
 
-MathMatrix<double>& SimpleFischerLDA::sampleMeans(std::vector<MathVector<double>>& learnF, MathVector<double>& learnY)
+void SimpleFischerLDA::learnFactored(std::vector<Instance>& learnSet)
 {
-	double prioriProbability_positive = 0.;
-	double prioriProbability_negative = 0.;
-
-	double instances_positive = 0;
-	double instances_negative = 0;
+	size_t features_count = features_size(learnSet);
+	size_t objects_count  = learnSet.size();
+	double regularizeValue = std::pow(10, -5);
+	double normalizing = (double)objects_count - 2;
+
+	// learn objects as compressed rows, the products of the randomized
+	// SVD walk them many times
+    std::cout << "calculating class sums" << std::endl;
+	std::vector<size_t> offsets(1, 0);
+	std::vector<size_t> features_indexes;
+	std::vector<double> values;
+	std::vector<size_t> classes(objects_count);
+	double counts[2] = {0.0, 0.0};
+	std::vector<double> sums[2] = {std::vector<double>(features_count, 0.0), std::vector<double>(features_count, 0.0)};
+	std::vector<double> squares(features_count, 0.0);
+	for (size_t object = 0; object < objects_count; ++object)
+	{
+		size_t class_index = learnSet[object].getGoal() == 1 ? 0 : 1;
+		classes[object] = class_index;
+		counts[class_index] += 1.0;
+		const MathVector<double>& features = learnSet[object].getFeatures();
+		for (MathVector<double>::const_fast_iterator it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
+		{
+			if (it.index() >= features_count)
+				continue;
+			features_indexes.push_back(it.index());
+			values.push_back(it.getElem());
+			sums[class_index][it.index()] += it.getElem();
+			squares[it.index()] += it.getElem() * it.getElem();
+		}
+		offsets.push_back(features_indexes.size());
+	}
 
-	MathVector<double> _sample_means_positive(learnF.front());
+	DenseMatrix<double> means = this->classMeans(counts, sums, features_count);
 
-	MathVector<double> _sample_means_negative(learnF.front());
+	// variances around the class means, the diagonal of the covariation
+	std::vector<double> variances(features_count);
+	for (size_t feature = 0; feature < features_count; ++feature)
+	{
+		double value = squares[feature];
+		for (size_t class_index = 0; class_index < 2; ++class_index)
+			value -= sums[class_index][feature] * means(class_index, feature);
+		variances[feature] = std::max(value, 0.0) / normalizing;
+	}
 
-	for (size_t index = 1; index < learnF.size(); index++)
+	DenseMatrix<double> alpha_columns = means.transpose();
+	if (covariation_type == DIAGONAL)
 	{
-		if (learnY.getElement(index) == 1)
+	    std::cout << "calculating alpha with the diagonal covariation" << std::endl;
+		for (size_t feature = 0; feature < features_count; ++feature)
 		{
-			instances_positive++;
-			_sample_means_positive = _sample_means_positive + learnF.at(index);
+			for (size_t class_index = 0; class_index < 2; ++class_index)
+				alpha_columns(feature, class_index) /= variances[feature] + regularizeValue;
 		}
-		else
+		this->setParameters(means, alpha_columns.transpose());
+		return;
+	}
+
+	// the objects transposed, so that A^T * y is parallel over the features
+	std::vector<size_t> feature_offsets(features_count + 1, 0);
+	for (size_t feature: features_indexes)
+		++feature_offsets[feature + 1];
+	for (size_t feature = 0; feature < features_count; ++feature)
+		feature_offsets[feature + 1] += feature_offsets[feature];
+	std::vector<size_t> feature_objects(features_indexes.size());
+	std::vector<double> feature_values(features_indexes.size());
+	{
+		std::vector<size_t> positions(feature_offsets.begin(), feature_offsets.end() - 1);
+		for (size_t object = 0; object < objects_count; ++object)
 		{
-			instances_negative++;
-			_sample_means_negative = _sample_means_negative + learnF.at(index);
+			for (size_t position = offsets[object]; position < offsets[object + 1]; ++position)
+			{
+				size_t target = positions[features_indexes[position]]++;
+				feature_objects[target] = object;
+				feature_values[target]  = values[position];
+			}
 		}
 	}
 
-	prioriProbability_positive = instances_positive / learnF.size();
-	prioriProbability_negative = instances_negative / learnF.size();
+	// A is the objects less their class means, it is never formed:
+	// A * x = X * x - means of the objects * x
+	std::function<void(const DenseMatrix<double>&, DenseMatrix<double>&)> multiply =
+		[&](const DenseMatrix<double>& x, DenseMatrix<double>& y)
+		{
+			size_t columns = x.cols();
+			DenseMatrix<double> means_products;
+			MatrixAlgorithm::gemm(false, false, 1.0, means, x, 0.0, means_products);
+			#pragma omp parallel for schedule(dynamic, 256)
+			for (size_t object = 0; object < objects_count; ++object)
+			{
+				double* row = y.row(object);
+				const double* means_row = means_products.row(classes[object]);
+				for (size_t column = 0; column < columns; ++column)
+					row[column] = -means_row[column];
+				for (size_t position = offsets[object]; position < offsets[object + 1]; ++position)
+				{
+					const double* x_row = x.row(features_indexes[position]);
+					double value = values[position];
+					for (size_t column = 0; column < columns; ++column)
+						row[column] += value * x_row[column];
+				}
+			}
+		};
+	// A^T * y = X^T * y - means^T * (class sums of the rows of y)
+	std::function<void(const DenseMatrix<double>&, DenseMatrix<double>&)> multiply_transposed =
+		[&](const DenseMatrix<double>& x, DenseMatrix<double>& y)
+		{
+			size_t columns = x.cols();
+			DenseMatrix<double> class_sums(2, columns);
+			for (size_t object = 0; object < objects_count; ++object)
+			{
+				double* sums_row = class_sums.row(classes[object]);
+				const double* x_row = x.row(object);
+				for (size_t column = 0; column < columns; ++column)
+					sums_row[column] += x_row[column];
+			}
+			#pragma omp parallel for schedule(dynamic, 256)
+			for (size_t feature = 0; feature < features_count; ++feature)
+			{
+				double* row = y.row(feature);
+				for (size_t column = 0; column < columns; ++column)
+					row[column] = -means(0, feature) * class_sums(0, column) - means(1, feature) * class_sums(1, column);
+				for (size_t position = feature_offsets[feature]; position < feature_offsets[feature + 1]; ++position)
+				{
+					const double* x_row = x.row(feature_objects[position]);
+					double value = feature_values[position];
+					for (size_t column = 0; column < columns; ++column)
+						row[column] += value * x_row[column];
+				}
+			}
+		};
+
+	if (covariation_type == CONJUGATE_GRADIENT)
+	{
+		// covariation * v = A^T * (A * v) / (n - 2) + regularization * v,
+		// two passes over the objects and no d x d matrix
+		std::function<void(const DenseMatrix<double>&, DenseMatrix<double>&)> covariation =
+			[&](const DenseMatrix<double>& x, DenseMatrix<double>& y)
+			{
+				DenseMatrix<double> centred(objects_count, x.cols());
+				multiply(x, centred);
+				multiply_transposed(centred, y);
+				#pragma omp parallel for schedule(static)
+				for (size_t feature = 0; feature < features_count; ++feature)
+				{
+					for (size_t column = 0; column < x.cols(); ++column)
+						y(feature, column) = y(feature, column) / normalizing + regularizeValue * x(feature, column);
+				}
+			};
 
+		std::vector<double> diagonal(features_count);
+		DenseMatrix<double> solution(features_count, 2);
+		for (size_t feature = 0; feature < features_count; ++feature)
+		{
+			diagonal[feature] = variances[feature] + regularizeValue;
+			// the diagonal solution is the start
+			for (size_t class_index = 0; class_index < 2; ++class_index)
+				solution(feature, class_index) = alpha_columns(feature, class_index) / diagonal[feature];
+		}
 
-	prioriProbability = std::make_pair(prioriProbability_positive, prioriProbability_negative);
+	    std::cout << "calculating alpha by conjugate gradient" << std::endl;
+		size_t iterations = MatrixAlgorithm::conjugate_gradient(covariation, diagonal, alpha_columns, solution, cg_tolerance, cg_max_iterations);
+	    std::cout << "conjugate gradient iterations: " << iterations << std::endl;
 
-	_sample_means_positive /= instances_positive;
-	_sample_means_negative /= instances_negative;
+		this->setParameters(means, solution.transpose());
+		return;
+	}
+
+    std::cout << "randomized svd of rank " << covariation_rank << std::endl;
+	std::vector<double> singular_values;
+	DenseMatrix<double> vectors;
+	MatrixAlgorithm::randomized_svd( objects_count, features_count, covariation_rank, low_rank_power_iterations, 1
+								   , multiply, multiply_transposed, singular_values, vectors);
+	size_t rank = singular_values.size();
+
+	// sample covariation S is taken as V * L * V^T + R with the leading
+	// eigenvalues L and a diagonal R of what they leave of the variances
+	std::vector<double> eigenvalues(rank);
+	for (size_t index = 0; index < rank; ++index)
+		eigenvalues[index] = singular_values[index] * singular_values[index] / normalizing;
+	std::vector<double> residuals(features_count);
+	double trace = 0.0;
+	double squared_norm = 0.0;
+	for (size_t index = 0; index < rank; ++index)
+		squared_norm += eigenvalues[index] * eigenvalues[index];
+	for (size_t feature = 0; feature < features_count; ++feature)
+	{
+		double explained = 0.0;
+		const double* vector = vectors.row(feature);
+		for (size_t index = 0; index < rank; ++index)
+			explained += eigenvalues[index] * vector[index] * vector[index];
+		residuals[feature] = std::max(variances[feature] - explained, 0.0);
+		trace += variances[feature];
+		// |V L V^T + R|^2 = |L|^2 + 2 sum l_i v_i^T R v_i + |R|^2
+		squared_norm += 2.0 * residuals[feature] * explained + residuals[feature] * residuals[feature];
+	}
+
+	// sum over the objects of |x - m|^4
+	double means_squares[2] = {0.0, 0.0};
+	for (size_t class_index = 0; class_index < 2; ++class_index)
+	{
+		for (size_t feature = 0; feature < features_count; ++feature)
+			means_squares[class_index] += means(class_index, feature) * means(class_index, feature);
+	}
+	double fourth_moment = 0.0;
+	#pragma omp parallel for reduction(+:fourth_moment) schedule(dynamic, 256)
+	for (size_t object = 0; object < objects_count; ++object)
+	{
+		const double* mean = means.row(classes[object]);
+		double square = means_squares[classes[object]];
+		for (size_t position = offsets[object]; position < offsets[object + 1]; ++position)
+			square += values[position] * values[position] - 2.0 * values[position] * mean[features_indexes[position]];
+		fourth_moment += square * square;
+	}
+
+	// Ledoit-Wolf: S is shrunk to mu * I by rho = min(1, b^2 / d^2), where
+	// d^2 = |S - mu I|^2 and b^2 = sum over the objects of
+	// |x x^T - S|^2 / n^2 = (sum |x|^4 - (n - 4) |S|^2) / n^2 with S normalized by n - 2
+	double mu = trace / std::max<size_t>(features_count, 1);
+	double dispersion = squared_norm - mu * mu * features_count;
+	double deviation  = (fourth_moment - (objects_count - 4.0) * squared_norm) / ((double)objects_count * objects_count);
+	double shrinkage  = dispersion > 0 ? std::min(1.0, std::max(0.0, deviation / dispersion)) : 1.0;
+    std::cout << "Ledoit-Wolf shrinkage: " << shrinkage << std::endl;
+
+	// (1 - rho) S + rho mu I = W * W^T + D with W = V * sqrt((1 - rho) L)
+	// and the diagonal D = (1 - rho) R + rho mu
+	std::vector<double> diagonal(features_count);
+	DenseMatrix<double> factor(features_count, rank);
+	for (size_t feature = 0; feature < features_count; ++feature)
+	{
+		diagonal[feature] = (1.0 - shrinkage) * residuals[feature] + shrinkage * mu + regularizeValue;
+		for (size_t index = 0; index < rank; ++index)
+			factor(feature, index) = vectors(feature, index) * sqrt((1.0 - shrinkage) * eigenvalues[index]);
+	}
 
-	std::vector<MathVector<double>> sampleMeans;
-	sampleMeans.push_back(_sample_means_positive);
-	sampleMeans.push_back(_sample_means_negative);
-    EuclideanNorm<double> euclidean;
-	//this->fine = std::make_pair(instances_negative, instances_positive);
-    this->fine = std::make_pair(euclidean.calc(_sample_means_positive) * instances_negative, euclidean.calc(_sample_means_negative) * instances_positive);
+	// Woodbury: (W W^T + D)^-1 b = D^-1 b - D^-1 W (I + W^T D^-1 W)^-1 W^T D^-1 b
+    std::cout << "calculating alpha by the Woodbury identity" << std::endl;
+	DenseMatrix<double> scaled_factor(factor);
+	for (size_t feature = 0; feature < features_count; ++feature)
+	{
+		for (size_t index = 0; index < rank; ++index)
+			scaled_factor(feature, index) /= diagonal[feature];
+		for (size_t class_index = 0; class_index < 2; ++class_index)
+			alpha_columns(feature, class_index) /= diagonal[feature];
+	}
+	DenseMatrix<double> capacitance = DenseMatrix<double>::identity(rank);
+	MatrixAlgorithm::gemm(true, false, 1.0, factor, scaled_factor, 1.0, capacitance);
+	MatrixAlgorithm::cholesky(capacitance);
 
+	DenseMatrix<double> projections;
+	MatrixAlgorithm::gemm(true, false, 1.0, factor, alpha_columns, 0.0, projections);
+	MatrixAlgorithm::cholesky_solve(capacitance, projections);
+	MatrixAlgorithm::gemm(false, false, -1.0, scaled_factor, projections, 1.0, alpha_columns);
 
-	MathMatrix<double>* _values = new MathMatrix<double>(sampleMeans);
+	this->setParameters(means, alpha_columns.transpose());
 
-	return  *_values;
+	return;
 }
 
+DenseMatrix<double> SimpleFischerLDA::classMeans(const double* counts, const std::vector<double>* sums, size_t features_count)
+{
+    std::cout << "sample means calculating" << std::endl;
+	double objects_count = counts[0] + counts[1];
+	DenseMatrix<double> means(2, features_count);
+	double means_norms[2] = {0.0, 0.0};
+	for (size_t class_index = 0; class_index < 2; ++class_index)
+	{
+		double count = counts[class_index];
+		if (count <= 0)
+			continue;
+		for (size_t feature = 0; feature < features_count; ++feature)
+		{
+			means(class_index, feature) = sums[class_index][feature] / count;
+			means_norms[class_index] += means(class_index, feature) * means(class_index, feature);
+		}
+	}
+
+	this->prioriProbability = std::make_pair(counts[0] / objects_count, counts[1] / objects_count);
+	this->fine = std::make_pair(sqrt(means_norms[0]) * counts[1], sqrt(means_norms[1]) * counts[0]);
 
-void SimpleFischerLDA::covariation(MathMatrix<double>& learnSet, MathVector<double>& learnY, MathMatrix<double>& _sampleMeans, MathMatrix<double>& _covariations)
+	return means;
+}
+
+void SimpleFischerLDA::setParameters(const DenseMatrix<double>& means, const DenseMatrix<double>& alphas)
 {
-	std::vector<std::vector<double>>_covariations_values(learnSet.cols_size(), std::vector<double>(learnSet.cols_size(), 0.0));
-	size_t part = pow(10, 5);
-	size_t total_count = 0;
-	double regularizeValue = std::pow(10, -5);
-	double normalizing = (learnSet.rows_size() - 2);
-	#pragma omp parallel for
-	for (size_t index = 0; index < learnSet.rows_size(); index++)
+    std::cout << "calculating betta" << std::endl;
+	double positive_product = 0.0;
+	double negative_product = 0.0;
+	for (size_t index = 0; index < means.cols(); ++index)
 	{
-		MathVector<double> difference;
+		positive_product += means(0, index) * alphas(0, index);
+		negative_product += means(1, index) * alphas(1, index);
+	}
+	this->betta_positive = (-0.5) * positive_product;
+	this->betta_negative = (-0.5) * negative_product;
+
+    this->alpha_positive = alphas.row_vector(0);
+    this->alpha_negative = alphas.row_vector(1);
 
-		if (learnY.getElement(index) == 1)
+    std::cout << "Simple Fischer LDA parameters:" << std::endl
+              << "\t          treshold : " << threshold << std::endl
+              << "\tpriori probability : positive - " << prioriProbability.first << " negative - " << prioriProbability.second << std::endl
+              << "\t              fine : positive - " << fine.first << " negative - " << fine.second << std::endl
+              << "\t betta coefficient : positive - " << betta_positive << " negative - " << betta_negative << std::endl;
+}
+
+void SimpleFischerLDA::sufficientStatistics( std::vector<Instance>& objects
+										   , const std::vector<size_t>& indexes
+										   , size_t features_count
+										   , SufficientStatistics& _statistics
+										   , const std::vector<double>* shifts)
+{
+	size_t objects_count = indexes.size();
+	_statistics.scatter = DenseMatrix<double>(features_count, features_count);
+
+	double not_nulls = 0.0;
+	for (size_t class_index = 0; class_index < 2; ++class_index)
+	{
+		_statistics.counts[class_index] = 0.0;
+		_statistics.sums[class_index].assign(features_count, 0.0);
+	}
+	for (size_t index: indexes)
+	{
+		Instance& instance = objects[index];
+		size_t class_index = instance.getGoal() == 1 ? 0 : 1;
+		_statistics.counts[class_index] += 1.0;
+		const MathVector<double>& features = instance.getFeatures();
+		std::vector<double>& sums = _statistics.sums[class_index];
+		for (MathVector<double>::const_fast_iterator it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
 		{
-			difference = learnSet[index] - _sampleMeans[0];
+			if (it.index() < features_count)
+			{
+				sums[it.index()] += it.getElem();
+				not_nulls += 1.0;
+			}
 		}
+	}
+	double density = not_nulls / std::max(1.0, (double)objects_count * features_count);
+
+	for (size_t class_index = 0; class_index < 2; ++class_index)
+	{
+		if (shifts)
+			_statistics.shifts[class_index] = shifts[class_index];
 		else
 		{
-			difference = learnSet[index] - _sampleMeans[1];
+			double count = std::max(1.0, _statistics.counts[class_index]);
+			_statistics.shifts[class_index].resize(features_count);
+			for (size_t feature = 0; feature < features_count; ++feature)
+				_statistics.shifts[class_index][feature] = _statistics.sums[class_index][feature] / count;
 		}
+	}
 
-		#pragma omp parallel for
-		for (size_t out_index = 0; out_index < difference.getSize(); ++out_index)
+	if (density > dense_covariation_density)
+	{
+		// shifted objects are copied to a dense block and added to the
+		// lower triangle by syrk, a block at a time
+		const size_t block_objects = 256;
+		DenseMatrix<double> block(block_objects, features_count);
+		for (size_t first = 0; first < objects_count; first += block_objects)
 		{
-			const double out_value = difference.getElement(out_index);
-			#pragma omp parallel for private(out_value)
-			for (size_t inner_index = 0; inner_index < difference.getSize(); ++inner_index)
+			size_t count = std::min(block_objects, objects_count - first);
+			#pragma omp parallel for schedule(static)
+			for (size_t index = 0; index < count; ++index)
 			{
-				const double value = (difference.getElement(inner_index) * out_value) / normalizing;
-				#pragma omp atomic
-				_covariations_values[out_index][inner_index] += value;
-				if (out_index != inner_index)
+				const Instance& instance = objects[indexes[first + index]];
+				const std::vector<double>& shift = _statistics.shifts[instance.getGoal() == 1 ? 0 : 1];
+				double* row = block.row(index);
+				for (size_t feature = 0; feature < features_count; ++feature)
+					row[feature] = -shift[feature];
+				const MathVector<double>& features = instance.getFeatures();
+				for (MathVector<double>::const_fast_iterator it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
 				{
-					#pragma omp atomic
-					_covariations_values[inner_index][out_index] += value;
+					if (it.index() < features_count)
+						row[it.index()] += it.getElem();
 				}
 			}
-		}
 
-		#pragma omp atomic
-		total_count++;
-		#pragma omp atomic
-		if (total_count % part == 0)
-			std::cout << "processed objects: " << total_count << std::endl;
+			MatrixAlgorithm::syrk( true, features_count, count
+								 , 1.0, block.data(), block.stride()
+								 , 1.0, _statistics.scatter.data(), _statistics.scatter.stride());
+		}
 	}
-	
-	#pragma omp parallel for
-	for (size_t index = 0; index < learnSet.cols_size(); ++index)
+	else
 	{
-		_covariations_values[index][index] += regularizeValue;
+		// products of not null features only. Every thread fills its own
+		// packed upper triangle for a fixed range of objects, the triangles
+		// are added in order afterwards, so the result does not depend on
+		// timing.
+		size_t triangle_size = features_count * (features_count + 1) / 2;
+		int chunks_count = omp_get_max_threads();
+		std::vector<std::vector<double>> triangles(chunks_count);
+		#pragma omp parallel for schedule(static, 1)
+		for (int chunk = 0; chunk < chunks_count; ++chunk)
+		{
+			std::vector<double>& triangle = triangles[chunk];
+			triangle.assign(triangle_size, 0.0);
+			std::vector<size_t> features_indexes;
+			std::vector<double> values;
+			size_t chunk_first = objects_count * chunk / chunks_count;
+			size_t chunk_end   = objects_count * (chunk + 1) / chunks_count;
+			for (size_t object = chunk_first; object < chunk_end; ++object)
+			{
+				features_indexes.clear();
+				values.clear();
+				const MathVector<double>& features = objects[indexes[object]].getFeatures();
+				for (MathVector<double>::const_fast_iterator it = features.const_fast_begin(); it != features.const_fast_end(); ++it)
+				{
+					if (it.index() < features_count)
+					{
+						features_indexes.push_back(it.index());
+						values.push_back(it.getElem());
+					}
+				}
+
+				for (size_t first = 0; first < features_indexes.size(); ++first)
+				{
+					// row of the feature in the packed triangle, shifted to be indexed by the second feature
+					size_t feature = features_indexes[first];
+					double* row = triangle.data() + feature * features_count - feature * (feature + 1) / 2;
+					for (size_t second = first; second < features_indexes.size(); ++second)
+						row[features_indexes[second]] += values[first] * values[second];
+				}
+			}
+		}
+
+		// (x - c)(x - c)^T = x x^T - s c^T - c s^T + n c c^T summed over a
+		// class with the sum s of its n objects and its shift c
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (size_t row_index = 0; row_index < features_count; ++row_index)
+		{
+			double* row = _statistics.scatter.row(row_index);
+			for (size_t col_index = 0; col_index <= row_index; ++col_index)
+			{
+				size_t position = col_index * features_count - col_index * (col_index + 1) / 2 + row_index;
+				double value = 0.0;
+				for (int chunk = 0; chunk < chunks_count; ++chunk)
+					value += triangles[chunk][position];
+				for (size_t class_index = 0; class_index < 2; ++class_index)
+				{
+					const std::vector<double>& shift = _statistics.shifts[class_index];
+					const std::vector<double>& sums  = _statistics.sums[class_index];
+					value += _statistics.counts[class_index] * shift[row_index] * shift[col_index]
+						   - sums[row_index] * shift[col_index] - shift[row_index] * sums[col_index];
+				}
+				row[col_index] = value;
+			}
+		}
 	}
-	_covariations = MathMatrix<double>(_covariations_values);
 
 	return;
 }
+
+void SimpleFischerLDA::SufficientStatistics::subtract(const SufficientStatistics& other)
+{
+	size_t features_count = scatter.rows();
+	for (size_t class_index = 0; class_index < 2; ++class_index)
+	{
+		counts[class_index] -= other.counts[class_index];
+		for (size_t feature = 0; feature < features_count; ++feature)
+			sums[class_index][feature] -= other.sums[class_index][feature];
+	}
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (size_t row_index = 0; row_index < features_count; ++row_index)
+	{
+		double* row = scatter.row(row_index);
+		const double* other_row = other.scatter.row(row_index);
+		for (size_t col_index = 0; col_index <= row_index; ++col_index)
+			row[col_index] -= other_row[col_index];
+	}
+}
+
+void SimpleFischerLDA::prepare_folds(std::vector<Instance>& objects, const std::vector<std::vector<size_t>>& learn_indexes)
+{
+	folds_statistics.reset();
+	selected_objects.clear();
+	if (!fold_statistics || covariation_type != DENSE || objects.empty() || learn_indexes.empty())
+		return;
+
+	size_t folds_count = learn_indexes.size();
+	std::vector<size_t> memberships(objects.size(), 0);
+	for (const std::vector<size_t>& indexes: learn_indexes)
+	{
+		for (size_t index: indexes)
+			++memberships[index];
+	}
+	bool disjoint_learn = *std::max_element(memberships.begin(), memberships.end()) <= 1;
+	bool disjoint_test  = *std::min_element(memberships.begin(), memberships.end()) + 1 >= folds_count;
+	if (!disjoint_learn && !disjoint_test)
+	{
+		std::cout << "learn folds overlap partially, LDA statistics are found for every fold anew" << std::endl;
+		return;
+	}
+
+	std::chrono::steady_clock::time_point build_start = std::chrono::steady_clock::now();
+	size_t features_count = features_size(objects);
+	std::shared_ptr<FoldsStatistics> folds(new FoldsStatistics());
+	folds->learn_indexes = learn_indexes;
+	folds->statistics.resize(folds_count);
+	if (disjoint_learn)
+	{
+		// the learn folds split the pool, one pass finds all their statistics
+		std::cout << "calculating sufficient statistics of " << folds_count << " learn folds" << std::endl;
+		for (size_t fold = 0; fold < folds_count; ++fold)
+			this->sufficientStatistics(objects, learn_indexes[fold], features_count, folds->statistics[fold]);
+	}
+	else
+	{
+		// the test folds split the pool, every learn fold is the pool less
+		// its test fold and so are its statistics. All of them are taken
+		// around the class means of the pool
+		std::cout << "calculating sufficient statistics of the pool and " << folds_count << " test folds" << std::endl;
+		std::vector<size_t> indexes(objects.size());
+		std::iota(indexes.begin(), indexes.end(), 0);
+		SufficientStatistics total;
+		this->sufficientStatistics(objects, indexes, features_count, total);
+
+		std::vector<bool> is_learn;
+		SufficientStatistics test_statistics;
+		for (size_t fold = 0; fold < folds_count; ++fold)
+		{
+			is_learn.assign(objects.size(), false);
+			for (size_t index: learn_indexes[fold])
+				is_learn[index] = true;
+			indexes.clear();
+			for (size_t index = 0; index < objects.size(); ++index)
+			{
+				if (!is_learn[index])
+					indexes.push_back(index);
+			}
+
+			this->sufficientStatistics(objects, indexes, features_count, test_statistics, total.shifts);
+			folds->statistics[fold] = total;
+			folds->statistics[fold].subtract(test_statistics);
+		}
+	}
+	std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - build_start;
+	std::cout << "fold statistics time: " << build_time.count() << " s" << std::endl;
+
+	folds_statistics = folds;
+}
+
+void SimpleFischerLDA::select_objects(const std::vector<size_t>& indexes)
+{
+	if (folds_statistics)
+		selected_objects = indexes;
+}
+
+void SimpleFischerLDA::finish_folds()
+{
+	selected_objects.clear();
+	folds_statistics.reset();
+}
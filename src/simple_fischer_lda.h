@@ -4,9 +4,11 @@
 #include "predictor.h"
 #include "instance.h"
 
+#include <memory>
 #include <vector>
 
 #include "mathmatrix.h"
+#include "mathmatrix_dense.h"
 #include "mathvector.h"
 
 using namespace MathCore::AlgebraCore::VectorCore;
@@ -16,8 +18,42 @@ namespace MachineLearning
 {
 	class SimpleFischerLDA : public Predictor
 	{
+		public:
+
+			// DENSE keeps the full d x d covariation. DIAGONAL keeps only the
+			// variances of the features. LOW_RANK is the Ledoit-Wolf shrinkage
+			// of the covariation held as a rank r factor from the randomized
+			// SVD of the centred objects plus a diagonal. CONJUGATE_GRADIENT
+			// solves with the exact covariation applied to vectors straight
+			// from the objects. All but DENSE need O(d * r) memory or less,
+			// so they fit vocabulary sized feature spaces.
+			enum CovariationType { DENSE, DIAGONAL, LOW_RANK, CONJUGATE_GRADIENT };
+
 		protected:
 
+			// sufficient statistics of a set of objects: counts and feature
+			// sums of the positive and negative classes and the lower triangle
+			// of (x - c) * (x - c)^T summed over all objects, c the shift of
+			// the class of x. The shifts are kept near the class means, so
+			// the scatter is not a large x * x^T less a large correction.
+			// Statistics of disjoint sets with the same shifts add up, so
+			// those of a set are also those of a superset less the rest of it.
+			struct SufficientStatistics
+			{
+				double counts[2];
+				std::vector<double> sums[2];
+				std::vector<double> shifts[2];
+				DenseMatrix<double> scatter;
+
+				void subtract(const SufficientStatistics& other);
+			};
+
+			struct FoldsStatistics
+			{
+				std::vector<std::vector<size_t>> learn_indexes;
+				std::vector<SufficientStatistics> statistics;
+			};
+
 			double threshold;
 
 			std::pair<double, double> prioriProbability;
@@ -30,10 +66,25 @@ namespace MachineLearning
 			double betta_positive;
 			double betta_negative;
 
+			CovariationType covariation_type;
+			size_t covariation_rank;
+
+			bool fold_statistics;
+			// shared by the clones, they learn on the same folds
+			std::shared_ptr<const FoldsStatistics> folds_statistics;
+			std::vector<size_t> selected_objects;
+
 		public:
 
-			SimpleFischerLDA(size_t _featuresCount)
-				: Predictor(_featuresCount), threshold(0)
+			SimpleFischerLDA( size_t _featuresCount
+							, bool _fold_statistics = false
+							, CovariationType _covariation_type = DENSE
+							, size_t _covariation_rank = 32)
+				: Predictor(_featuresCount)
+				, threshold(0)
+				, covariation_type(_covariation_type)
+				, covariation_rank(_covariation_rank)
+				, fold_statistics(_fold_statistics)
 			{
 				fine = std::make_pair(1., 1.);
 			};
@@ -41,18 +92,49 @@ namespace MachineLearning
 			void setFine(std::pair<double, double> _fine);
 
 			double predict(MathVector<double>& features);
+			size_t linear_weights(std::vector<const MathVector<double>*>& weights);
+			double predict_scores(const double* products);
 
 			void learn( std::vector<Instance>& learnSet
 					  , std::vector<double>& objectsWeights
 					  , std::vector<std::pair<double, double>>& learning_curve);
 
+			// with fold statistics on and the dense covariation, the
+			// statistics of the learn objects of every fold are found from
+			// one or two passes over the pool, and a fold learn only builds
+			// and factors its covariation
+			void prepare_folds(std::vector<Instance>& objects, const std::vector<std::vector<size_t>>& learn_indexes);
+			void select_objects(const std::vector<size_t>& indexes);
+			void finish_folds();
+
 			Predictor* clone() const { return new SimpleFischerLDA(*this);};
 
 		protected:
 
-			MathMatrix<double>& sampleMeans(std::vector<MathVector<double>>& learnF, MathVector<double>& learnY);
-
-			void covariation(MathMatrix<double>& learnSet, MathVector<double>& learnY, MathMatrix<double>& _sampleMeans, MathMatrix<double>& transpose_cov);
+			// statistics of the objects at the indexes around the shifts, the
+			// class means of these objects when there are none. The scatter is
+			// summed by a dense block syrk of the shifted objects for dense
+			// data and from the products of not null features only for sparse
+			// data
+			void sufficientStatistics( std::vector<Instance>& objects
+									 , const std::vector<size_t>& indexes
+									 , size_t features_count
+									 , SufficientStatistics& _statistics
+									 , const std::vector<double>* shifts = nullptr);
+
+			// means, priori probabilities and covariation around the class
+			// means from the statistics, then alpha and betta of both classes
+			void learnStatistics(const SufficientStatistics& _statistics);
+
+			// learn with a covariation other than the dense one, the objects
+			// are read in place and no d x d matrix is formed
+			void learnFactored(std::vector<Instance>& learnSet);
+
+			// class means from their sums, sets the priori probabilities and fine
+			DenseMatrix<double> classMeans(const double* counts, const std::vector<double>* sums, size_t features_count);
+
+			// alpha of both classes from the rows of alphas, betta from them and the means
+			void setParameters(const DenseMatrix<double>& means, const DenseMatrix<double>& alphas);
 
 			size_t get_model_complexity();
 	};
@@ -5,8 +5,11 @@
 #include <functional>
 #include <vector>
 #include <stdio.h>
-#include <queue>
 #include <limits>
+#include <memory>
+#include <memory_resource>
+
+#include "pivot_table.h"
 
 namespace DataStructures
 {
@@ -16,14 +19,14 @@ namespace DataStructures
 	{
 	public:
 	   	typedef std::function<double( const T&, const T&)> dist_type;
+	   	// exact distance up to the bound, past it any value between the bound and the distance
+	   	typedef std::function<double( const T&, const T&, double)> bounded_dist_type;
 
 	public:
-		VpTree() : _root(0) {}
-		VpTree(const dist_type& dist) : distance(dist), _root(0) {}
-
-		~VpTree() {
-		    delete _root;
-		}
+		VpTree() : pivots_count(0) {}
+		VpTree(const dist_type& dist) : distance(dist), pivots_count(0) {}
+		VpTree(const dist_type& dist, const bounded_dist_type& bounded, size_t pivots)
+		: distance(dist), bounded_distance(bounded), pivots_count(pivots) {}
 
 		size_t size() const
 		{
@@ -31,35 +34,88 @@ namespace DataStructures
 		}
 
 		void create( const std::vector<T>& items ) {
-		    delete _root;
 		    _items = items;
-		    _root = buildFromPoints(0, items.size());
+		    _root.reset( buildFromPoints(0, items.size()) );
+		    pivots.build( _items.size(), pivots_count,
+		        [this](size_t first, size_t second) -> double { return distance( _items[first], _items[second] ); } );
 		}
 
-		void search( const T& target, int k, std::vector<T>* results, 
-		    std::vector<double>* distances) 
+		struct HeapItem {
+		    HeapItem( int index, double dist) :
+		        index(index), dist(dist) {}
+		    int index;
+		    double dist;
+		    bool operator<( const HeapItem& o ) const {
+		        return dist < o.dist;   
+		    }
+		};
+
+		// per-query scratch state; a caller keeps one per thread and reuses it,
+		// so concurrent queries do not share the pruning radius
+		struct SearchContext
 		{
-		    std::priority_queue<HeapItem> heap;
+			std::vector<HeapItem> heap;
+			double                tau;
+			std::vector<double>   pivot_distances;
+		};
 
-		    _tau = std::numeric_limits<double>::max();
-		    search( _root, target, k, heap );
+		const T& item( size_t index ) const
+		{
+			return _items[index];
+		}
 
-		    results->clear(); distances->clear();
+		// k nearest items to target sorted by distance are left in context.heap
+		void search( const T& target, size_t k, SearchContext& context ) const
+		{
+		    context.heap.clear();
+		    context.heap.reserve( k );
+		    context.tau = std::numeric_limits<double>::max();
+		    context.pivot_distances.resize( pivots.pivots_count() );
+		    for ( size_t index = 0; index < pivots.pivots_count(); ++index )
+		        context.pivot_distances[index] = distance( _items[pivots.pivot(index)], target );
+		    if ( k > 0 )
+		        search( _root.get(), target, k, context );
+		    std::sort_heap( context.heap.begin(), context.heap.end() );
+		}
 
-		    while( !heap.empty() ) {
-		        results->push_back( _items[heap.top().index] );
-		        distances->push_back( heap.top().dist );
-		        heap.pop();
+		// searches every target with a context per thread; the neighbours of
+		// the i-th target are results[i * k, i * k + counts[i])
+		void search_batch( const std::vector<T>& targets, size_t k,
+		    std::pmr::vector<HeapItem>& results, std::pmr::vector<size_t>& counts ) const
+		{
+		    results.assign( targets.size() * k, HeapItem(0, 0.0) );
+		    counts.assign( targets.size(), 0 );
+#pragma omp parallel
+		    {
+		        SearchContext context;
+#pragma omp for schedule(dynamic, 16)
+		        for ( size_t index = 0; index < targets.size(); ++index ) {
+		            search( targets[index], k, context );
+		            std::copy( context.heap.begin(), context.heap.end(), results.begin() + index * k );
+		            counts[index] = context.heap.size();
+		        }
 		    }
+		}
+
+		void search( const T& target, int k, std::vector<T>* results, 
+		    std::vector<double>* distances) const
+		{
+		    SearchContext context;
+		    search( target, (size_t)k, context );
 
-		    std::reverse( results->begin(), results->end() );
-		    std::reverse( distances->begin(), distances->end() );
+		    results->clear(); distances->clear();
+		    for ( const HeapItem& item: context.heap ) {
+		        results->push_back( _items[item.index] );
+		        distances->push_back( item.dist );
+		    }
 		}
 
 	private:
 		std::vector<T> _items;
-		double _tau;
 		dist_type distance;
+		bounded_dist_type bounded_distance;
+		size_t pivots_count;
+		PivotTable pivots;
 
 		struct Node 
 		{
@@ -75,17 +131,9 @@ namespace DataStructures
 		        delete left;
 		        delete right;
 		    }
-		}* _root;
-
-		struct HeapItem {
-		    HeapItem( int index, double dist) :
-		        index(index), dist(dist) {}
-		    int index;
-		    double dist;
-		    bool operator<( const HeapItem& o ) const {
-		        return dist < o.dist;   
-		    }
 		};
+		// the built tree is never modified, copies of the tree share it
+		std::shared_ptr<Node> _root;
 
 		struct DistanceComparator
 		{
@@ -135,40 +183,53 @@ namespace DataStructures
 		    return node;
 		}
 
-		void search( Node* node, const T& target, int k,
-		             std::priority_queue<HeapItem>& heap )
+		void search( Node* node, const T& target, size_t k,
+		             SearchContext& context ) const
 		{
 		    if ( node == NULL ) return;
 
-		    double dist = distance( _items[node->index], target );
-		    //printf("dist=%g tau=%gn", dist, _tau );
-
-		    if ( dist < _tau ) {
-		        if ( heap.size() == k ) heap.pop();
-		        heap.push( HeapItem(node->index, dist) );
-		        if ( heap.size() == k ) _tau = heap.top().dist;
+		    // a distance beyond the bound neither enters the heap nor changes
+		    // which subtrees are visited, so a lower bound past it is enough
+		    bool leaf = node->left == NULL && node->right == NULL;
+		    double bound = leaf ? context.tau : std::max( context.tau, node->threshold + context.tau );
+		    double dist = 0.0;
+		    if ( pivots.pivots_count() > 0 )
+		        dist = pivots.lower_bound( context.pivot_distances.data(), node->index );
+		    if ( dist <= bound )
+		        dist = bounded_distance ? bounded_distance( _items[node->index], target, bound )
+		                                : distance( _items[node->index], target );
+		    std::vector<HeapItem>& heap = context.heap;
+
+		    if ( dist < context.tau ) {
+		        if ( heap.size() == k ) {
+		            std::pop_heap( heap.begin(), heap.end() );
+		            heap.pop_back();
+		        }
+		        heap.push_back( HeapItem(node->index, dist) );
+		        std::push_heap( heap.begin(), heap.end() );
+		        if ( heap.size() == k ) context.tau = heap.front().dist;
 		    }
 
-		    if ( node->left == NULL && node->right == NULL ) {
+		    if ( leaf ) {
 		        return;
 		    }
 
 		    if ( dist < node->threshold ) {
-		        if ( dist - _tau <= node->threshold ) {
-		            search( node->left, target, k, heap );
+		        if ( dist - context.tau <= node->threshold ) {
+		            search( node->left, target, k, context );
 		        }
 
-		        if ( dist + _tau >= node->threshold ) {
-		            search( node->right, target, k, heap );
+		        if ( dist + context.tau >= node->threshold ) {
+		            search( node->right, target, k, context );
 		        }
 
 		    } else {
-		        if ( dist + _tau >= node->threshold ) {
-		            search( node->right, target, k, heap );
+		        if ( dist + context.tau >= node->threshold ) {
+		            search( node->right, target, k, context );
 		        }
 
-		        if ( dist - _tau <= node->threshold ) {
-		            search( node->left, target, k, heap );
+		        if ( dist - context.tau <= node->threshold ) {
+		            search( node->left, target, k, context );
 		        }
 		    }
 		}
@@ -0,0 +1,93 @@
+#ifndef VP_TREE_INDEX_H
+#define VP_TREE_INDEX_H
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "instance.h"
+#include "mathvector.h"
+#include "mathvector_norm.h"
+#include "neighbours_index.h"
+#include "vp_tree.h"
+
+using namespace MathCore::AlgebraCore::VectorCore;
+using namespace MathCore::AlgebraCore::VectorCore::VectorNorm;
+
+namespace DataStructures
+{
+	// NeighboursIndex over the pointer based VpTree with any MathVectorNorm,
+	// distances are bounded by the search radius and optionally pruned by pivots
+	class VpTreeIndex : public NeighboursIndex
+	{
+	public:
+		struct IndexedItem
+		{
+			size_t                    index;
+			const MathVector<double>* features;
+		};
+
+	public:
+		VpTreeIndex(std::shared_ptr<MathVectorNorm<double>> distance, size_t pivots_count = 0)
+		: m_tree([distance](const IndexedItem& first, const IndexedItem& second) -> double
+		         {
+		             return distance->calc(*first.features, *second.features);
+		         },
+		         [distance](const IndexedItem& first, const IndexedItem& second, double bound) -> double
+		         {
+		             return distance->calc_bounded(*first.features, *second.features, bound);
+		         },
+		         pivots_count)
+		{ }
+
+		void build(const std::vector<Instance>& items)
+		{
+			std::vector<IndexedItem> indexed(items.size());
+			for (size_t index = 0; index < items.size(); ++index)
+				indexed[index] = IndexedItem{index, &items[index].getFeatures()};
+			m_tree.create(indexed);
+		}
+
+		void search( const MathVector<double>& target
+				   , size_t k
+				   , std::vector<Neighbour>& neighbours) const
+		{
+			// the context of a thread keeps its heap and pivot distances
+			// between queries, so a query allocates nothing once they grew
+			thread_local VpTree<IndexedItem>::SearchContext context;
+			m_tree.search(IndexedItem{0, &target}, k, context);
+
+			neighbours.resize(context.heap.size());
+			for (size_t index = 0; index < context.heap.size(); ++index)
+				neighbours[index] = Neighbour{context.heap[index].dist, m_tree.item(context.heap[index].index).index};
+		}
+
+		void search_batch( const std::vector<Instance>& targets
+						 , size_t k
+						 , std::pmr::vector<Neighbour>& neighbours
+						 , std::pmr::vector<size_t>& counts) const
+		{
+			std::vector<IndexedItem> indexed(targets.size());
+			for (size_t index = 0; index < targets.size(); ++index)
+				indexed[index] = IndexedItem{index, &targets[index].getFeatures()};
+
+			std::pmr::vector<VpTree<IndexedItem>::HeapItem> found(neighbours.get_allocator().resource());
+			m_tree.search_batch(indexed, k, found, counts);
+
+			neighbours.resize(found.size());
+#pragma omp parallel for
+			for (size_t index = 0; index < found.size(); ++index)
+				neighbours[index] = Neighbour{found[index].dist, m_tree.item(found[index].index).index};
+		}
+
+		size_t size() const { return m_tree.size();};
+		std::string name() const { return "vp_tree";};
+		NeighboursIndex* clone() const { return new VpTreeIndex(*this);};
+
+	private:
+		VpTree<IndexedItem> m_tree;
+	};
+}
+
+#endif //VP_TREE_INDEX_H
@@ -1,11 +1,14 @@
 #include <boost/progress.hpp>
 
+#include <iostream>
 #include <vector>
 #include <limits>
 #include <math.h>
 #include <memory>
 #include <unordered_map>
 #include <tuple>
+#include <random>
+#include <numeric>
 
 #include "predictor.h"
 #include "instance.h"
@@ -23,9 +26,13 @@ using namespace MathCore::AlgebraCore::VectorCore;
 namespace MachineLearning
 {
 	WeakClassifier::WeakClassifier( size_t feature_count
-								  , PurityType type)
+								  , PurityType type
+								  , double feature_fraction)
 	: Predictor(feature_count)
 	, m_type(type)
+	, m_feature_fraction(feature_fraction)
+	, m_seed(0)
+	, m_quiet(false)
 	{ }
 
 	double WeakClassifier::predict(MathVector<double>& features)
@@ -53,14 +60,32 @@ namespace MachineLearning
 		std::pair<double, double> total = calc_counts(learnSet, objectsImportance, auto_predicate);
 
 		size_t features_count = learnSet.front().getFeatures().getSize();
+
+		std::vector<size_t> candidate_features(features_count);
+		std::iota(candidate_features.begin(), candidate_features.end(), 0);
+		if (m_feature_fraction < 1.0)
+		{
+			// random subspace: every split checks its own subset of features
+			size_t subset_size = std::max((size_t)1, (size_t)ceil(m_feature_fraction * features_count));
+			std::random_device rd;
+			std::mt19937 gen(m_seed != 0 ? m_seed : rd());
+			for (size_t index = 0; index < subset_size; ++index)
+			{
+				std::uniform_int_distribution<size_t> distribution(index, features_count - 1);
+				std::swap(candidate_features[index], candidate_features[distribution(gen)]);
+			}
+			candidate_features.resize(subset_size);
+		}
 		
 		double best_impurity = -1.0 * std::numeric_limits<double>::max();
 		size_t best_feature  = features_count + 1;
 		double beast_value   = 0.0;
-		boost::progress_display show_progress( features_count );
+		std::ostream no_output(nullptr);
+		boost::progress_display show_progress( candidate_features.size(), m_quiet ? no_output : std::cout );
 #pragma omp parallel for
-		for (size_t feature_index = 0; feature_index < features_count; ++feature_index)
+		for (size_t candidate_index = 0; candidate_index < candidate_features.size(); ++candidate_index)
 		{
+			size_t feature_index = candidate_features[candidate_index];
 			//std::cout << "check feature #" << feature_index << std::endl;
 			std::unordered_map<double, double> value_counts;
 			std::vector<Instance>::iterator min_value, max_value;
@@ -103,6 +128,8 @@ namespace MachineLearning
 #pragma omp parallel for
 			for (size_t object_index = 0; object_index < learnSet.size(); ++object_index)
 			{
+				if (objectsImportance[object_index] == 0.0)
+					continue;
 				size_t index = floor((learnSet[object_index].getFeatures().getElement(feature_index) - left_value) / step);
 				if (learnSet[object_index].getGoal() == 1.0)
 #pragma omp atomic
@@ -196,9 +223,10 @@ namespace MachineLearning
 		else
 			m_positive_class = -1.0;
 
-		std::cout << "Total:  best feature: " << m_feature_num << std::endl
-			      << " \t\t  best impurity: " << m_impurity    << std::endl
-		          << " \t\t     best value: " << m_value       << std::endl;
+		if (!m_quiet)
+			std::cout << "Total:  best feature: " << m_feature_num << std::endl
+				      << " \t\t  best impurity: " << m_impurity    << std::endl
+			          << " \t\t     best value: " << m_value       << std::endl;
 		return;
 	}
 
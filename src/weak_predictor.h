@@ -27,7 +27,8 @@ namespace MachineLearning
 
 	public:
 		WeakClassifier( size_t feature_count
-				      , PurityType type);
+				      , PurityType type
+				      , double feature_fraction = 1.0);
 
 		double predict(MathVector<double>& features);
 		void learn( std::vector<Instance>& learnSet
@@ -36,6 +37,16 @@ namespace MachineLearning
 
 		size_t get_model_complexity();
 		Predictor* clone() const { return new WeakClassifier(*this);};
+		bool uses_weights() const { return true;};
+
+		void set_seed(unsigned int seed) { m_seed = seed;};
+		void set_quiet(bool quiet) { m_quiet = quiet;};
+		bool quiet() const { return m_quiet;};
+
+		// learned rule: predict is positive_class when feature <= threshold
+		size_t get_feature()        const { return m_feature_num;};
+		double get_threshold()      const { return m_value;};
+		double get_positive_class() const { return m_positive_class;};
 
 	private:
 		std::pair<double, double> calc_counts( std::vector<Instance>& objects
@@ -59,11 +70,15 @@ namespace MachineLearning
 
 	private:
 		PurityType m_type;
+		double     m_feature_fraction;
 		size_t	   m_feature_num;
 		double     m_value;
 		double     m_impurity;
 
 		double     m_positive_class;
+
+		unsigned int m_seed;
+		bool         m_quiet;
 	};
 }
 